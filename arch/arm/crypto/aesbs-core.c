@@ -0,0 +1,533 @@
+/*
+ * Bit sliced AES using NEON instructions
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Eight blocks are processed at once. The 1024 bits of state are held in
+ * eight 128-bit registers, register i holding bit i of every byte, so
+ * that SubBytes becomes a boolean circuit (Boyar and Peralta, "A new
+ * combinational logic minimization technique with applications to
+ * cryptology") evaluated on all 128 bytes in parallel, with no table
+ * lookups and therefore no data dependent timing. Each 64-bit lane holds
+ * four blocks, bit (16 * row + 4 * column + block) standing for one byte
+ * of the state, so ShiftRows and MixColumns are shifts and rotations
+ * within a lane.
+ *
+ * Everything here must run between kernel_neon_begin() and
+ * kernel_neon_end(), this file is built with NEON code generation. It is
+ * freestanding and does not include kernel headers, whose types clash
+ * with those of <arm_neon.h>; the prototypes are in aesbs.h.
+ */
+
+#include <arm_neon.h>
+
+#define AES_BLOCK_SIZE		16
+
+typedef uint64x2_t bs_t;
+
+#define bs_xor(a, b)		veorq_u64(a, b)
+#define bs_and(a, b)		vandq_u64(a, b)
+#define bs_not(a)		vreinterpretq_u64_u8(		\
+					vmvnq_u8(vreinterpretq_u8_u64(a)))
+#define bs_shl(a, n)		vshlq_n_u64(a, n)
+#define bs_shr(a, n)		vshrq_n_u64(a, n)
+#define bs_rotr16(a)		vsriq_n_u64(vshlq_n_u64(a, 48), a, 16)
+#define bs_rotr32(a)		vreinterpretq_u64_u32(			\
+					vrev64q_u32(vreinterpretq_u32_u64(a)))
+#define bs_const(c)		vdupq_n_u64(c)
+#define bs_combine(lo, hi)	vcombine_u64(vcreate_u64(lo), vcreate_u64(hi))
+#define bs_lane0(a)		vgetq_lane_u64(a, 0)
+#define bs_lane1(a)		vgetq_lane_u64(a, 1)
+#define bs_load_key(p)		vld1q_u64(p)
+
+/*
+ * Transpose the 8x8 bit matrices formed by the same byte of each of the
+ * eight words: bit k of byte m of q[i] is swapped with bit i of byte m
+ * of q[k]. This is an involution.
+ */
+#define SWAPN(cl, ch, s, x, y)	do {					\
+		bs_t a = (x), b = (y);					\
+		(x) = bs_xor(bs_and(a, bs_const(cl)),			\
+			     bs_shl(bs_and(b, bs_const(cl)), s));	\
+		(y) = bs_xor(bs_shr(bs_and(a, bs_const(ch)), s),	\
+			     bs_and(b, bs_const(ch)));			\
+	} while (0)
+
+#define SWAP2(x, y)	SWAPN(0x5555555555555555ULL, 0xAAAAAAAAAAAAAAAAULL, \
+			      1, x, y)
+#define SWAP4(x, y)	SWAPN(0x3333333333333333ULL, 0xCCCCCCCCCCCCCCCCULL, \
+			      2, x, y)
+#define SWAP8(x, y)	SWAPN(0x0F0F0F0F0F0F0F0FULL, 0xF0F0F0F0F0F0F0F0ULL, \
+			      4, x, y)
+
+static inline void ortho(bs_t *q)
+{
+	SWAP2(q[0], q[1]);
+	SWAP2(q[2], q[3]);
+	SWAP2(q[4], q[5]);
+	SWAP2(q[6], q[7]);
+
+	SWAP4(q[0], q[2]);
+	SWAP4(q[1], q[3]);
+	SWAP4(q[4], q[6]);
+	SWAP4(q[5], q[7]);
+
+	SWAP8(q[0], q[4]);
+	SWAP8(q[1], q[5]);
+	SWAP8(q[2], q[6]);
+	SWAP8(q[3], q[7]);
+}
+
+static inline uint32_t load_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void store_le32(uint32_t v, uint8_t *p)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+/* Spread the bytes of a column to the even bytes of a 64-bit word */
+static inline uint64_t spread(uint32_t w)
+{
+	uint64_t x = w;
+
+	x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+	x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+	return x;
+}
+
+static inline uint32_t unspread(uint64_t x)
+{
+	x &= 0x00FF00FF00FF00FFULL;
+	x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+	x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+	return (uint32_t)x;
+}
+
+/*
+ * Before the transposition, word (4 * (column & 1) + block) holds the
+ * bytes of columns (column & 1) and (column & 1) + 2 of a block,
+ * interleaved, so that byte (2 * row + (column >> 1)) ends up at bit
+ * (16 * row + 4 * column + block) of every bit plane.
+ */
+static void bs_load(bs_t *q, const uint8_t *src)
+{
+	uint64_t w[2][8];
+	int l, b;
+
+	for (l = 0; l < 2; l++) {
+		for (b = 0; b < 4; b++) {
+			const uint8_t *in = src + AES_BLOCK_SIZE * (4 * l + b);
+
+			w[l][b] = spread(load_le32(in)) |
+				spread(load_le32(in + 8)) << 8;
+			w[l][4 + b] = spread(load_le32(in + 4)) |
+				spread(load_le32(in + 12)) << 8;
+		}
+	}
+
+	for (b = 0; b < 8; b++)
+		q[b] = bs_combine(w[0][b], w[1][b]);
+
+	ortho(q);
+}
+
+static void bs_store(uint8_t *dst, bs_t *q)
+{
+	uint64_t w[2][8];
+	int l, b;
+
+	ortho(q);
+
+	for (b = 0; b < 8; b++) {
+		w[0][b] = bs_lane0(q[b]);
+		w[1][b] = bs_lane1(q[b]);
+	}
+
+	for (l = 0; l < 2; l++) {
+		for (b = 0; b < 4; b++) {
+			uint8_t *out = dst + AES_BLOCK_SIZE * (4 * l + b);
+
+			store_le32(unspread(w[l][b]), out);
+			store_le32(unspread(w[l][b] >> 8), out + 8);
+			store_le32(unspread(w[l][4 + b]), out + 4);
+			store_le32(unspread(w[l][4 + b] >> 8), out + 12);
+		}
+	}
+}
+
+/*
+ * The S-box circuit of Boyar and Peralta: 32 AND/OR and 83 XOR/XNOR
+ * gates. x0 is the most significant bit of the input byte.
+ */
+static void bs_sbox(bs_t *q)
+{
+	bs_t x0, x1, x2, x3, x4, x5, x6, x7;
+	bs_t y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11;
+	bs_t y12, y13, y14, y15, y16, y17, y18, y19, y20, y21;
+	bs_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11;
+	bs_t z12, z13, z14, z15, z16, z17;
+	bs_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+	bs_t t12, t13, t14, t15, t16, t17, t18, t19, t20, t21;
+	bs_t t22, t23, t24, t25, t26, t27, t28, t29, t30, t31;
+	bs_t t32, t33, t34, t35, t36, t37, t38, t39, t40, t41;
+	bs_t t42, t43, t44, t45, t46, t47, t48, t49, t50, t51;
+	bs_t t52, t53, t54, t55, t56, t57, t58, t59, t60, t61;
+	bs_t t62, t63, t64, t65, t66, t67;
+	bs_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+	x0 = q[7];
+	x1 = q[6];
+	x2 = q[5];
+	x3 = q[4];
+	x4 = q[3];
+	x5 = q[2];
+	x6 = q[1];
+	x7 = q[0];
+
+	/* Top linear transformation */
+	y14 = bs_xor(x3, x5);
+	y13 = bs_xor(x0, x6);
+	y9 = bs_xor(x0, x3);
+	y8 = bs_xor(x0, x5);
+	t0 = bs_xor(x1, x2);
+	y1 = bs_xor(t0, x7);
+	y4 = bs_xor(y1, x3);
+	y12 = bs_xor(y13, y14);
+	y2 = bs_xor(y1, x0);
+	y5 = bs_xor(y1, x6);
+	y3 = bs_xor(y5, y8);
+	t1 = bs_xor(x4, y12);
+	y15 = bs_xor(t1, x5);
+	y20 = bs_xor(t1, x1);
+	y6 = bs_xor(y15, x7);
+	y10 = bs_xor(y15, t0);
+	y11 = bs_xor(y20, y9);
+	y7 = bs_xor(x7, y11);
+	y17 = bs_xor(y10, y11);
+	y19 = bs_xor(y10, y8);
+	y16 = bs_xor(t0, y11);
+	y21 = bs_xor(y13, y16);
+	y18 = bs_xor(x0, y16);
+
+	/* Non-linear section */
+	t2 = bs_and(y12, y15);
+	t3 = bs_and(y3, y6);
+	t4 = bs_xor(t3, t2);
+	t5 = bs_and(y4, x7);
+	t6 = bs_xor(t5, t2);
+	t7 = bs_and(y13, y16);
+	t8 = bs_and(y5, y1);
+	t9 = bs_xor(t8, t7);
+	t10 = bs_and(y2, y7);
+	t11 = bs_xor(t10, t7);
+	t12 = bs_and(y9, y11);
+	t13 = bs_and(y14, y17);
+	t14 = bs_xor(t13, t12);
+	t15 = bs_and(y8, y10);
+	t16 = bs_xor(t15, t12);
+	t17 = bs_xor(t4, t14);
+	t18 = bs_xor(t6, t16);
+	t19 = bs_xor(t9, t14);
+	t20 = bs_xor(t11, t16);
+	t21 = bs_xor(t17, y20);
+	t22 = bs_xor(t18, y19);
+	t23 = bs_xor(t19, y21);
+	t24 = bs_xor(t20, y18);
+
+	t25 = bs_xor(t21, t22);
+	t26 = bs_and(t21, t23);
+	t27 = bs_xor(t24, t26);
+	t28 = bs_and(t25, t27);
+	t29 = bs_xor(t28, t22);
+	t30 = bs_xor(t23, t24);
+	t31 = bs_xor(t22, t26);
+	t32 = bs_and(t31, t30);
+	t33 = bs_xor(t32, t24);
+	t34 = bs_xor(t23, t33);
+	t35 = bs_xor(t27, t33);
+	t36 = bs_and(t24, t35);
+	t37 = bs_xor(t36, t34);
+	t38 = bs_xor(t27, t36);
+	t39 = bs_and(t29, t38);
+	t40 = bs_xor(t25, t39);
+
+	t41 = bs_xor(t40, t37);
+	t42 = bs_xor(t29, t33);
+	t43 = bs_xor(t29, t40);
+	t44 = bs_xor(t33, t37);
+	t45 = bs_xor(t42, t41);
+	z0 = bs_and(t44, y15);
+	z1 = bs_and(t37, y6);
+	z2 = bs_and(t33, x7);
+	z3 = bs_and(t43, y16);
+	z4 = bs_and(t40, y1);
+	z5 = bs_and(t29, y7);
+	z6 = bs_and(t42, y11);
+	z7 = bs_and(t45, y17);
+	z8 = bs_and(t41, y10);
+	z9 = bs_and(t44, y12);
+	z10 = bs_and(t37, y3);
+	z11 = bs_and(t33, y4);
+	z12 = bs_and(t43, y13);
+	z13 = bs_and(t40, y5);
+	z14 = bs_and(t29, y2);
+	z15 = bs_and(t42, y9);
+	z16 = bs_and(t45, y14);
+	z17 = bs_and(t41, y8);
+
+	/* Bottom linear transformation */
+	t46 = bs_xor(z15, z16);
+	t47 = bs_xor(z10, z11);
+	t48 = bs_xor(z5, z13);
+	t49 = bs_xor(z9, z10);
+	t50 = bs_xor(z2, z12);
+	t51 = bs_xor(z2, z5);
+	t52 = bs_xor(z7, z8);
+	t53 = bs_xor(z0, z3);
+	t54 = bs_xor(z6, z7);
+	t55 = bs_xor(z16, z17);
+	t56 = bs_xor(z12, t48);
+	t57 = bs_xor(t50, t53);
+	t58 = bs_xor(z4, t46);
+	t59 = bs_xor(z3, t54);
+	t60 = bs_xor(t46, t57);
+	t61 = bs_xor(z14, t57);
+	t62 = bs_xor(t52, t58);
+	t63 = bs_xor(t49, t58);
+	t64 = bs_xor(z4, t59);
+	t65 = bs_xor(t61, t62);
+	t66 = bs_xor(z1, t63);
+	s0 = bs_xor(t59, t63);
+	s6 = bs_xor(t56, bs_not(t62));
+	s7 = bs_xor(t48, bs_not(t60));
+	t67 = bs_xor(t64, t65);
+	s3 = bs_xor(t53, t66);
+	s4 = bs_xor(t51, t66);
+	s5 = bs_xor(t47, t65);
+	s1 = bs_xor(t64, bs_not(s3));
+	s2 = bs_xor(t55, bs_not(t67));
+
+	q[7] = s0;
+	q[6] = s1;
+	q[5] = s2;
+	q[4] = s3;
+	q[3] = s4;
+	q[2] = s5;
+	q[1] = s6;
+	q[0] = s7;
+}
+
+/*
+ * The S-box is S(x) = A(I(x)) ^ 0x63 with I() the inversion in GF(2^8)
+ * and A() linear, so the inverse S-box is B(S(B(x ^ 0x63)) ^ 0x63) with
+ * B() the inverse of A(): iS(S(y)) = B(A(I(I(y))) ^ 0x63 ^ 0x63) = y.
+ * B(x ^ 0x63) maps bit i to bits i + 2, i + 5 and i + 7 (mod 8),
+ * complemented for the bits set in 0x05.
+ */
+static void bs_inv_affine(bs_t *q)
+{
+	bs_t q0 = bs_not(q[0]), q1 = bs_not(q[1]), q2 = q[2], q3 = q[3];
+	bs_t q4 = q[4], q5 = bs_not(q[5]), q6 = bs_not(q[6]), q7 = q[7];
+
+	q[7] = bs_xor(bs_xor(q1, q4), q6);
+	q[6] = bs_xor(bs_xor(q0, q3), q5);
+	q[5] = bs_xor(bs_xor(q7, q2), q4);
+	q[4] = bs_xor(bs_xor(q6, q1), q3);
+	q[3] = bs_xor(bs_xor(q5, q0), q2);
+	q[2] = bs_xor(bs_xor(q4, q7), q1);
+	q[1] = bs_xor(bs_xor(q3, q6), q0);
+	q[0] = bs_xor(bs_xor(q2, q5), q7);
+}
+
+static void bs_inv_sbox(bs_t *q)
+{
+	bs_inv_affine(q);
+	bs_sbox(q);
+	bs_inv_affine(q);
+}
+
+static void bs_add_round_key(bs_t *q, const uint64_t *sk)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] = bs_xor(q[i], bs_load_key(sk + 2 * i));
+}
+
+static inline bs_t shift_rows1(bs_t x)
+{
+	return bs_xor(bs_xor(bs_xor(
+		bs_and(x, bs_const(0x000000000000FFFFULL)),
+		bs_shr(bs_and(x, bs_const(0x00000000FFF00000ULL)), 4)),
+		bs_xor(bs_shl(bs_and(x, bs_const(0x00000000000F0000ULL)), 12),
+		       bs_shr(bs_and(x, bs_const(0x0000FF0000000000ULL)), 8))),
+		bs_xor(bs_xor(
+		bs_shl(bs_and(x, bs_const(0x000000FF00000000ULL)), 8),
+		bs_shr(bs_and(x, bs_const(0xF000000000000000ULL)), 12)),
+		bs_shl(bs_and(x, bs_const(0x0FFF000000000000ULL)), 4)));
+}
+
+static inline bs_t inv_shift_rows1(bs_t x)
+{
+	return bs_xor(bs_xor(bs_xor(
+		bs_and(x, bs_const(0x000000000000FFFFULL)),
+		bs_shl(bs_and(x, bs_const(0x000000000FFF0000ULL)), 4)),
+		bs_xor(bs_shr(bs_and(x, bs_const(0x00000000F0000000ULL)), 12),
+		       bs_shr(bs_and(x, bs_const(0x0000FF0000000000ULL)), 8))),
+		bs_xor(bs_xor(
+		bs_shl(bs_and(x, bs_const(0x000000FF00000000ULL)), 8),
+		bs_shr(bs_and(x, bs_const(0xFFF0000000000000ULL)), 4)),
+		bs_shl(bs_and(x, bs_const(0x000F000000000000ULL)), 12)));
+}
+
+static void bs_shift_rows(bs_t *q)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] = shift_rows1(q[i]);
+}
+
+static void bs_inv_shift_rows(bs_t *q)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		q[i] = inv_shift_rows1(q[i]);
+}
+
+/*
+ * Column byte r becomes 2 * (a[r] ^ a[r + 1]) ^ a[r + 1] ^ a[r + 2] ^
+ * a[r + 3]. Rotating a lane right by 16 bits moves row r + 1 to row r,
+ * multiplying by 2 is a shift of the bit planes reduced by 0x1b.
+ */
+static void bs_mix_columns(bs_t *q)
+{
+	bs_t r[8], x[8];
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		r[i] = bs_rotr16(q[i]);
+		x[i] = bs_xor(q[i], r[i]);
+	}
+
+	q[0] = bs_xor(bs_xor(x[7], r[0]), bs_rotr32(x[0]));
+	q[1] = bs_xor(bs_xor(bs_xor(x[0], x[7]), r[1]), bs_rotr32(x[1]));
+	q[2] = bs_xor(bs_xor(x[1], r[2]), bs_rotr32(x[2]));
+	q[3] = bs_xor(bs_xor(bs_xor(x[2], x[7]), r[3]), bs_rotr32(x[3]));
+	q[4] = bs_xor(bs_xor(bs_xor(x[3], x[7]), r[4]), bs_rotr32(x[4]));
+	q[5] = bs_xor(bs_xor(x[4], r[5]), bs_rotr32(x[5]));
+	q[6] = bs_xor(bs_xor(x[5], r[6]), bs_rotr32(x[6]));
+	q[7] = bs_xor(bs_xor(x[6], r[7]), bs_rotr32(x[7]));
+}
+
+/*
+ * InvMixColumns is MixColumns after multiplying each column by
+ * 4x^2 + 5, that is a[r] ^= 4 * (a[r] ^ a[r + 2]).
+ */
+static void bs_inv_mix_columns(bs_t *q)
+{
+	bs_t u[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		u[i] = bs_xor(q[i], bs_rotr32(q[i]));
+
+	q[0] = bs_xor(q[0], u[6]);
+	q[1] = bs_xor(q[1], bs_xor(u[6], u[7]));
+	q[2] = bs_xor(q[2], bs_xor(u[0], u[7]));
+	q[3] = bs_xor(q[3], bs_xor(u[1], u[6]));
+	q[4] = bs_xor(q[4], bs_xor(bs_xor(u[2], u[6]), u[7]));
+	q[5] = bs_xor(q[5], bs_xor(u[3], u[7]));
+	q[6] = bs_xor(q[6], u[4]);
+	q[7] = bs_xor(q[7], u[5]);
+
+	bs_mix_columns(q);
+}
+
+/**
+ * aesbs_convert_key - bit slice an expanded key
+ * @bskey: (rounds + 1) * 16 words of output
+ * @rk: round keys as expanded by crypto_aes_expand_key()
+ * @rounds: number of rounds
+ *
+ * The round keys are loaded like eight copies of a block.
+ */
+void aesbs_convert_key(uint64_t *bskey, const uint32_t *rk, int rounds)
+{
+	uint8_t blk[8 * AES_BLOCK_SIZE];
+	bs_t q[8];
+	int r, b, i;
+
+	for (r = 0; r <= rounds; r++) {
+		for (b = 0; b < 8; b++)
+			for (i = 0; i < 4; i++)
+				store_le32(rk[4 * r + i],
+					   blk + AES_BLOCK_SIZE * b + 4 * i);
+		bs_load(q, blk);
+		for (i = 0; i < 8; i++)
+			vst1q_u64(bskey + 16 * r + 2 * i, q[i]);
+	}
+}
+
+/**
+ * aesbs_encrypt8 - encrypt eight blocks
+ * @bskey: key converted by aesbs_convert_key()
+ * @rounds: number of rounds
+ * @dst: output, may be the same as @src
+ * @src: input
+ */
+void aesbs_encrypt8(const uint64_t *bskey, int rounds, uint8_t *dst,
+		    const uint8_t *src)
+{
+	bs_t q[8];
+	int r;
+
+	bs_load(q, src);
+	bs_add_round_key(q, bskey);
+	for (r = 1; r < rounds; r++) {
+		bs_sbox(q);
+		bs_shift_rows(q);
+		bs_mix_columns(q);
+		bs_add_round_key(q, bskey + 16 * r);
+	}
+	bs_sbox(q);
+	bs_shift_rows(q);
+	bs_add_round_key(q, bskey + 16 * rounds);
+	bs_store(dst, q);
+}
+
+/**
+ * aesbs_decrypt8 - decrypt eight blocks
+ * @bskey: encryption key converted by aesbs_convert_key()
+ * @rounds: number of rounds
+ * @dst: output, may be the same as @src
+ * @src: input
+ */
+void aesbs_decrypt8(const uint64_t *bskey, int rounds, uint8_t *dst,
+		    const uint8_t *src)
+{
+	bs_t q[8];
+	int r;
+
+	bs_load(q, src);
+	bs_add_round_key(q, bskey + 16 * rounds);
+	for (r = rounds - 1; r > 0; r--) {
+		bs_inv_shift_rows(q);
+		bs_inv_sbox(q);
+		bs_add_round_key(q, bskey + 16 * r);
+		bs_inv_mix_columns(q);
+	}
+	bs_inv_shift_rows(q);
+	bs_inv_sbox(q);
+	bs_add_round_key(q, bskey);
+	bs_store(dst, q);
+}
@@ -0,0 +1,409 @@
+/*
+ * Glue code for the bit sliced NEON AES, see aesbs-core.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The bit sliced code only pays off on eight blocks at a time, so it
+ * serves the modes whose blocks are independent: CBC decryption, CTR and
+ * XTS. CBC encryption is serial and uses the scalar ARM code, as do the
+ * tails shorter than eight blocks and callers in interrupt context, where
+ * the NEON unit cannot be claimed.
+ */
+
+#include <linux/module.h>
+#include <linux/hardirq.h>
+#include <linux/crypto.h>
+#include <crypto/algapi.h>
+#include <crypto/aes.h>
+#include <crypto/b128ops.h>
+#include <crypto/gf128mul.h>
+#include <asm/aes.h>
+#include <asm/neon.h>
+
+#include "aesbs.h"
+
+#define AESBS_BYTES		(AESBS_BLOCKS * AES_BLOCK_SIZE)
+
+struct aesbs_ctx {
+	u64			bskey[AESBS_KEY_WORDS];
+	struct crypto_aes_ctx	aes;
+	int			rounds;
+};
+
+struct aesbs_xts_ctx {
+	struct aesbs_ctx	key;
+	struct crypto_aes_ctx	twkey;
+};
+
+static int aesbs_expand_key(struct crypto_tfm *tfm, struct aesbs_ctx *ctx,
+			    const u8 *in_key, unsigned int key_len)
+{
+	if (crypto_aes_expand_key(&ctx->aes, in_key, key_len)) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+
+	ctx->rounds = 6 + key_len / 4;
+
+	kernel_neon_begin();
+	aesbs_convert_key(ctx->bskey, ctx->aes.key_enc, ctx->rounds);
+	kernel_neon_end();
+
+	return 0;
+}
+
+static int aesbs_setkey(struct crypto_tfm *tfm, const u8 *in_key,
+			unsigned int key_len)
+{
+	return aesbs_expand_key(tfm, crypto_tfm_ctx(tfm), in_key, key_len);
+}
+
+static int aesbs_xts_setkey(struct crypto_tfm *tfm, const u8 *in_key,
+			    unsigned int key_len)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	/* The first half of the key encrypts the data, the second the tweak */
+	if (key_len % 2 ||
+	    crypto_aes_expand_key(&ctx->twkey, in_key + key_len / 2,
+				  key_len / 2)) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+
+	return aesbs_expand_key(tfm, &ctx->key, in_key, key_len / 2);
+}
+
+/* Whether a walk step of @nbytes is worth claiming the NEON unit */
+static inline bool aesbs_usable(unsigned int nbytes)
+{
+	return nbytes >= AESBS_BYTES && !in_interrupt();
+}
+
+static int aesbs_cbc_encrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *in = walk.src.virt.addr;
+		u8 *out = walk.dst.virt.addr;
+		u8 *iv = walk.iv;
+
+		do {
+			crypto_xor(iv, in, AES_BLOCK_SIZE);
+			crypto_aes_encrypt_arm(&ctx->aes, out, iv);
+			memcpy(iv, out, AES_BLOCK_SIZE);
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+		} while ((nbytes -= AES_BLOCK_SIZE) >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_cbc_decrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u8 buf[AESBS_BYTES] __aligned(8);
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *in = walk.src.virt.addr;
+		u8 *out = walk.dst.virt.addr;
+		u8 *iv = walk.iv;
+
+		if (aesbs_usable(nbytes)) {
+			kernel_neon_begin();
+			do {
+				/* Keep the ciphertext, @out may be @in */
+				memcpy(buf, in, AESBS_BYTES);
+				aesbs_decrypt8(ctx->bskey, ctx->rounds,
+					       out, in);
+				crypto_xor(out, iv, AES_BLOCK_SIZE);
+				crypto_xor(out + AES_BLOCK_SIZE, buf,
+					   AESBS_BYTES - AES_BLOCK_SIZE);
+				memcpy(iv, buf + AESBS_BYTES - AES_BLOCK_SIZE,
+				       AES_BLOCK_SIZE);
+				in += AESBS_BYTES;
+				out += AESBS_BYTES;
+			} while ((nbytes -= AESBS_BYTES) >= AESBS_BYTES);
+			kernel_neon_end();
+		}
+
+		while (nbytes >= AES_BLOCK_SIZE) {
+			memcpy(buf, in, AES_BLOCK_SIZE);
+			crypto_aes_decrypt_arm(&ctx->aes, out, in);
+			crypto_xor(out, iv, AES_BLOCK_SIZE);
+			memcpy(iv, buf, AES_BLOCK_SIZE);
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+			nbytes -= AES_BLOCK_SIZE;
+		}
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_ctr_crypt(struct blkcipher_desc *desc,
+			   struct scatterlist *dst, struct scatterlist *src,
+			   unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	u8 ks[AESBS_BYTES] __aligned(8);
+	int i, err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		u8 *in = walk.src.virt.addr;
+		u8 *out = walk.dst.virt.addr;
+		u8 *ctr = walk.iv;
+
+		if (aesbs_usable(nbytes)) {
+			kernel_neon_begin();
+			do {
+				for (i = 0; i < AESBS_BLOCKS; i++) {
+					memcpy(ks + i * AES_BLOCK_SIZE, ctr,
+					       AES_BLOCK_SIZE);
+					crypto_inc(ctr, AES_BLOCK_SIZE);
+				}
+				aesbs_encrypt8(ctx->bskey, ctx->rounds, ks, ks);
+				crypto_xor(ks, in, AESBS_BYTES);
+				memcpy(out, ks, AESBS_BYTES);
+				in += AESBS_BYTES;
+				out += AESBS_BYTES;
+			} while ((nbytes -= AESBS_BYTES) >= AESBS_BYTES);
+			kernel_neon_end();
+		}
+
+		while (nbytes >= AES_BLOCK_SIZE) {
+			crypto_aes_encrypt_arm(&ctx->aes, ks, ctr);
+			crypto_inc(ctr, AES_BLOCK_SIZE);
+			crypto_xor(ks, in, AES_BLOCK_SIZE);
+			memcpy(out, ks, AES_BLOCK_SIZE);
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+			nbytes -= AES_BLOCK_SIZE;
+		}
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	/* The last block may be partial */
+	if (walk.nbytes) {
+		crypto_aes_encrypt_arm(&ctx->aes, ks, walk.iv);
+		crypto_xor(ks, walk.src.virt.addr, walk.nbytes);
+		memcpy(walk.dst.virt.addr, ks, walk.nbytes);
+		crypto_inc(walk.iv, AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+
+	return err;
+}
+
+static int aesbs_xts_crypt(struct blkcipher_desc *desc,
+			   struct scatterlist *dst, struct scatterlist *src,
+			   unsigned int nbytes, bool enc)
+{
+	struct aesbs_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct aesbs_ctx *key = &ctx->key;
+	struct blkcipher_walk walk;
+	be128 buf[AESBS_BLOCKS], tw[AESBS_BLOCKS];
+	be128 t;
+	int i, err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	if (!walk.nbytes)
+		return err;
+
+	/* The initial tweak is the encrypted IV */
+	crypto_aes_encrypt_arm(&ctx->twkey, (u8 *)&t, walk.iv);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *in = walk.src.virt.addr;
+		u8 *out = walk.dst.virt.addr;
+
+		if (aesbs_usable(nbytes)) {
+			kernel_neon_begin();
+			do {
+				for (i = 0; i < AESBS_BLOCKS; i++) {
+					tw[i] = t;
+					gf128mul_x_ble(&t, &t);
+				}
+				memcpy(buf, in, AESBS_BYTES);
+				crypto_xor((u8 *)buf, (u8 *)tw, AESBS_BYTES);
+				if (enc)
+					aesbs_encrypt8(key->bskey, key->rounds,
+						       (u8 *)buf, (u8 *)buf);
+				else
+					aesbs_decrypt8(key->bskey, key->rounds,
+						       (u8 *)buf, (u8 *)buf);
+				crypto_xor((u8 *)buf, (u8 *)tw, AESBS_BYTES);
+				memcpy(out, buf, AESBS_BYTES);
+				in += AESBS_BYTES;
+				out += AESBS_BYTES;
+			} while ((nbytes -= AESBS_BYTES) >= AESBS_BYTES);
+			kernel_neon_end();
+		}
+
+		while (nbytes >= AES_BLOCK_SIZE) {
+			memcpy(buf, in, AES_BLOCK_SIZE);
+			be128_xor(buf, buf, &t);
+			if (enc)
+				crypto_aes_encrypt_arm(&key->aes, (u8 *)buf,
+						       (u8 *)buf);
+			else
+				crypto_aes_decrypt_arm(&key->aes, (u8 *)buf,
+						       (u8 *)buf);
+			be128_xor(buf, buf, &t);
+			memcpy(out, buf, AES_BLOCK_SIZE);
+			gf128mul_x_ble(&t, &t);
+			in += AES_BLOCK_SIZE;
+			out += AES_BLOCK_SIZE;
+			nbytes -= AES_BLOCK_SIZE;
+		}
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_xts_encrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_xts_crypt(desc, dst, src, nbytes, true);
+}
+
+static int aesbs_xts_decrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_xts_crypt(desc, dst, src, nbytes, false);
+}
+
+static struct crypto_alg aesbs_algs[] = { {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "cbc-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aesbs_algs[0].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_setkey,
+			.encrypt	= aesbs_cbc_encrypt,
+			.decrypt	= aesbs_cbc_decrypt,
+		},
+	},
+}, {
+	.cra_name		= "ctr(aes)",
+	.cra_driver_name	= "ctr-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aesbs_algs[1].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_setkey,
+			.encrypt	= aesbs_ctr_crypt,
+			.decrypt	= aesbs_ctr_crypt,
+		},
+	},
+}, {
+	.cra_name		= "xts(aes)",
+	.cra_driver_name	= "xts-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_xts_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aesbs_algs[2].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_xts_setkey,
+			.encrypt	= aesbs_xts_encrypt,
+			.decrypt	= aesbs_xts_decrypt,
+		},
+	},
+} };
+
+static int __init aesbs_init(void)
+{
+	int i, err;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	for (i = 0; i < ARRAY_SIZE(aesbs_algs); i++) {
+		err = crypto_register_alg(&aesbs_algs[i]);
+		if (err)
+			goto unregister;
+	}
+
+	return 0;
+
+unregister:
+	while (--i >= 0)
+		crypto_unregister_alg(&aesbs_algs[i]);
+	return err;
+}
+
+static void __exit aesbs_fini(void)
+{
+	int i;
+
+	for (i = ARRAY_SIZE(aesbs_algs) - 1; i >= 0; i--)
+		crypto_unregister_alg(&aesbs_algs[i]);
+}
+
+module_init(aesbs_init);
+module_exit(aesbs_fini);
+
+MODULE_DESCRIPTION("Bit sliced AES in CBC/CTR/XTS modes using NEON");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("cbc(aes)");
+MODULE_ALIAS("ctr(aes)");
+MODULE_ALIAS("xts(aes)");
@@ -0,0 +1,16 @@
+#ifndef __ARM_CRYPTO_AESBS_H
+#define __ARM_CRYPTO_AESBS_H
+
+#include <crypto/aes.h>
+
+/* Blocks processed by one call of the bit sliced code */
+#define AESBS_BLOCKS		8
+
+/* u64 words of a bit sliced key, 16 per round key */
+#define AESBS_KEY_WORDS		(16 * 15)
+
+void aesbs_convert_key(u64 *bskey, const u32 *rk, int rounds);
+void aesbs_encrypt8(const u64 *bskey, int rounds, u8 *dst, const u8 *src);
+void aesbs_decrypt8(const u64 *bskey, int rounds, u8 *dst, const u8 *src);
+
+#endif
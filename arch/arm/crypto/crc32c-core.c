@@ -0,0 +1,117 @@
+/*
+ * CRC32C folding using NEON polynomial multiplies
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A 16 byte block that is followed by D more bits of message contributes
+ * M(x) * x^D to the CRC, which is congruent to H(x) * (x^(D + 64) mod P) +
+ * L(x) * (x^D mod P) where H and L are its two 64 bit halves. Both terms
+ * fit in 128 bits again, so the block can be folded onto the one D bits
+ * further along with two 64x32 bit carry-less multiplies, and the whole
+ * buffer reduces to a 16 byte residue with the same CRC.
+ *
+ * There is no 64 bit carry-less multiply in ARMv7, so each product is
+ * built from vmull.p8, which multiplies eight byte pairs at a time: the
+ * four constant bytes are each broadcast against all bytes of a half,
+ * and the 16 bit partial products are split into low and high bytes and
+ * shifted into place. Four blocks are folded in parallel to keep the
+ * multiplier busy.
+ *
+ * Everything here must run between kernel_neon_begin() and
+ * kernel_neon_end(), this file is built with NEON code generation. The
+ * prototype is in crc32c-glue.c.
+ */
+
+#include <arm_neon.h>
+
+/*
+ * Bit reflected x^(D + 63) mod P and x^(D - 1) mod P for D = 512, to fold
+ * across four blocks, and D = 128, to fold onto the next block. The
+ * exponents are one less than above as the product of two reflected
+ * values comes out one bit short.
+ */
+static const uint8_t k512[2][4] = {
+	{ 0x3b, 0x24, 0x19, 0x1c },	/* x^575 */
+	{ 0x5b, 0xa4, 0xbb, 0x75 },	/* x^511 */
+};
+
+static const uint8_t k128[2][4] = {
+	{ 0xbd, 0xf7, 0x43, 0x37 },	/* x^191 */
+	{ 0x30, 0xd4, 0x71, 0x31 },	/* x^127 */
+};
+
+/* v shifted up by n bytes in a 16 byte vector, 0 < n < 8 */
+#define place(v, n)	vextq_u8(vdupq_n_u8(0),			\
+				 vcombine_u8(v, vdup_n_u8(0)), 16 - (n))
+
+static inline uint8x16_t fold(uint8x16_t x, const uint8_t k[2][4])
+{
+	poly8x8_t lo = vreinterpret_p8_u8(vget_low_u8(x));
+	poly8x8_t hi = vreinterpret_p8_u8(vget_high_u8(x));
+	uint8x8_t l[4], h[4];
+	uint8x16_t r;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		uint16x8_t p;
+
+		p = veorq_u16(vreinterpretq_u16_p16(vmull_p8(lo,
+						vdup_n_p8(k[0][i]))),
+			      vreinterpretq_u16_p16(vmull_p8(hi,
+						vdup_n_p8(k[1][i]))));
+		l[i] = vmovn_u16(p);
+		h[i] = vshrn_n_u16(p, 8);
+	}
+
+	/* the constants occupy the upper half of a reflected 64 bit word */
+	r = place(l[0], 4);
+	r = veorq_u8(r, place(veor_u8(l[1], h[0]), 5));
+	r = veorq_u8(r, place(veor_u8(l[2], h[1]), 6));
+	r = veorq_u8(r, place(veor_u8(l[3], h[2]), 7));
+	return veorq_u8(r, vcombine_u8(vdup_n_u8(0), h[3]));
+}
+
+/**
+ * crc32c_neon_fold - reduce a buffer to a 16 byte residue
+ * @crc: CRC so far, not inverted
+ * @data: input, need not be aligned
+ * @len: length of @data, a multiple of 16 and at least 64
+ * @out: 16 bytes whose CRC starting from zero is that of @data from @crc
+ */
+void crc32c_neon_fold(uint32_t crc, const uint8_t *data, unsigned int len,
+		      uint8_t *out)
+{
+	uint8x16_t x0, x1, x2, x3;
+
+	/* starting from crc is the same as starting from zero with crc xored in */
+	x0 = veorq_u8(vld1q_u8(data), vreinterpretq_u8_u32(
+			vsetq_lane_u32(crc, vdupq_n_u32(0), 0)));
+	x1 = vld1q_u8(data + 16);
+	x2 = vld1q_u8(data + 32);
+	x3 = vld1q_u8(data + 48);
+	data += 64;
+	len -= 64;
+
+	while (len >= 64) {
+		x0 = veorq_u8(fold(x0, k512), vld1q_u8(data));
+		x1 = veorq_u8(fold(x1, k512), vld1q_u8(data + 16));
+		x2 = veorq_u8(fold(x2, k512), vld1q_u8(data + 32));
+		x3 = veorq_u8(fold(x3, k512), vld1q_u8(data + 48));
+		data += 64;
+		len -= 64;
+	}
+
+	x1 = veorq_u8(x1, fold(x0, k128));
+	x2 = veorq_u8(x2, fold(x1, k128));
+	x3 = veorq_u8(x3, fold(x2, k128));
+
+	while (len) {
+		x3 = veorq_u8(fold(x3, k128), vld1q_u8(data));
+		data += 16;
+		len -= 16;
+	}
+
+	vst1q_u8(out, x3);
+}
@@ -0,0 +1,169 @@
+/*
+ * Glue code for CRC32C using NEON polynomial multiplies
+ *
+ * Based on crypto/crc32c.c, with the same key and digest conventions. The
+ * NEON unit can only be used in process context, anything checksummed from
+ * an interrupt, and buffers too short to be worth folding, go to the table
+ * driven __crc32c_le() in lib/crc32.c, which also finishes off the residue
+ * and any tail left by the NEON code.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ */
+#include <crypto/internal/hash.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/crc32.h>
+#include <linux/hardirq.h>
+#include <asm/byteorder.h>
+#include <asm/neon.h>
+
+#define CHKSUM_BLOCK_SIZE	1
+#define CHKSUM_DIGEST_SIZE	4
+
+/* below this the table code wins over the NEON setup and the residue */
+#define CRC32C_NEON_MIN_LEN	64
+
+/* in crc32c-core.c, built for NEON */
+void crc32c_neon_fold(u32 crc, const u8 *data, unsigned int len, u8 *out);
+
+struct chksum_ctx {
+	u32 key;
+};
+
+struct chksum_desc_ctx {
+	u32 crc;
+};
+
+static u32 crc32c_neon(u32 crc, const u8 *data, unsigned int len)
+{
+	u8 residue[16];
+	unsigned int n;
+
+	if (len < CRC32C_NEON_MIN_LEN || in_interrupt())
+		return __crc32c_le(crc, data, len);
+
+	n = round_down(len, 16);
+
+	kernel_neon_begin();
+	crc32c_neon_fold(crc, data, n, residue);
+	kernel_neon_end();
+
+	crc = __crc32c_le(0, residue, sizeof(residue));
+	return __crc32c_le(crc, data + n, len - n);
+}
+
+static int crc32c_neon_init(struct shash_desc *desc)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = mctx->key;
+
+	return 0;
+}
+
+static int crc32c_neon_setkey(struct crypto_shash *tfm, const u8 *key,
+			      unsigned int keylen)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(tfm);
+
+	if (keylen != sizeof(mctx->key)) {
+		crypto_shash_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	mctx->key = le32_to_cpu(*(__le32 *)key);
+	return 0;
+}
+
+static int crc32c_neon_update(struct shash_desc *desc, const u8 *data,
+			      unsigned int len)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = crc32c_neon(ctx->crc, data, len);
+	return 0;
+}
+
+static int crc32c_neon_final(struct shash_desc *desc, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*(__le32 *)out = ~cpu_to_le32p(&ctx->crc);
+	return 0;
+}
+
+static int __crc32c_neon_finup(u32 *crcp, const u8 *data, unsigned int len,
+			       u8 *out)
+{
+	*(__le32 *)out = ~cpu_to_le32(crc32c_neon(*crcp, data, len));
+	return 0;
+}
+
+static int crc32c_neon_finup(struct shash_desc *desc, const u8 *data,
+			     unsigned int len, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	return __crc32c_neon_finup(&ctx->crc, data, len, out);
+}
+
+static int crc32c_neon_digest(struct shash_desc *desc, const u8 *data,
+			      unsigned int len, u8 *out)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+
+	return __crc32c_neon_finup(&mctx->key, data, len, out);
+}
+
+static int crc32c_neon_cra_init(struct crypto_tfm *tfm)
+{
+	struct chksum_ctx *mctx = crypto_tfm_ctx(tfm);
+
+	mctx->key = ~0;
+	return 0;
+}
+
+static struct shash_alg crc32c_neon_alg = {
+	.digestsize	=	CHKSUM_DIGEST_SIZE,
+	.setkey		=	crc32c_neon_setkey,
+	.init		=	crc32c_neon_init,
+	.update		=	crc32c_neon_update,
+	.final		=	crc32c_neon_final,
+	.finup		=	crc32c_neon_finup,
+	.digest		=	crc32c_neon_digest,
+	.descsize	=	sizeof(struct chksum_desc_ctx),
+	.base		=	{
+		.cra_name		=	"crc32c",
+		.cra_driver_name	=	"crc32c-arm-neon",
+		.cra_priority		=	200,
+		.cra_blocksize		=	CHKSUM_BLOCK_SIZE,
+		.cra_alignmask		=	3,
+		.cra_ctxsize		=	sizeof(struct chksum_ctx),
+		.cra_module		=	THIS_MODULE,
+		.cra_init		=	crc32c_neon_cra_init,
+	}
+};
+
+static int __init crc32c_neon_mod_init(void)
+{
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	return crypto_register_shash(&crc32c_neon_alg);
+}
+
+static void __exit crc32c_neon_mod_fini(void)
+{
+	crypto_unregister_shash(&crc32c_neon_alg);
+}
+
+module_init(crc32c_neon_mod_init);
+module_exit(crc32c_neon_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("CRC32c (Castagnoli) checksum using NEON polynomial multiplies");
+MODULE_ALIAS("crc32c");
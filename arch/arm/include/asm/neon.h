@@ -0,0 +1,28 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_NEON_H
+#define __ASM_NEON_H
+
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * NEON code must live in its own compilation unit, built with
+ * -mfpu=neon, and be called from a unit built without it between
+ * kernel_neon_begin() and kernel_neon_end(). Otherwise the compiler is
+ * free to emit NEON instructions outside of that window. Units built
+ * with NEON code generation do not get the declaration, so that mixing
+ * both fails to build.
+ */
+#ifndef __ARM_NEON__
+void kernel_neon_begin(void);
+#endif
+void kernel_neon_end(void);
+
+#endif /* __ASM_NEON_H */
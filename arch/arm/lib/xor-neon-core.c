@@ -0,0 +1,127 @@
+/*
+ *  linux/arch/arm/lib/xor-neon-core.c
+ *
+ *  RAID-5 checksumming functions using NEON
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Each line is 64 bytes, four q registers per source. The caller runs
+ * these between kernel_neon_begin() and kernel_neon_end(), and like the
+ * other NEON units this one does not include kernel headers, the
+ * template using it is in xor-neon-glue.c.
+ */
+
+#include <arm_neon.h>
+
+#define LINE	64
+
+#define LOAD(v, p)						\
+	do {							\
+		v##0 = vld1q_u8((p) + 0);			\
+		v##1 = vld1q_u8((p) + 16);			\
+		v##2 = vld1q_u8((p) + 32);			\
+		v##3 = vld1q_u8((p) + 48);			\
+	} while (0)
+
+#define XOR(v, p)						\
+	do {							\
+		v##0 = veorq_u8(v##0, vld1q_u8((p) + 0));	\
+		v##1 = veorq_u8(v##1, vld1q_u8((p) + 16));	\
+		v##2 = veorq_u8(v##2, vld1q_u8((p) + 32));	\
+		v##3 = veorq_u8(v##3, vld1q_u8((p) + 48));	\
+	} while (0)
+
+#define STORE(v, p)						\
+	do {							\
+		vst1q_u8((p) + 0, v##0);			\
+		vst1q_u8((p) + 16, v##1);			\
+		vst1q_u8((p) + 32, v##2);			\
+		vst1q_u8((p) + 48, v##3);			\
+	} while (0)
+
+void xor_neon_2(unsigned long bytes, unsigned long *p1, unsigned long *p2)
+{
+	uint8_t *d = (uint8_t *)p1;
+	const uint8_t *s1 = (const uint8_t *)p2;
+	long lines = bytes / LINE;
+	uint8x16_t v0, v1, v2, v3;
+
+	do {
+		LOAD(v, d);
+		XOR(v, s1);
+		STORE(v, d);
+		d += LINE;
+		s1 += LINE;
+	} while (--lines > 0);
+}
+
+void xor_neon_3(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+		unsigned long *p3)
+{
+	uint8_t *d = (uint8_t *)p1;
+	const uint8_t *s1 = (const uint8_t *)p2;
+	const uint8_t *s2 = (const uint8_t *)p3;
+	long lines = bytes / LINE;
+	uint8x16_t v0, v1, v2, v3;
+
+	do {
+		LOAD(v, d);
+		XOR(v, s1);
+		XOR(v, s2);
+		STORE(v, d);
+		d += LINE;
+		s1 += LINE;
+		s2 += LINE;
+	} while (--lines > 0);
+}
+
+void xor_neon_4(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+		unsigned long *p3, unsigned long *p4)
+{
+	uint8_t *d = (uint8_t *)p1;
+	const uint8_t *s1 = (const uint8_t *)p2;
+	const uint8_t *s2 = (const uint8_t *)p3;
+	const uint8_t *s3 = (const uint8_t *)p4;
+	long lines = bytes / LINE;
+	uint8x16_t v0, v1, v2, v3;
+
+	do {
+		LOAD(v, d);
+		XOR(v, s1);
+		XOR(v, s2);
+		XOR(v, s3);
+		STORE(v, d);
+		d += LINE;
+		s1 += LINE;
+		s2 += LINE;
+		s3 += LINE;
+	} while (--lines > 0);
+}
+
+void xor_neon_5(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+		unsigned long *p3, unsigned long *p4, unsigned long *p5)
+{
+	uint8_t *d = (uint8_t *)p1;
+	const uint8_t *s1 = (const uint8_t *)p2;
+	const uint8_t *s2 = (const uint8_t *)p3;
+	const uint8_t *s3 = (const uint8_t *)p4;
+	const uint8_t *s4 = (const uint8_t *)p5;
+	long lines = bytes / LINE;
+	uint8x16_t v0, v1, v2, v3;
+
+	do {
+		LOAD(v, d);
+		XOR(v, s1);
+		XOR(v, s2);
+		XOR(v, s3);
+		XOR(v, s4);
+		STORE(v, d);
+		d += LINE;
+		s1 += LINE;
+		s2 += LINE;
+		s3 += LINE;
+		s4 += LINE;
+	} while (--lines > 0);
+}
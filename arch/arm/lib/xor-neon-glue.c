@@ -0,0 +1,32 @@
+/*
+ *  linux/arch/arm/lib/xor-neon-glue.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/raid/xor.h>
+
+/* in xor-neon-core.c, built for NEON */
+void xor_neon_2(unsigned long bytes, unsigned long *p1, unsigned long *p2);
+void xor_neon_3(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+		unsigned long *p3);
+void xor_neon_4(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+		unsigned long *p3, unsigned long *p4);
+void xor_neon_5(unsigned long bytes, unsigned long *p1, unsigned long *p2,
+		unsigned long *p3, unsigned long *p4, unsigned long *p5);
+
+/* Only the functions are used, asm/xor.h wraps them in the real template */
+struct xor_block_template const xor_block_neon_inner = {
+	.name	= "__inner_neon__",
+	.do_2	= xor_neon_2,
+	.do_3	= xor_neon_3,
+	.do_4	= xor_neon_4,
+	.do_5	= xor_neon_5,
+};
+EXPORT_SYMBOL(xor_block_neon_inner);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("NEON RAID-5 checksumming functions");
@@ -0,0 +1,441 @@
+/*
+ * Software async compression daemon.
+ *
+ * Runs the synchronous "compress" algorithms (lzo, lz4, deflate, ...) as
+ * acomp algorithms. Requests are spread over the online CPUs and executed
+ * from per-CPU queues on the crypto workqueue, each worker run taking a
+ * batch of requests off its queue at once.
+ *
+ * Based on cryptd.c, Copyright (c) 2006 Herbert Xu <herbert@gondor.apana.org.au>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/crypto_wq.h>
+#include <crypto/internal/acompress.h>
+#include <crypto/scatterwalk.h>
+#include <linux/atomic.h>
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+
+#define ACOMPD_MAX_CPU_QLEN	100
+#define ACOMPD_BATCH		16
+
+struct acompd_cpu_queue {
+	spinlock_t lock;
+	struct crypto_queue queue;
+	struct work_struct work;
+};
+
+struct acompd_queue {
+	struct acompd_cpu_queue __percpu *cpu_queue;
+	atomic_t next_cpu;
+};
+
+/*
+ * The synchronous algorithms keep their working memory in the tfm, so
+ * every CPU gets its own child, with scratch buffers to linearise
+ * scattered source and destination data.
+ */
+struct acompd_child {
+	struct mutex lock;
+	struct crypto_comp *tfm;
+	void *src_buf;
+	void *dst_buf;
+	unsigned int src_size;
+	unsigned int dst_size;
+};
+
+struct acompd_ctx {
+	struct acompd_child __percpu *child;
+};
+
+struct acompd_request_ctx {
+	crypto_completion_t complete;
+};
+
+static struct acompd_queue queue;
+
+static void acompd_queue_worker(struct work_struct *work);
+
+static int acompd_init_queue(struct acompd_queue *queue,
+			     unsigned int max_cpu_qlen)
+{
+	int cpu;
+	struct acompd_cpu_queue *cpu_queue;
+
+	queue->cpu_queue = alloc_percpu(struct acompd_cpu_queue);
+	if (!queue->cpu_queue)
+		return -ENOMEM;
+	for_each_possible_cpu(cpu) {
+		cpu_queue = per_cpu_ptr(queue->cpu_queue, cpu);
+		spin_lock_init(&cpu_queue->lock);
+		crypto_init_queue(&cpu_queue->queue, max_cpu_qlen);
+		INIT_WORK(&cpu_queue->work, acompd_queue_worker);
+	}
+	atomic_set(&queue->next_cpu, 0);
+	return 0;
+}
+
+static void acompd_fini_queue(struct acompd_queue *queue)
+{
+	int cpu;
+	struct acompd_cpu_queue *cpu_queue;
+
+	for_each_possible_cpu(cpu) {
+		cpu_queue = per_cpu_ptr(queue->cpu_queue, cpu);
+		BUG_ON(cpu_queue->queue.qlen);
+	}
+	free_percpu(queue->cpu_queue);
+}
+
+/* Round robin over the online CPUs, so a burst of requests runs in parallel */
+static int acompd_next_cpu(struct acompd_queue *queue)
+{
+	unsigned int n;
+	int cpu;
+
+	n = (unsigned int)atomic_inc_return(&queue->next_cpu) %
+	    num_online_cpus();
+
+	cpu = cpumask_first(cpu_online_mask);
+	while (n--)
+		cpu = cpumask_next(cpu, cpu_online_mask);
+
+	return cpu < nr_cpu_ids ? cpu : smp_processor_id();
+}
+
+static int acompd_enqueue_request(struct acompd_queue *queue,
+				  struct crypto_async_request *request)
+{
+	struct acompd_cpu_queue *cpu_queue;
+	int cpu, err;
+
+	cpu = get_cpu();
+	if (num_online_cpus() > 1)
+		cpu = acompd_next_cpu(queue);
+	cpu_queue = per_cpu_ptr(queue->cpu_queue, cpu);
+
+	spin_lock_bh(&cpu_queue->lock);
+	err = crypto_enqueue_request(&cpu_queue->queue, request);
+	spin_unlock_bh(&cpu_queue->lock);
+
+	queue_work_on(cpu, kcrypto_wq, &cpu_queue->work);
+	put_cpu();
+
+	return err;
+}
+
+/*
+ * Called in workqueue context. Unlike cryptd, which handles one request
+ * per run, take up to ACOMPD_BATCH requests off the queue under a single
+ * lock round trip and run them back to back. Compression is expensive
+ * enough that the batch bounds the time spent per run well enough, and
+ * the worker requeues itself if there is more.
+ */
+static void acompd_queue_worker(struct work_struct *work)
+{
+	struct crypto_async_request *req[ACOMPD_BATCH];
+	struct crypto_async_request *backlog[ACOMPD_BATCH];
+	struct acompd_cpu_queue *cpu_queue;
+	unsigned int i, n;
+	bool more;
+
+	cpu_queue = container_of(work, struct acompd_cpu_queue, work);
+
+	spin_lock_bh(&cpu_queue->lock);
+	for (n = 0; n < ACOMPD_BATCH; n++) {
+		backlog[n] = crypto_get_backlog(&cpu_queue->queue);
+		req[n] = crypto_dequeue_request(&cpu_queue->queue);
+		if (!req[n])
+			break;
+	}
+	more = cpu_queue->queue.qlen;
+	spin_unlock_bh(&cpu_queue->lock);
+
+	for (i = 0; i < n; i++) {
+		if (backlog[i])
+			backlog[i]->complete(backlog[i], -EINPROGRESS);
+		req[i]->complete(req[i], 0);
+	}
+
+	if (more)
+		queue_work(kcrypto_wq, &cpu_queue->work);
+}
+
+static int acompd_scratch(void **buf, unsigned int *size, unsigned int len)
+{
+	if (*size >= len)
+		return 0;
+
+	vfree(*buf);
+	*size = 0;
+	*buf = vmalloc(len);
+	if (!*buf)
+		return -ENOMEM;
+
+	*size = len;
+	return 0;
+}
+
+/* A single lowmem entry covering the data is used in place */
+static void *acompd_linear(struct scatterlist *sg, unsigned int len)
+{
+	if (sg->length < len || PageHighMem(sg_page(sg)))
+		return NULL;
+
+	return sg_virt(sg);
+}
+
+static int acompd_run(struct acompd_child *child, struct acomp_req *req,
+		      bool decompress)
+{
+	unsigned int dlen = req->dlen;
+	const u8 *src;
+	u8 *dst;
+	int err;
+
+	src = acompd_linear(req->src, req->slen);
+	if (!src) {
+		err = acompd_scratch(&child->src_buf, &child->src_size,
+				     req->slen);
+		if (err)
+			return err;
+		scatterwalk_map_and_copy(child->src_buf, req->src, 0,
+					 req->slen, 0);
+		src = child->src_buf;
+	}
+
+	dst = acompd_linear(req->dst, req->dlen);
+	if (!dst) {
+		err = acompd_scratch(&child->dst_buf, &child->dst_size,
+				     req->dlen);
+		if (err)
+			return err;
+	}
+
+	if (decompress)
+		err = crypto_comp_decompress(child->tfm, src, req->slen,
+					     dst ?: child->dst_buf, &dlen);
+	else
+		err = crypto_comp_compress(child->tfm, src, req->slen,
+					   dst ?: child->dst_buf, &dlen);
+	if (err)
+		return err;
+
+	if (!dst)
+		scatterwalk_map_and_copy(child->dst_buf, req->dst, 0, dlen, 1);
+
+	req->dlen = dlen;
+	return 0;
+}
+
+static void acompd_crypt(struct acomp_req *req, int err, bool decompress)
+{
+	struct acompd_request_ctx *rctx = acomp_request_ctx(req);
+	struct acompd_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+	struct acompd_child *child;
+
+	if (unlikely(err == -EINPROGRESS))
+		goto out;
+
+	/* The worker is bound, the lock only matters across CPU hotplug */
+	child = per_cpu_ptr(ctx->child, raw_smp_processor_id());
+	mutex_lock(&child->lock);
+	err = acompd_run(child, req, decompress);
+	mutex_unlock(&child->lock);
+
+	req->base.complete = rctx->complete;
+
+out:
+	local_bh_disable();
+	rctx->complete(&req->base, err);
+	local_bh_enable();
+}
+
+static void acompd_compress(struct crypto_async_request *req, int err)
+{
+	acompd_crypt(acomp_request_cast(req), err, false);
+}
+
+static void acompd_decompress(struct crypto_async_request *req, int err)
+{
+	acompd_crypt(acomp_request_cast(req), err, true);
+}
+
+static int acompd_enqueue(struct acomp_req *req, crypto_completion_t complete)
+{
+	struct acompd_request_ctx *rctx = acomp_request_ctx(req);
+
+	rctx->complete = req->base.complete;
+	req->base.complete = complete;
+
+	return acompd_enqueue_request(&queue, &req->base);
+}
+
+static int acompd_compress_enqueue(struct acomp_req *req)
+{
+	return acompd_enqueue(req, acompd_compress);
+}
+
+static int acompd_decompress_enqueue(struct acomp_req *req)
+{
+	return acompd_enqueue(req, acompd_decompress);
+}
+
+static void acompd_free_children(struct acompd_ctx *ctx)
+{
+	struct acompd_child *child;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		child = per_cpu_ptr(ctx->child, cpu);
+		if (child->tfm)
+			crypto_free_comp(child->tfm);
+		vfree(child->src_buf);
+		vfree(child->dst_buf);
+	}
+	free_percpu(ctx->child);
+}
+
+static int acompd_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct crypto_spawn *spawn = crypto_instance_ctx(inst);
+	struct acompd_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct acompd_child *child;
+	struct crypto_tfm *comp;
+	int cpu;
+
+	ctx->child = alloc_percpu(struct acompd_child);
+	if (!ctx->child)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		child = per_cpu_ptr(ctx->child, cpu);
+		mutex_init(&child->lock);
+
+		comp = crypto_spawn_tfm(spawn, CRYPTO_ALG_TYPE_COMPRESS,
+					  CRYPTO_ALG_TYPE_MASK);
+		if (IS_ERR(comp)) {
+			acompd_free_children(ctx);
+			return PTR_ERR(comp);
+		}
+		child->tfm = __crypto_comp_cast(comp);
+	}
+
+	return 0;
+}
+
+static void acompd_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct acompd_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	acompd_free_children(ctx);
+}
+
+static int acompd_create(struct crypto_template *tmpl, struct rtattr **tb)
+{
+	struct crypto_attr_type *algt;
+	struct acomp_instance *inst;
+	struct crypto_spawn *spawn;
+	struct crypto_alg *alg;
+	int err;
+
+	algt = crypto_get_attr_type(tb);
+	if (IS_ERR(algt))
+		return PTR_ERR(algt);
+
+	if ((algt->type ^ CRYPTO_ALG_TYPE_ACOMPRESS) & algt->mask)
+		return -EINVAL;
+
+	alg = crypto_get_attr_alg(tb, CRYPTO_ALG_TYPE_COMPRESS,
+				  CRYPTO_ALG_TYPE_MASK);
+	if (IS_ERR(alg))
+		return PTR_ERR(alg);
+
+	inst = crypto_alloc_instance2("acompd", alg, acomp_instance_headroom());
+	err = PTR_ERR(inst);
+	if (IS_ERR(inst))
+		goto out_put_alg;
+
+	spawn = acomp_instance_ctx(inst);
+	err = crypto_init_spawn(spawn, alg, acomp_crypto_instance(inst),
+				CRYPTO_ALG_TYPE_MASK);
+	if (err)
+		goto out_free_inst;
+
+	inst->alg.base.cra_flags = CRYPTO_ALG_ASYNC;
+	inst->alg.base.cra_priority = alg->cra_priority;
+	inst->alg.base.cra_ctxsize = sizeof(struct acompd_ctx);
+
+	inst->alg.base.cra_init = acompd_init_tfm;
+	inst->alg.base.cra_exit = acompd_exit_tfm;
+
+	inst->alg.compress = acompd_compress_enqueue;
+	inst->alg.decompress = acompd_decompress_enqueue;
+	inst->alg.reqsize = sizeof(struct acompd_request_ctx);
+
+	err = acomp_register_instance(tmpl, inst);
+	if (err) {
+		crypto_drop_spawn(spawn);
+out_free_inst:
+		kfree(inst);
+	}
+
+out_put_alg:
+	crypto_mod_put(alg);
+	return err;
+}
+
+static void acompd_free(struct crypto_instance *inst)
+{
+	crypto_drop_spawn(crypto_instance_ctx(inst));
+	kfree(acomp_instance(inst));
+}
+
+static struct crypto_template acompd_tmpl = {
+	.name = "acompd",
+	.create = acompd_create,
+	.free = acompd_free,
+	.module = THIS_MODULE,
+};
+
+static int __init acompd_init(void)
+{
+	int err;
+
+	err = acompd_init_queue(&queue, ACOMPD_MAX_CPU_QLEN);
+	if (err)
+		return err;
+
+	err = crypto_register_template(&acompd_tmpl);
+	if (err)
+		acompd_fini_queue(&queue);
+
+	return err;
+}
+
+static void __exit acompd_exit(void)
+{
+	crypto_unregister_template(&acompd_tmpl);
+	acompd_fini_queue(&queue);
+}
+
+module_init(acompd_init);
+module_exit(acompd_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Software async compression daemon");
@@ -0,0 +1,126 @@
+/*
+ * Cryptographic API.
+ *
+ * Asynchronous compression operations.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <linux/crypto.h>
+#include <linux/err.h>
+#include <linux/errno.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+
+#include <crypto/internal/acompress.h>
+
+#include "internal.h"
+
+static int crypto_acomp_init(struct crypto_tfm *tfm, u32 type, u32 mask)
+{
+	return 0;
+}
+
+static unsigned int crypto_acomp_extsize(struct crypto_alg *alg)
+{
+	return alg->cra_ctxsize;
+}
+
+static int crypto_acomp_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_acomp *acomp = __crypto_acomp_tfm(tfm);
+	struct acomp_alg *alg = crypto_acomp_alg(acomp);
+
+	acomp->compress = alg->compress;
+	acomp->decompress = alg->decompress;
+	acomp->reqsize = alg->reqsize;
+
+	return 0;
+}
+
+static void crypto_acomp_show(struct seq_file *m, struct crypto_alg *alg)
+	__attribute__ ((unused));
+static void crypto_acomp_show(struct seq_file *m, struct crypto_alg *alg)
+{
+	seq_printf(m, "type         : acomp\n");
+	seq_printf(m, "async        : %s\n", alg->cra_flags & CRYPTO_ALG_ASYNC ?
+					     "yes" : "no");
+}
+
+const struct crypto_type crypto_acomp_type = {
+	.extsize	= crypto_acomp_extsize,
+	.init		= crypto_acomp_init,
+	.init_tfm	= crypto_acomp_init_tfm,
+#ifdef CONFIG_PROC_FS
+	.show		= crypto_acomp_show,
+#endif
+	.maskclear	= ~CRYPTO_ALG_TYPE_MASK,
+	.maskset	= CRYPTO_ALG_TYPE_MASK,
+	.type		= CRYPTO_ALG_TYPE_ACOMPRESS,
+	.tfmsize	= offsetof(struct crypto_acomp, base),
+};
+EXPORT_SYMBOL_GPL(crypto_acomp_type);
+
+/*
+ * The synchronous "compress" algorithms are not acomp algorithms, if there
+ * is no native implementation of @alg_name fall back to running the
+ * synchronous one through the acompd template.
+ */
+struct crypto_acomp *crypto_alloc_acomp(const char *alg_name, u32 type,
+					u32 mask)
+{
+	char acompd_alg_name[CRYPTO_MAX_ALG_NAME];
+	struct crypto_acomp *tfm;
+
+	tfm = crypto_alloc_tfm(alg_name, &crypto_acomp_type, type, mask);
+	if (!IS_ERR(tfm) || PTR_ERR(tfm) != -ENOENT)
+		return tfm;
+
+	if (snprintf(acompd_alg_name, CRYPTO_MAX_ALG_NAME,
+		     "acompd(%s)", alg_name) >= CRYPTO_MAX_ALG_NAME)
+		return tfm;
+
+	return crypto_alloc_tfm(acompd_alg_name, &crypto_acomp_type, type,
+				mask);
+}
+EXPORT_SYMBOL_GPL(crypto_alloc_acomp);
+
+static void acomp_prepare_alg(struct acomp_alg *alg)
+{
+	struct crypto_alg *base = &alg->base;
+
+	base->cra_type = &crypto_acomp_type;
+	base->cra_flags &= ~CRYPTO_ALG_TYPE_MASK;
+	base->cra_flags |= CRYPTO_ALG_TYPE_ACOMPRESS;
+}
+
+int crypto_register_acomp(struct acomp_alg *alg)
+{
+	acomp_prepare_alg(alg);
+
+	return crypto_register_alg(&alg->base);
+}
+EXPORT_SYMBOL_GPL(crypto_register_acomp);
+
+int crypto_unregister_acomp(struct acomp_alg *alg)
+{
+	return crypto_unregister_alg(&alg->base);
+}
+EXPORT_SYMBOL_GPL(crypto_unregister_acomp);
+
+int acomp_register_instance(struct crypto_template *tmpl,
+			    struct acomp_instance *inst)
+{
+	acomp_prepare_alg(&inst->alg);
+
+	return crypto_register_instance(tmpl, acomp_crypto_instance(inst));
+}
+EXPORT_SYMBOL_GPL(acomp_register_instance);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Asynchronous compression type");
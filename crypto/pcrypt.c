@@ -20,6 +20,7 @@
 
 #include <crypto/algapi.h>
 #include <crypto/internal/aead.h>
+#include <crypto/internal/skcipher.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/module.h>
@@ -69,6 +70,11 @@ struct pcrypt_aead_ctx {
 	unsigned int cb_cpu;
 };
 
+struct pcrypt_blkcipher_ctx {
+	struct crypto_blkcipher *child;
+	unsigned int cb_cpu;
+};
+
 static int pcrypt_do_parallel(struct padata_priv *padata, unsigned int *cb_cpu,
 			      struct padata_pcrypt *pcrypt)
 {
@@ -270,21 +276,34 @@ static int pcrypt_aead_givencrypt(struct aead_givcrypt_request *req)
 	return err;
 }
 
-static int pcrypt_aead_init_tfm(struct crypto_tfm *tfm)
+/*
+ * Spread the serialization callbacks of the transforms of one instance
+ * round robin over the active CPUs.
+ */
+static unsigned int pcrypt_tfm_cb_cpu(struct pcrypt_instance_ctx *ictx)
 {
+	unsigned int cb_cpu;
 	int cpu, cpu_index;
-	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
-	struct pcrypt_instance_ctx *ictx = crypto_instance_ctx(inst);
-	struct pcrypt_aead_ctx *ctx = crypto_tfm_ctx(tfm);
-	struct crypto_aead *cipher;
 
 	ictx->tfm_count++;
 
 	cpu_index = ictx->tfm_count % cpumask_weight(cpu_active_mask);
 
-	ctx->cb_cpu = cpumask_first(cpu_active_mask);
+	cb_cpu = cpumask_first(cpu_active_mask);
 	for (cpu = 0; cpu < cpu_index; cpu++)
-		ctx->cb_cpu = cpumask_next(ctx->cb_cpu, cpu_active_mask);
+		cb_cpu = cpumask_next(cb_cpu, cpu_active_mask);
+
+	return cb_cpu;
+}
+
+static int pcrypt_aead_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct pcrypt_instance_ctx *ictx = crypto_instance_ctx(inst);
+	struct pcrypt_aead_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_aead *cipher;
+
+	ctx->cb_cpu = pcrypt_tfm_cb_cpu(ictx);
 
 	cipher = crypto_spawn_aead(crypto_instance_ctx(inst));
 
@@ -306,6 +325,134 @@ static void pcrypt_aead_exit_tfm(struct crypto_tfm *tfm)
 	crypto_free_aead(ctx->child);
 }
 
+static int pcrypt_blkcipher_setkey(struct crypto_ablkcipher *parent,
+				   const u8 *key, unsigned int keylen)
+{
+	struct pcrypt_blkcipher_ctx *ctx = crypto_ablkcipher_ctx(parent);
+	struct crypto_blkcipher *child = ctx->child;
+	int err;
+
+	crypto_blkcipher_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+	crypto_blkcipher_set_flags(child, crypto_ablkcipher_get_flags(parent) &
+					  CRYPTO_TFM_REQ_MASK);
+	err = crypto_blkcipher_setkey(child, key, keylen);
+	crypto_ablkcipher_set_flags(parent, crypto_blkcipher_get_flags(child) &
+					    CRYPTO_TFM_RES_MASK);
+	return err;
+}
+
+static void pcrypt_blkcipher_serial(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+
+	ablkcipher_request_complete(preq->data, padata->info);
+}
+
+static int pcrypt_blkcipher_do(struct ablkcipher_request *req, bool encrypt)
+{
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct pcrypt_blkcipher_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+	struct blkcipher_desc desc;
+
+	desc.tfm = ctx->child;
+	desc.info = req->info;
+	desc.flags = 0;
+
+	if (encrypt)
+		return crypto_blkcipher_encrypt_iv(&desc, req->dst, req->src,
+						   req->nbytes);
+	return crypto_blkcipher_decrypt_iv(&desc, req->dst, req->src,
+					   req->nbytes);
+}
+
+/*
+ * The child is a synchronous blkcipher, so the request is finished by the
+ * time it returns and padata_do_serial() is called on the CPU that ran the
+ * parallel callback, as padata requires.
+ */
+static void pcrypt_blkcipher_enc(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+
+	padata->info = pcrypt_blkcipher_do(preq->data, true);
+
+	padata_do_serial(padata);
+}
+
+static void pcrypt_blkcipher_dec(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+
+	padata->info = pcrypt_blkcipher_do(preq->data, false);
+
+	padata_do_serial(padata);
+}
+
+static int pcrypt_blkcipher_crypt(struct ablkcipher_request *req,
+				  bool encrypt, struct padata_pcrypt *pcrypt)
+{
+	int err;
+	struct pcrypt_request *preq = ablkcipher_request_ctx(req);
+	struct padata_priv *padata = pcrypt_request_padata(preq);
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct pcrypt_blkcipher_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+
+	memset(padata, 0, sizeof(struct padata_priv));
+
+	padata->parallel = encrypt ? pcrypt_blkcipher_enc :
+				     pcrypt_blkcipher_dec;
+	padata->serial = pcrypt_blkcipher_serial;
+	preq->data = req;
+
+	err = pcrypt_do_parallel(padata, &ctx->cb_cpu, pcrypt);
+	if (!err)
+		return -EINPROGRESS;
+
+	/*
+	 * padata refuses with -EBUSY when the instance is full or being
+	 * reset, without queueing anything.  Callers that set MAY_BACKLOG
+	 * take -EBUSY as "backlogged" and wait for a completion that never
+	 * comes, so do the request here instead.
+	 */
+	return pcrypt_blkcipher_do(req, encrypt);
+}
+
+static int pcrypt_blkcipher_encrypt(struct ablkcipher_request *req)
+{
+	return pcrypt_blkcipher_crypt(req, true, &pencrypt);
+}
+
+static int pcrypt_blkcipher_decrypt(struct ablkcipher_request *req)
+{
+	return pcrypt_blkcipher_crypt(req, false, &pdecrypt);
+}
+
+static int pcrypt_blkcipher_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct pcrypt_instance_ctx *ictx = crypto_instance_ctx(inst);
+	struct pcrypt_blkcipher_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_blkcipher *cipher;
+
+	ctx->cb_cpu = pcrypt_tfm_cb_cpu(ictx);
+
+	cipher = crypto_spawn_blkcipher(&ictx->spawn);
+	if (IS_ERR(cipher))
+		return PTR_ERR(cipher);
+
+	ctx->child = cipher;
+	tfm->crt_ablkcipher.reqsize = sizeof(struct pcrypt_request);
+
+	return 0;
+}
+
+static void pcrypt_blkcipher_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct pcrypt_blkcipher_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_blkcipher(ctx->child);
+}
+
 static struct crypto_instance *pcrypt_alloc_instance(struct crypto_alg *alg)
 {
 	struct crypto_instance *inst;
@@ -381,6 +528,42 @@ out_put_alg:
 	return inst;
 }
 
+static struct crypto_instance *pcrypt_alloc_blkcipher(struct rtattr **tb)
+{
+	struct crypto_instance *inst;
+	struct crypto_alg *alg;
+
+	alg = crypto_get_attr_alg(tb, CRYPTO_ALG_TYPE_BLKCIPHER,
+				  CRYPTO_ALG_TYPE_MASK);
+	if (IS_ERR(alg))
+		return ERR_CAST(alg);
+
+	inst = pcrypt_alloc_instance(alg);
+	if (IS_ERR(inst))
+		goto out_put_alg;
+
+	inst->alg.cra_flags = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC;
+	inst->alg.cra_type = &crypto_ablkcipher_type;
+
+	inst->alg.cra_ablkcipher.ivsize = alg->cra_blkcipher.ivsize;
+	inst->alg.cra_ablkcipher.min_keysize = alg->cra_blkcipher.min_keysize;
+	inst->alg.cra_ablkcipher.max_keysize = alg->cra_blkcipher.max_keysize;
+	inst->alg.cra_ablkcipher.geniv = alg->cra_blkcipher.geniv;
+
+	inst->alg.cra_ctxsize = sizeof(struct pcrypt_blkcipher_ctx);
+
+	inst->alg.cra_init = pcrypt_blkcipher_init_tfm;
+	inst->alg.cra_exit = pcrypt_blkcipher_exit_tfm;
+
+	inst->alg.cra_ablkcipher.setkey = pcrypt_blkcipher_setkey;
+	inst->alg.cra_ablkcipher.encrypt = pcrypt_blkcipher_encrypt;
+	inst->alg.cra_ablkcipher.decrypt = pcrypt_blkcipher_decrypt;
+
+out_put_alg:
+	crypto_mod_put(alg);
+	return inst;
+}
+
 static struct crypto_instance *pcrypt_alloc(struct rtattr **tb)
 {
 	struct crypto_attr_type *algt;
@@ -392,6 +575,8 @@ static struct crypto_instance *pcrypt_alloc(struct rtattr **tb)
 	switch (algt->type & algt->mask & CRYPTO_ALG_TYPE_MASK) {
 	case CRYPTO_ALG_TYPE_AEAD:
 		return pcrypt_alloc_aead(tb, algt->type, algt->mask);
+	case CRYPTO_ALG_TYPE_BLKCIPHER:
+		return pcrypt_alloc_blkcipher(tb);
 	}
 
 	return ERR_PTR(-EINVAL);
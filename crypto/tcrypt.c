@@ -22,12 +22,15 @@
  *
  */
 
+#include <crypto/acompress.h>
 #include <crypto/hash.h>
+#include <linux/atomic.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/gfp.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/moduleparam.h>
 #include <linux/jiffies.h>
@@ -719,6 +722,244 @@ out:
 	crypto_free_ahash(tfm);
 }
 
+/* room for incompressible pages to expand */
+#define ACOMP_SPEED_CBUF	(2 * PAGE_SIZE)
+
+struct tcrypt_batch {
+	struct completion completion;
+	atomic_t pending;
+	int err;
+};
+
+struct acomp_speed_slot {
+	struct acomp_req *req;
+	struct scatterlist src;
+	struct scatterlist dst;
+	char *cbuf;
+	char *dbuf;
+	unsigned int clen;
+};
+
+static void tcrypt_batch_complete(struct crypto_async_request *req, int err)
+{
+	struct tcrypt_batch *batch = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+
+	if (err)
+		batch->err = err;
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->completion);
+}
+
+/*
+ * Submit one request per slot without waiting in between, then wait for
+ * the whole batch. Compression reads a page of tvmem, decompression the
+ * output of the last compression run.
+ */
+static int do_acomp_batch(struct acomp_speed_slot *slot, unsigned int n,
+			  int decompress, struct tcrypt_batch *batch)
+{
+	unsigned int i;
+	int ret;
+
+	/* one extra reference held until everything is submitted */
+	atomic_set(&batch->pending, n + 1);
+	batch->err = 0;
+	INIT_COMPLETION(batch->completion);
+
+	for (i = 0; i < n; i++) {
+		struct acomp_req *req = slot[i].req;
+
+		if (decompress) {
+			sg_init_one(&slot[i].src, slot[i].cbuf, slot[i].clen);
+			sg_init_one(&slot[i].dst, slot[i].dbuf, PAGE_SIZE);
+			acomp_request_set_params(req, &slot[i].src,
+						 &slot[i].dst, slot[i].clen,
+						 PAGE_SIZE);
+			ret = crypto_acomp_decompress(req);
+		} else {
+			sg_init_one(&slot[i].src, tvmem[i % TVMEMSIZE],
+				    PAGE_SIZE);
+			sg_init_one(&slot[i].dst, slot[i].cbuf,
+				    ACOMP_SPEED_CBUF);
+			acomp_request_set_params(req, &slot[i].src,
+						 &slot[i].dst, PAGE_SIZE,
+						 ACOMP_SPEED_CBUF);
+			ret = crypto_acomp_compress(req);
+		}
+
+		if (ret == -EINPROGRESS || ret == -EBUSY)
+			continue;
+		if (ret)
+			batch->err = ret;
+		atomic_dec(&batch->pending);
+	}
+
+	if (!atomic_dec_and_test(&batch->pending))
+		wait_for_completion(&batch->completion);
+
+	if (batch->err)
+		return batch->err;
+
+	if (!decompress)
+		for (i = 0; i < n; i++)
+			slot[i].clen = slot[i].req->dlen;
+
+	return 0;
+}
+
+static int test_acomp_jiffies(struct acomp_speed_slot *slot, unsigned int n,
+			      int decompress, struct tcrypt_batch *batch,
+			      int sec)
+{
+	unsigned long start, end;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount++) {
+		ret = do_acomp_batch(slot, n, decompress, batch);
+		if (ret)
+			return ret;
+	}
+
+	pr_cont("%6u opers/sec, %9lu bytes/sec\n",
+		bcount * n / sec, ((long)bcount * n * PAGE_SIZE) / sec);
+
+	return 0;
+}
+
+static int test_acomp_cycles(struct acomp_speed_slot *slot, unsigned int n,
+			     int decompress, struct tcrypt_batch *batch)
+{
+	unsigned long cycles = 0;
+	int ret, i;
+
+	/* Warm-up run. */
+	for (i = 0; i < 4; i++) {
+		ret = do_acomp_batch(slot, n, decompress, batch);
+		if (ret)
+			goto out;
+	}
+
+	/* The real thing. */
+	for (i = 0; i < 8; i++) {
+		cycles_t start, end;
+
+		start = get_cycles();
+
+		ret = do_acomp_batch(slot, n, decompress, batch);
+		if (ret)
+			goto out;
+
+		end = get_cycles();
+
+		cycles += end - start;
+	}
+
+out:
+	if (ret)
+		return ret;
+
+	pr_cont("%6lu cycles/operation, %4lu cycles/byte\n",
+		cycles / (8 * n), cycles / (8 * n * PAGE_SIZE));
+
+	return 0;
+}
+
+/* Fill tvmem with text-like, compressible data */
+static void test_acomp_fill(void)
+{
+	unsigned int i, off;
+
+	for (i = 0; i < TVMEMSIZE; i++)
+		for (off = 0; off < PAGE_SIZE; )
+			off += scnprintf(tvmem[i] + off, PAGE_SIZE - off,
+					 "%u: the quick brown fox jumps over "
+					 "the lazy dog\n",
+					 (unsigned int)(i * PAGE_SIZE + off) *
+					 2654435761U);
+}
+
+static void test_acomp_speed(const char *algo, unsigned int sec,
+			     unsigned int *batch_sizes)
+{
+	struct acomp_speed_slot *slot;
+	struct tcrypt_batch batch;
+	struct crypto_acomp *tfm;
+	unsigned int i, max = 0;
+	int ret, decompress;
+
+	printk(KERN_INFO "\ntesting speed of async %s compression\n", algo);
+
+	tfm = crypto_alloc_acomp(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n",
+		       algo, PTR_ERR(tfm));
+		return;
+	}
+
+	for (i = 0; batch_sizes[i]; i++)
+		max = max(max, batch_sizes[i]);
+
+	slot = kcalloc(max, sizeof(*slot), GFP_KERNEL);
+	if (!slot) {
+		pr_err("acomp slot allocation failure\n");
+		goto out;
+	}
+
+	for (i = 0; i < max; i++) {
+		slot[i].req = acomp_request_alloc(tfm, GFP_KERNEL);
+		slot[i].cbuf = kmalloc(ACOMP_SPEED_CBUF, GFP_KERNEL);
+		slot[i].dbuf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		if (!slot[i].req || !slot[i].cbuf || !slot[i].dbuf) {
+			pr_err("acomp request allocation failure\n");
+			goto out_free;
+		}
+		acomp_request_set_callback(slot[i].req,
+					   CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   tcrypt_batch_complete, &batch);
+	}
+
+	init_completion(&batch.completion);
+	test_acomp_fill();
+
+	for (i = 0; batch_sizes[i]; i++) {
+		for (decompress = 0; decompress < 2; decompress++) {
+			pr_info("test%3u (%2u page batches, %s): ",
+				i, batch_sizes[i],
+				decompress ? "decompress" : "compress");
+
+			if (sec)
+				ret = test_acomp_jiffies(slot, batch_sizes[i],
+							 decompress, &batch,
+							 sec);
+			else
+				ret = test_acomp_cycles(slot, batch_sizes[i],
+							decompress, &batch);
+
+			if (ret) {
+				pr_err("%scompression failed ret=%d\n",
+				       decompress ? "de" : "", ret);
+				goto out_free;
+			}
+		}
+	}
+
+out_free:
+	for (i = 0; i < max; i++) {
+		kfree(slot[i].dbuf);
+		kfree(slot[i].cbuf);
+		if (slot[i].req)
+			acomp_request_free(slot[i].req);
+	}
+	kfree(slot);
+out:
+	crypto_free_acomp(tfm);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -1231,6 +1472,24 @@ static int do_test(int m)
 	case 499:
 		break;
 
+	case 500:
+		/* fall through */
+
+	case 501:
+		test_acomp_speed("lzo", sec, acomp_batch_template);
+		if (mode > 500 && mode < 600) break;
+
+	case 502:
+		test_acomp_speed("lz4", sec, acomp_batch_template);
+		if (mode > 500 && mode < 600) break;
+
+	case 503:
+		test_acomp_speed("deflate", sec, acomp_batch_template);
+		if (mode > 500 && mode < 600) break;
+
+	case 599:
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -112,4 +112,9 @@ static struct hash_speed hash_speed_template_16[] = {
 	{  .blen = 0,	.plen = 0,	.klen = 0, }
 };
 
+/*
+ * Compression speed tests, number of pages in flight per batch
+ */
+static unsigned int acomp_batch_template[] = { 1, 4, 16, 64, 0 };
+
 #endif	/* _CRYPTO_TCRYPT_H */
@@ -20,6 +20,7 @@
  *
  */
 
+#include <crypto/acompress.h>
 #include <crypto/hash.h>
 #include <linux/err.h>
 #include <linux/module.h>
@@ -1241,6 +1242,145 @@ static int test_pcomp(struct crypto_pcomp *tfm,
 }
 
 
+static int do_one_acomp_op(struct acomp_req *req, struct tcrypt_result *tr,
+			   int ret)
+{
+	if (ret == -EINPROGRESS || ret == -EBUSY) {
+		ret = wait_for_completion_interruptible(&tr->completion);
+		if (!ret)
+			ret = tr->err;
+		INIT_COMPLETION(tr->completion);
+	}
+	return ret;
+}
+
+/* Spread @len bytes over the end of xbuf[0] and the start of xbuf[1] */
+static void acomp_sg_split(struct scatterlist *sg, char *xbuf[2],
+			   const char *data, unsigned int len)
+{
+	unsigned int half = len / 2;
+	char *p = xbuf[0] + PAGE_SIZE - half;
+
+	if (data) {
+		memcpy(p, data, half);
+		memcpy(xbuf[1], data + half, len - half);
+	}
+
+	sg_init_table(sg, 2);
+	sg_set_buf(&sg[0], p, half);
+	sg_set_buf(&sg[1], xbuf[1], len - half);
+}
+
+/*
+ * Same vectors as test_comp(). Compression reads its input from two pages
+ * and decompression writes its output to two, so both the in place and the
+ * scattered paths of an implementation are covered.
+ */
+static int test_acomp(struct crypto_acomp *tfm, struct comp_testvec *ctemplate,
+		      struct comp_testvec *dtemplate, int ctcount, int dtcount)
+{
+	const char *algo = crypto_tfm_alg_driver_name(crypto_acomp_tfm(tfm));
+	struct scatterlist src[2], dst[2];
+	struct tcrypt_result result;
+	struct acomp_req *req;
+	char *xbuf[XBUFSIZE];
+	char *output;
+	unsigned int i;
+	int ret = -ENOMEM;
+
+	if (testmgr_alloc_buf(xbuf))
+		goto out_nobuf;
+
+	init_completion(&result.completion);
+
+	req = acomp_request_alloc(tfm, GFP_KERNEL);
+	if (!req) {
+		pr_err("alg: acomp: Failed to allocate request for %s\n", algo);
+		goto out_noreq;
+	}
+
+	acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+				   tcrypt_complete, &result);
+
+	for (i = 0; i < ctcount; i++) {
+		output = xbuf[2];
+		memset(output, 0, COMP_BUF_SIZE);
+
+		acomp_sg_split(src, xbuf, ctemplate[i].input,
+			       ctemplate[i].inlen);
+		sg_init_one(dst, output, COMP_BUF_SIZE);
+		acomp_request_set_params(req, src, dst, ctemplate[i].inlen,
+					 COMP_BUF_SIZE);
+
+		ret = do_one_acomp_op(req, &result,
+				      crypto_acomp_compress(req));
+		if (ret) {
+			pr_err("alg: acomp: compression failed on test %d "
+			       "for %s: ret=%d\n", i + 1, algo, -ret);
+			goto out;
+		}
+
+		if (req->dlen != ctemplate[i].outlen) {
+			pr_err("alg: acomp: Compression test %d failed for %s: "
+			       "output len = %d\n", i + 1, algo, req->dlen);
+			ret = -EINVAL;
+			goto out;
+		}
+
+		if (memcmp(output, ctemplate[i].output, req->dlen)) {
+			pr_err("alg: acomp: Compression test %d failed for "
+			       "%s\n", i + 1, algo);
+			hexdump(output, req->dlen);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < dtcount; i++) {
+		output = xbuf[5];
+		memset(output, 0, COMP_BUF_SIZE);
+
+		memcpy(xbuf[2], dtemplate[i].input, dtemplate[i].inlen);
+		sg_init_one(src, xbuf[2], dtemplate[i].inlen);
+		acomp_sg_split(dst, xbuf + 3, NULL, COMP_BUF_SIZE);
+		acomp_request_set_params(req, src, dst, dtemplate[i].inlen,
+					 COMP_BUF_SIZE);
+
+		ret = do_one_acomp_op(req, &result,
+				      crypto_acomp_decompress(req));
+		if (ret) {
+			pr_err("alg: acomp: decompression failed on test %d "
+			       "for %s: ret=%d\n", i + 1, algo, -ret);
+			goto out;
+		}
+
+		if (req->dlen != dtemplate[i].outlen) {
+			pr_err("alg: acomp: Decompression test %d failed for "
+			       "%s: output len = %d\n", i + 1, algo, req->dlen);
+			ret = -EINVAL;
+			goto out;
+		}
+
+		sg_copy_to_buffer(dst, 2, output, req->dlen);
+		if (memcmp(output, dtemplate[i].output, req->dlen)) {
+			pr_err("alg: acomp: Decompression test %d failed for "
+			       "%s\n", i + 1, algo);
+			hexdump(output, req->dlen);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	ret = 0;
+
+out:
+	acomp_request_free(req);
+out_noreq:
+	testmgr_free_buf(xbuf);
+out_nobuf:
+	return ret;
+}
+
 static int test_cprng(struct crypto_rng *tfm, struct cprng_testvec *template,
 		      unsigned int tcount)
 {
@@ -1389,12 +1529,38 @@ out:
 	return err;
 }
 
+static int alg_test_acomp(const struct alg_test_desc *desc,
+			  const char *driver, u32 type, u32 mask)
+{
+	struct crypto_acomp *tfm;
+	int err;
+
+	tfm = crypto_alloc_acomp(driver, type, mask);
+	if (IS_ERR(tfm)) {
+		pr_err("alg: acomp: Failed to load transform for %s: %ld\n",
+		       driver, PTR_ERR(tfm));
+		return PTR_ERR(tfm);
+	}
+
+	err = test_acomp(tfm, desc->suite.comp.comp.vecs,
+			 desc->suite.comp.decomp.vecs,
+			 desc->suite.comp.comp.count,
+			 desc->suite.comp.decomp.count);
+
+	crypto_free_acomp(tfm);
+	return err;
+}
+
 static int alg_test_comp(const struct alg_test_desc *desc, const char *driver,
 			 u32 type, u32 mask)
 {
 	struct crypto_comp *tfm;
 	int err;
 
+	/* native asynchronous implementations share the vectors */
+	if ((type & CRYPTO_ALG_TYPE_MASK) == CRYPTO_ALG_TYPE_ACOMPRESS)
+		return alg_test_acomp(desc, driver, type, mask);
+
 	tfm = crypto_alloc_comp(driver, type, mask);
 	if (IS_ERR(tfm)) {
 		printk(KERN_ERR "alg: comp: Failed to load transform for %s: "
@@ -1572,6 +1738,36 @@ static const struct alg_test_desc alg_test_descs[] = {
 				.count = 0
 			}
 		}
+	}, {
+		.alg = "acompd(deflate)",
+		.test = alg_test_acomp,
+		.suite = {
+			.comp = {
+				.comp = {
+					.vecs = deflate_comp_tv_template,
+					.count = DEFLATE_COMP_TEST_VECTORS
+				},
+				.decomp = {
+					.vecs = deflate_decomp_tv_template,
+					.count = DEFLATE_DECOMP_TEST_VECTORS
+				}
+			}
+		}
+	}, {
+		.alg = "acompd(lzo)",
+		.test = alg_test_acomp,
+		.suite = {
+			.comp = {
+				.comp = {
+					.vecs = lzo_comp_tv_template,
+					.count = LZO_COMP_TEST_VECTORS
+				},
+				.decomp = {
+					.vecs = lzo_decomp_tv_template,
+					.count = LZO_DECOMP_TEST_VECTORS
+				}
+			}
+		}
 	}, {
 		.alg = "ansi_cprng",
 		.test = alg_test_cprng,
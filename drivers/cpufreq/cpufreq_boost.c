@@ -0,0 +1,429 @@
+/*
+ * drivers/cpufreq/cpufreq_boost.c
+ *
+ * Governor independent frequency boost.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A boost is a frequency floor held for a given duration. It is applied
+ * by raising policy->min from a policy notifier, so every governor
+ * honors it the same way it honors a user set minimum: the governor gets
+ * CPUFREQ_GOV_LIMITS and jumps to the new minimum at once. Boosts come
+ * from input events, from userspace (e.g. on application launch) and from
+ * other kernel code through cpufreq_boost(); overlapping boosts keep the
+ * highest floor until the latest end.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/init.h>
+#include <linux/input.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpufreq_boost.h>
+
+#define DEFAULT_BOOST_DURATION_MS	500
+
+static DEFINE_SPINLOCK(boost_lock);
+static unsigned int boost_floor;	/* 0 when not boosted */
+static unsigned long boost_end;		/* jiffies */
+static ktime_t boost_start;		/* last raise of the floor */
+
+static struct timer_list boost_timer;
+static struct work_struct boost_work;
+
+/* Tunables, frequencies of 0 disable the source */
+static unsigned int input_boost_freq_val;
+static unsigned int input_boost_ms_val = DEFAULT_BOOST_DURATION_MS;
+static unsigned int pulse_boost_freq_val;
+static unsigned int pulse_boost_ms_val = DEFAULT_BOOST_DURATION_MS;
+
+/* Time from raising the floor to a cpu running at it */
+static DEFINE_PER_CPU(bool, boost_pending);
+static char latency_governor[CPUFREQ_NAME_LEN];
+static unsigned long latency_last_us;
+static unsigned long latency_max_us;
+
+static void __cpufreq_boost(const char *src, unsigned int freq,
+			    unsigned int duration_ms)
+{
+	unsigned long flags, end;
+	bool idle, raise = false, extend = false;
+	int cpu;
+
+	if (!freq || !duration_ms)
+		return;
+
+	end = jiffies + msecs_to_jiffies(duration_ms);
+
+	spin_lock_irqsave(&boost_lock, flags);
+	idle = !boost_floor;
+	if (freq > boost_floor) {
+		boost_floor = freq;
+		boost_start = ktime_get();
+		for_each_possible_cpu(cpu)
+			per_cpu(boost_pending, cpu) = true;
+		raise = true;
+	}
+	if (idle || time_after(end, boost_end)) {
+		boost_end = end;
+		extend = true;
+	}
+	/*
+	 * Input events come in streams, so only arm the timer when a boost
+	 * starts. It rearms itself if the end was pushed out meanwhile.
+	 */
+	if (idle)
+		mod_timer(&boost_timer, end);
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	if (raise || extend)
+		trace_cpufreq_boost(src, freq, duration_ms);
+	if (raise)
+		schedule_work(&boost_work);
+}
+
+/**
+ * cpufreq_boost - hold all cpus at or above a frequency for a while
+ * @freq: frequency floor in kHz, capped by the maximum of each policy
+ * @duration_ms: how long to hold it
+ *
+ * May be called from any context.
+ */
+void cpufreq_boost(unsigned int freq, unsigned int duration_ms)
+{
+	__cpufreq_boost("kernel", freq, duration_ms);
+}
+EXPORT_SYMBOL_GPL(cpufreq_boost);
+
+static void boost_timer_fn(unsigned long data)
+{
+	unsigned int floor;
+
+	spin_lock(&boost_lock);
+	/* Extended since the timer was armed */
+	if (time_before(jiffies, boost_end)) {
+		mod_timer(&boost_timer, boost_end);
+		spin_unlock(&boost_lock);
+		return;
+	}
+	floor = boost_floor;
+	boost_floor = 0;
+	spin_unlock(&boost_lock);
+
+	trace_cpufreq_boost_end(floor);
+	schedule_work(&boost_work);
+}
+
+/*
+ * A policy that already runs at the floor sees no transition, so there is
+ * no latency to measure for its cpus. Also clears everything once the
+ * boost has ended.
+ */
+static void boost_clear_reached(struct cpufreq_policy *policy)
+{
+	unsigned long flags;
+	unsigned int j;
+
+	spin_lock_irqsave(&boost_lock, flags);
+	if (policy->cur >= min(boost_floor, policy->max))
+		for_each_cpu(j, policy->cpus)
+			per_cpu(boost_pending, j) = false;
+	spin_unlock_irqrestore(&boost_lock, flags);
+}
+
+static void boost_work_fn(struct work_struct *work)
+{
+	unsigned int cpu;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		struct cpufreq_policy *policy = cpufreq_cpu_get(cpu);
+
+		if (!policy)
+			continue;
+		if (policy->cpu == cpu) {
+			cpufreq_update_policy(cpu);
+			boost_clear_reached(policy);
+		}
+		cpufreq_cpu_put(policy);
+	}
+	put_online_cpus();
+}
+
+static int boost_adjust_notify(struct notifier_block *nb, unsigned long val,
+			       void *data)
+{
+	struct cpufreq_policy *policy = data;
+	unsigned int floor;
+
+	if (val != CPUFREQ_ADJUST)
+		return NOTIFY_DONE;
+
+	floor = ACCESS_ONCE(boost_floor);
+	if (floor)
+		cpufreq_verify_within_limits(policy, min(floor, policy->max),
+					     policy->max);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block boost_adjust_nb = {
+	.notifier_call = boost_adjust_notify,
+};
+
+static int boost_transition_notify(struct notifier_block *nb,
+				   unsigned long val, void *data)
+{
+	struct cpufreq_freqs *freqs = data;
+	struct cpufreq_policy *policy;
+	unsigned long flags, latency_us;
+
+	if (val != CPUFREQ_POSTCHANGE)
+		return NOTIFY_DONE;
+
+	policy = cpufreq_cpu_get(freqs->cpu);
+	if (!policy)
+		return NOTIFY_OK;
+
+	/* The floor is capped by the policy maximum, see above */
+	spin_lock_irqsave(&boost_lock, flags);
+	if (!boost_floor || !per_cpu(boost_pending, freqs->cpu) ||
+	    freqs->new < min(boost_floor, policy->max)) {
+		spin_unlock_irqrestore(&boost_lock, flags);
+		goto out;
+	}
+	per_cpu(boost_pending, freqs->cpu) = false;
+	latency_us = ktime_to_us(ktime_sub(ktime_get(), boost_start));
+
+	if (policy->governor &&
+	    strncmp(latency_governor, policy->governor->name,
+		    CPUFREQ_NAME_LEN)) {
+		strlcpy(latency_governor, policy->governor->name,
+			CPUFREQ_NAME_LEN);
+		latency_max_us = 0;
+	}
+	latency_last_us = latency_us;
+	latency_max_us = max(latency_max_us, latency_us);
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	trace_cpufreq_boost_reached(freqs->cpu, freqs->new, latency_us);
+out:
+	cpufreq_cpu_put(policy);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block boost_transition_nb = {
+	.notifier_call = boost_transition_notify,
+};
+
+#ifdef CONFIG_INPUT
+static void boost_input_event(struct input_handle *handle,
+			      unsigned int type, unsigned int code, int value)
+{
+	__cpufreq_boost("input", input_boost_freq_val, input_boost_ms_val);
+}
+
+static int boost_input_connect(struct input_handler *handler,
+			       struct input_dev *dev,
+			       const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_boost";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return error;
+}
+
+static void boost_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+/* Touchscreens, touchpads and keys */
+static const struct input_device_id boost_input_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) |
+			    BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			    BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler boost_input_handler = {
+	.event		= boost_input_event,
+	.connect	= boost_input_connect,
+	.disconnect	= boost_input_disconnect,
+	.name		= "cpufreq_boost",
+	.id_table	= boost_input_ids,
+};
+#endif
+
+#define show_one(file_name)						\
+static ssize_t show_##file_name						\
+(struct kobject *kobj, struct attribute *attr, char *buf)		\
+{									\
+	return sprintf(buf, "%u\n", file_name##_val);			\
+}
+
+#define store_one(file_name)						\
+static ssize_t store_##file_name					\
+(struct kobject *kobj, struct attribute *attr,				\
+ const char *buf, size_t count)						\
+{									\
+	unsigned long val;						\
+	int ret;							\
+									\
+	ret = kstrtoul(buf, 0, &val);					\
+	if (ret < 0)							\
+		return ret;						\
+	file_name##_val = val;						\
+	return count;							\
+}
+
+show_one(input_boost_freq);
+store_one(input_boost_freq);
+define_one_global_rw(input_boost_freq);
+show_one(input_boost_ms);
+store_one(input_boost_ms);
+define_one_global_rw(input_boost_ms);
+show_one(pulse_boost_freq);
+store_one(pulse_boost_freq);
+define_one_global_rw(pulse_boost_freq);
+show_one(pulse_boost_ms);
+store_one(pulse_boost_ms);
+define_one_global_rw(pulse_boost_ms);
+
+/* Any write starts a pulse_boost_freq boost for pulse_boost_ms */
+static ssize_t store_boostpulse(struct kobject *kobj, struct attribute *attr,
+				const char *buf, size_t count)
+{
+	__cpufreq_boost("pulse", pulse_boost_freq_val, pulse_boost_ms_val);
+	return count;
+}
+
+static struct global_attr boostpulse =
+	__ATTR(boostpulse, 0200, NULL, store_boostpulse);
+
+static ssize_t show_latency(struct kobject *kobj, struct attribute *attr,
+			    char *buf)
+{
+	unsigned long flags;
+	ssize_t ret;
+
+	spin_lock_irqsave(&boost_lock, flags);
+	ret = sprintf(buf, "%s %lu %lu\n",
+		      latency_governor[0] ? latency_governor : "none",
+		      latency_last_us, latency_max_us);
+	spin_unlock_irqrestore(&boost_lock, flags);
+
+	return ret;
+}
+
+define_one_global_ro(latency);
+
+static struct attribute *boost_attributes[] = {
+	&input_boost_freq.attr,
+	&input_boost_ms.attr,
+	&pulse_boost_freq.attr,
+	&pulse_boost_ms.attr,
+	&boostpulse.attr,
+	&latency.attr,
+	NULL,
+};
+
+static struct attribute_group boost_attr_group = {
+	.attrs = boost_attributes,
+	.name = "boost",
+};
+
+static int __init cpufreq_boost_init(void)
+{
+	int rc;
+
+	setup_timer(&boost_timer, boost_timer_fn, 0);
+	INIT_WORK(&boost_work, boost_work_fn);
+
+	rc = cpufreq_register_notifier(&boost_adjust_nb,
+				       CPUFREQ_POLICY_NOTIFIER);
+	if (rc)
+		return rc;
+
+	rc = cpufreq_register_notifier(&boost_transition_nb,
+				       CPUFREQ_TRANSITION_NOTIFIER);
+	if (rc)
+		goto err_policy;
+
+	rc = sysfs_create_group(cpufreq_global_kobject, &boost_attr_group);
+	if (rc)
+		goto err_transition;
+
+#ifdef CONFIG_INPUT
+	rc = input_register_handler(&boost_input_handler);
+	if (rc)
+		pr_warn("cpufreq_boost: no input boost, error %d\n", rc);
+#endif
+
+	return 0;
+
+err_transition:
+	cpufreq_unregister_notifier(&boost_transition_nb,
+				    CPUFREQ_TRANSITION_NOTIFIER);
+err_policy:
+	cpufreq_unregister_notifier(&boost_adjust_nb,
+				    CPUFREQ_POLICY_NOTIFIER);
+	return rc;
+}
+
+late_initcall(cpufreq_boost_init);
@@ -0,0 +1,460 @@
+/*
+ * drivers/cpufreq/cpufreq_sched.c
+ *
+ * CPU frequency governor driven by the scheduler's utilization tracking.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Instead of sampling idle time from a timer, the scheduler calls into
+ * the governor whenever the decayed runnable average of a CPU crosses a
+ * period boundary: on enqueue, dequeue and from the tick.  The governor
+ * picks the frequency that would bring the utilization down to 80% of
+ * capacity and hands it to a realtime thread, since frequency drivers
+ * may sleep and the scheduler calls us with the runqueue locked.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/irq_work.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+/* Minimum time between two frequency changes of a policy */
+#define DEFAULT_RATE_LIMIT_US	10000
+#define MAX_RATE_LIMIT_US	(10 * USEC_PER_SEC)
+static unsigned int rate_limit_val = DEFAULT_RATE_LIMIT_US;
+
+struct sched_gov_policy {
+	struct cpufreq_policy *policy;
+
+	raw_spinlock_t update_lock;	/* for shared policies */
+	u64 last_freq_update_time;
+	unsigned int next_freq;
+	bool work_in_progress;
+
+	struct irq_work irq_work;
+	struct task_struct *thread;
+	struct mutex work_lock;		/* serializes driver calls */
+};
+
+struct sched_gov_cpu {
+	struct update_util_data update_util;
+	struct sched_gov_policy *sg_policy;
+
+	unsigned long util;
+	unsigned long max;
+	u64 last_update;
+};
+
+static DEFINE_PER_CPU(struct sched_gov_cpu, sched_gov_cpu);
+static DEFINE_MUTEX(gov_lock);
+static int active_count;
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+static
+#endif
+struct cpufreq_governor cpufreq_gov_sched = {
+	.name = "sched",
+	.governor = cpufreq_governor_sched,
+	.max_transition_latency = 10000000,
+	.owner = THIS_MODULE,
+};
+
+/*
+ * next_freq = 1.25 * cur * util / max
+ *
+ * The utilization is measured at the current frequency, so scaling the
+ * current frequency by it gives the frequency at which the same work
+ * would keep the CPU 80% busy.
+ */
+static unsigned int get_next_freq(struct cpufreq_policy *policy,
+				  unsigned long util, unsigned long max)
+{
+	unsigned int freq = policy->cur;
+	u64 next;
+
+	next = (u64)(freq + (freq >> 2)) * util;
+	do_div(next, max);
+
+	return clamp_t(unsigned int, next, policy->min, policy->max);
+}
+
+/* Highest request among the CPUs of the policy that are not idle */
+static unsigned int get_next_freq_shared(struct sched_gov_policy *sg_policy,
+					 u64 time)
+{
+	struct cpufreq_policy *policy = sg_policy->policy;
+	unsigned long util = 0, max = 1;
+	unsigned int j;
+
+	for_each_cpu(j, policy->cpus) {
+		struct sched_gov_cpu *j_sg_cpu = &per_cpu(sched_gov_cpu, j);
+		s64 delta_ns = time - j_sg_cpu->last_update;
+
+		/*
+		 * A CPU that has not updated its utilization for longer than
+		 * a tick has most likely been idle, do not let its stale value
+		 * hold the frequency up.
+		 */
+		if (delta_ns > TICK_NSEC)
+			continue;
+
+		if (j_sg_cpu->util * max > j_sg_cpu->max * util) {
+			util = j_sg_cpu->util;
+			max = j_sg_cpu->max;
+		}
+	}
+
+	return get_next_freq(policy, util, max);
+}
+
+static void sched_gov_update(struct update_util_data *data, u64 time,
+			     unsigned long util, unsigned long max)
+{
+	struct sched_gov_cpu *sg_cpu = container_of(data, struct sched_gov_cpu,
+						    update_util);
+	struct sched_gov_policy *sg_policy = sg_cpu->sg_policy;
+	unsigned int next_f;
+
+	raw_spin_lock(&sg_policy->update_lock);
+
+	sg_cpu->util = util;
+	sg_cpu->max = max;
+	sg_cpu->last_update = time;
+
+	if (sg_policy->work_in_progress)
+		goto out;
+
+	if (time - sg_policy->last_freq_update_time <
+	    (u64)rate_limit_val * NSEC_PER_USEC)
+		goto out;
+
+	next_f = get_next_freq_shared(sg_policy, time);
+	if (next_f == sg_policy->next_freq)
+		goto out;
+
+	sg_policy->next_freq = next_f;
+	sg_policy->last_freq_update_time = time;
+	sg_policy->work_in_progress = true;
+	irq_work_queue(&sg_policy->irq_work);
+out:
+	raw_spin_unlock(&sg_policy->update_lock);
+}
+
+/*
+ * We are called with the runqueue locked, so waking the frequency thread
+ * directly could deadlock. Bounce through an irq_work.
+ */
+static void sched_gov_irq_work(struct irq_work *irq_work)
+{
+	struct sched_gov_policy *sg_policy;
+
+	sg_policy = container_of(irq_work, struct sched_gov_policy, irq_work);
+	wake_up_process(sg_policy->thread);
+}
+
+static int sched_gov_thread(void *data)
+{
+	struct sched_gov_policy *sg_policy = data;
+	unsigned int next_freq;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop()) {
+			__set_current_state(TASK_RUNNING);
+			break;
+		}
+		if (!ACCESS_ONCE(sg_policy->work_in_progress)) {
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		mutex_lock(&sg_policy->work_lock);
+		next_freq = ACCESS_ONCE(sg_policy->next_freq);
+		if (next_freq != sg_policy->policy->cur)
+			__cpufreq_driver_target(sg_policy->policy, next_freq,
+						CPUFREQ_RELATION_L);
+		mutex_unlock(&sg_policy->work_lock);
+
+		/* Pairs with the check under update_lock */
+		smp_mb();
+		sg_policy->work_in_progress = false;
+	}
+
+	return 0;
+}
+
+static struct sched_gov_policy *sched_gov_policy_alloc(
+	struct cpufreq_policy *policy)
+{
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
+	struct sched_gov_policy *sg_policy;
+
+	sg_policy = kzalloc(sizeof(*sg_policy), GFP_KERNEL);
+	if (!sg_policy)
+		return NULL;
+
+	sg_policy->policy = policy;
+	raw_spin_lock_init(&sg_policy->update_lock);
+	mutex_init(&sg_policy->work_lock);
+	init_irq_work(&sg_policy->irq_work, sched_gov_irq_work);
+
+	sg_policy->thread = kthread_create(sched_gov_thread, sg_policy,
+					   "sched_gov/%d", policy->cpu);
+	if (IS_ERR(sg_policy->thread)) {
+		kfree(sg_policy);
+		return NULL;
+	}
+
+	sched_setscheduler_nocheck(sg_policy->thread, SCHED_FIFO, &param);
+	wake_up_process(sg_policy->thread);
+
+	return sg_policy;
+}
+
+static void sched_gov_policy_free(struct sched_gov_policy *sg_policy)
+{
+	irq_work_sync(&sg_policy->irq_work);
+	kthread_stop(sg_policy->thread);
+	kfree(sg_policy);
+}
+
+/*
+ * Point a cpu at its policy and install its utilization hook.  Called with
+ * gov_lock held, for cpus that are online.
+ */
+static void sched_gov_cpu_start(struct sched_gov_policy *sg_policy,
+				unsigned int cpu)
+{
+	struct sched_gov_cpu *sg_cpu = &per_cpu(sched_gov_cpu, cpu);
+	unsigned long flags;
+
+	/* Other cpus of a shared policy read these under update_lock */
+	raw_spin_lock_irqsave(&sg_policy->update_lock, flags);
+	sg_cpu->sg_policy = sg_policy;
+	sg_cpu->update_util.func = sched_gov_update;
+	sg_cpu->util = 0;
+	sg_cpu->max = SCHED_POWER_SCALE;
+	sg_cpu->last_update = 0;
+	raw_spin_unlock_irqrestore(&sg_policy->update_lock, flags);
+
+	cpufreq_set_update_util_data(cpu, &sg_cpu->update_util);
+}
+
+/*
+ * Remove the hooks of all cpus of a policy.  policy->cpus may have lost
+ * cpus that went offline meanwhile, so look for every cpu pointing at it.
+ */
+static void sched_gov_cpus_stop(struct sched_gov_policy *sg_policy)
+{
+	unsigned int j;
+
+	for_each_possible_cpu(j)
+		if (per_cpu(sched_gov_cpu, j).sg_policy == sg_policy)
+			cpufreq_set_update_util_data(j, NULL);
+
+	/* Wait for in flight updates to finish using sg_policy */
+	synchronize_sched();
+
+	for_each_possible_cpu(j)
+		if (per_cpu(sched_gov_cpu, j).sg_policy == sg_policy)
+			per_cpu(sched_gov_cpu, j).sg_policy = NULL;
+}
+
+/*
+ * The core drops an offlined cpu from policy->cpus without stopping the
+ * governor and adds it back on return without starting it, so the hooks of
+ * such cpus are handled here.  Runs after the core's own notifier.
+ */
+static int __cpuinit sched_gov_cpu_callback(struct notifier_block *nfb,
+					    unsigned long action, void *hcpu)
+{
+	unsigned int cpu = (unsigned long)hcpu;
+	struct sched_gov_policy *sg_policy;
+	struct cpufreq_policy *policy;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_ONLINE:
+	case CPU_DOWN_FAILED:
+		policy = cpufreq_cpu_get(cpu);
+		if (!policy)
+			break;
+
+		mutex_lock(&gov_lock);
+		sg_policy = per_cpu(sched_gov_cpu, policy->cpu).sg_policy;
+		if (policy->governor == &cpufreq_gov_sched && sg_policy)
+			sched_gov_cpu_start(sg_policy, cpu);
+		mutex_unlock(&gov_lock);
+
+		cpufreq_cpu_put(policy);
+		break;
+
+	case CPU_DOWN_PREPARE:
+		/* sg_policy stays set, GOV_STOP finds the cpu through it */
+		mutex_lock(&gov_lock);
+		cpufreq_set_update_util_data(cpu, NULL);
+		mutex_unlock(&gov_lock);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __refdata sched_gov_cpu_notifier = {
+	.notifier_call = sched_gov_cpu_callback,
+	.priority = -1,
+};
+
+static ssize_t show_rate_limit_us(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", rate_limit_val);
+}
+
+static ssize_t store_rate_limit_us(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (val > MAX_RATE_LIMIT_US)
+		return -EINVAL;
+	rate_limit_val = val;
+	return count;
+}
+
+define_one_global_rw(rate_limit_us);
+
+static struct attribute *sched_gov_attributes[] = {
+	&rate_limit_us.attr,
+	NULL,
+};
+
+static struct attribute_group sched_gov_attr_group = {
+	.attrs = sched_gov_attributes,
+	.name = "sched",
+};
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	struct sched_gov_policy *sg_policy;
+	unsigned int j;
+	int rc;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!cpu_online(policy->cpu))
+			return -EINVAL;
+
+		mutex_lock(&gov_lock);
+
+		sg_policy = sched_gov_policy_alloc(policy);
+		if (!sg_policy) {
+			mutex_unlock(&gov_lock);
+			return -ENOMEM;
+		}
+		sg_policy->next_freq = policy->cur;
+
+		/*
+		 * Do not register the global attributes more than once
+		 * when the governor starts on several policies.
+		 */
+		if (!active_count++) {
+			rc = sysfs_create_group(cpufreq_global_kobject,
+						&sched_gov_attr_group);
+			if (rc) {
+				active_count--;
+				sched_gov_policy_free(sg_policy);
+				mutex_unlock(&gov_lock);
+				return rc;
+			}
+		}
+
+		/* Offline cpus are picked up by sched_gov_cpu_callback() */
+		for_each_cpu(j, policy->cpus)
+			if (cpu_online(j))
+				sched_gov_cpu_start(sg_policy, j);
+
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		mutex_lock(&gov_lock);
+
+		sg_policy = per_cpu(sched_gov_cpu, policy->cpu).sg_policy;
+		if (sg_policy) {
+			sched_gov_cpus_stop(sg_policy);
+			sched_gov_policy_free(sg_policy);
+		}
+
+		if (!--active_count)
+			sysfs_remove_group(cpufreq_global_kobject,
+					   &sched_gov_attr_group);
+
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		sg_policy = per_cpu(sched_gov_cpu, policy->cpu).sg_policy;
+		if (!sg_policy)
+			break;
+
+		mutex_lock(&sg_policy->work_lock);
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->min, CPUFREQ_RELATION_L);
+		mutex_unlock(&sg_policy->work_lock);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_sched_init(void)
+{
+	int rc;
+
+	register_hotcpu_notifier(&sched_gov_cpu_notifier);
+	rc = cpufreq_register_governor(&cpufreq_gov_sched);
+	if (rc)
+		unregister_hotcpu_notifier(&sched_gov_cpu_notifier);
+	return rc;
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+fs_initcall(cpufreq_sched_init);
+#else
+module_init(cpufreq_sched_init);
+#endif
+
+static void __exit cpufreq_sched_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_sched);
+	unregister_hotcpu_notifier(&sched_gov_cpu_notifier);
+}
+
+module_exit(cpufreq_sched_exit);
+
+MODULE_DESCRIPTION("'cpufreq_sched' - cpufreq governor driven by scheduler "
+	"utilization tracking");
+MODULE_LICENSE("GPL");
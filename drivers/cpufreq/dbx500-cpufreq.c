@@ -11,8 +11,10 @@
 #include <linux/kernel.h>
 #include <linux/clk.h>
 #include <linux/cpufreq.h>
+#include <linux/sched.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/mfd/dbx500-prcmu.h>
 #include <mach/id.h>
 
@@ -22,6 +24,98 @@ static int freq_table_len;
 
 struct clk *arm_clk;
 
+/*
+ * Energy model for the scheduler. Both cores share arm_clk and its
+ * voltage, which roughly follows the frequency, so dynamic power grows
+ * with the cube of the frequency. On top of it comes the leakage that
+ * is also paid in WFI, until the cores are power gated. Busy power is
+ * scaled to 1000 at the highest OPP.
+ */
+#define DBX500_LEAKAGE_POWER	50
+
+static struct sched_capacity_state *dbx500_cap_states;
+
+static struct sched_idle_state dbx500_idle_states[] = {
+	{ .power = DBX500_LEAKAGE_POWER },	/* WFI */
+	{ .power = 0 },				/* power gated */
+};
+
+static struct sched_group_energy dbx500_energy = {
+	.nr_idle_states = ARRAY_SIZE(dbx500_idle_states),
+	.idle_states = dbx500_idle_states,
+};
+
+static int dbx500_cap_state_cmp(const void *a, const void *b)
+{
+	const struct sched_capacity_state *sa = a, *sb = b;
+
+	if (sa->cap == sb->cap)
+		return 0;
+	return sa->cap < sb->cap ? -1 : 1;
+}
+
+static void dbx500_cpufreq_register_energy(void)
+{
+	unsigned int max_freq = 0;
+	int i, nr = 0;
+
+	for (i = 0; i < freq_table_len; i++) {
+		if (freq_table[i].frequency == CPUFREQ_ENTRY_INVALID)
+			continue;
+		max_freq = max(max_freq, freq_table[i].frequency);
+		nr++;
+	}
+	if (!nr)
+		return;
+
+	dbx500_cap_states = kcalloc(nr, sizeof(*dbx500_cap_states),
+				    GFP_KERNEL);
+	if (!dbx500_cap_states)
+		return;
+
+	for (i = 0, nr = 0; i < freq_table_len; i++) {
+		u64 power;
+
+		if (freq_table[i].frequency == CPUFREQ_ENTRY_INVALID)
+			continue;
+
+		dbx500_cap_states[nr].cap = (u64)freq_table[i].frequency *
+			SCHED_POWER_SCALE / max_freq;
+		power = (u64)dbx500_cap_states[nr].cap *
+			dbx500_cap_states[nr].cap * dbx500_cap_states[nr].cap;
+		power *= 1000 - DBX500_LEAKAGE_POWER;
+		do_div(power, SCHED_POWER_SCALE * SCHED_POWER_SCALE *
+		       SCHED_POWER_SCALE);
+		dbx500_cap_states[nr].power = DBX500_LEAKAGE_POWER + power;
+		nr++;
+	}
+
+	/*
+	 * The scheduler expects the states in increasing capacity order,
+	 * nothing guarantees that for the platform's frequency table.
+	 */
+	sort(dbx500_cap_states, nr, sizeof(*dbx500_cap_states),
+	     dbx500_cap_state_cmp, NULL);
+
+	dbx500_energy.nr_cap_states = nr;
+	dbx500_energy.cap_states = dbx500_cap_states;
+	if (sched_energy_register(cpu_present_mask, &dbx500_energy)) {
+		kfree(dbx500_cap_states);
+		dbx500_cap_states = NULL;
+	}
+}
+
+static void dbx500_cpufreq_unregister_energy(void)
+{
+	if (!dbx500_cap_states)
+		return;
+
+	/* Detaching waits for the scheduler to stop using the model */
+	sched_energy_register(cpu_present_mask, NULL);
+	kfree(dbx500_cap_states);
+	dbx500_cap_states = NULL;
+}
+
 static struct freq_attr *dbx500_cpufreq_attr[] = {
 	&cpufreq_freq_attr_scaling_available_freqs,
 	NULL,
@@ -149,7 +243,13 @@ static int dbx500_cpu_freq_probe(struct platform_device *pdev)
 		ret = PTR_ERR(arm_clk);
 		return ret;
 	}
-	return cpufreq_register_driver(&dbx500_cpufreq_driver);
+
+	dbx500_cpufreq_register_energy();
+
+	ret = cpufreq_register_driver(&dbx500_cpufreq_driver);
+	if (ret)
+		dbx500_cpufreq_unregister_energy();
+	return ret;
 }
 
 static struct platform_driver db8500_cpu_freq_driver = {
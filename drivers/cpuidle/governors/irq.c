@@ -0,0 +1,273 @@
+/*
+ * irq.c - the interrupt timing based idle governor
+ *
+ * This code is licenced under the GPL version 2 as described
+ * in the COPYING file that acompanies the Linux Kernel.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos_params.h>
+#include <linux/interrupt.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/tick.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
+#include <linux/cpu.h>
+#include <linux/sysfs.h>
+
+/*
+ * The menu governor scales the distance to the next timer by a
+ * correction factor learnt from past idle periods. When most wakeups
+ * come from device interrupts, a modem or a touchscreen, that factor
+ * averages unrelated wakeups and keeps mispredicting.
+ *
+ * Instead, the irq core keeps the statistics of the interval between two
+ * occurrences of each interrupt (see kernel/irq/timings.c) and tells the
+ * earliest time one of the regular interrupts is expected again. The
+ * predicted idle duration is the distance to that time or to the next
+ * timer, whichever comes first, and the deepest state whose target
+ * residency fits in it is picked, within the pm_qos latency constraint.
+ *
+ * The outcome of each prediction is accounted as:
+ *   hit:   the chosen state was the deepest one that fitted
+ *   early: the cpu woke up before the target residency of the state,
+ *          the entry was wasted
+ *   late:  the cpu slept long enough for a deeper state
+ */
+
+struct irq_gov_device {
+	int		last_state_idx;
+	int		needs_update;
+
+	unsigned int	predicted_us;
+	unsigned int	exit_us;
+
+	unsigned long	hits;
+	unsigned long	early;
+	unsigned long	late;
+};
+
+static DEFINE_PER_CPU(struct irq_gov_device, irq_gov_devices);
+
+static void irq_gov_update(struct cpuidle_device *dev);
+
+/**
+ * irq_gov_select - selects the next idle state to enter
+ * @dev: the CPU
+ */
+static int irq_gov_select(struct cpuidle_device *dev)
+{
+	struct irq_gov_device *data = &__get_cpu_var(irq_gov_devices);
+	int latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
+	unsigned int power_usage = -1;
+	unsigned int timer_us;
+	u64 now, next_irq;
+	int i;
+
+	if (data->needs_update) {
+		irq_gov_update(dev);
+		data->needs_update = 0;
+	}
+
+	data->last_state_idx = 0;
+	data->exit_us = 0;
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0))
+		return 0;
+
+	timer_us = ktime_to_us(tick_nohz_get_sleep_length());
+	data->predicted_us = timer_us;
+
+	now = local_clock();
+	next_irq = irq_timings_next_event(now);
+	if (next_irq != ULLONG_MAX) {
+		u64 irq_us = div_u64(next_irq - now, NSEC_PER_USEC);
+
+		if (irq_us < data->predicted_us)
+			data->predicted_us = irq_us;
+	}
+
+	/*
+	 * We want to default to C1 (hlt), not to busy polling
+	 * unless the timer is happening really really soon.
+	 */
+	if (timer_us > 5)
+		data->last_state_idx = CPUIDLE_DRIVER_STATE_START;
+
+	for (i = CPUIDLE_DRIVER_STATE_START; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+
+		if (s->flags & CPUIDLE_FLAG_IGNORE)
+			continue;
+		if (s->target_residency > data->predicted_us)
+			continue;
+		if (s->exit_latency > latency_req)
+			continue;
+
+		if (s->power_usage < power_usage) {
+			power_usage = s->power_usage;
+			data->last_state_idx = i;
+			data->exit_us = s->exit_latency;
+		}
+	}
+
+	return data->last_state_idx;
+}
+
+/**
+ * irq_gov_reflect - records that data structures need update
+ * @dev: the CPU
+ *
+ * NOTE: it's important to be fast here because this operation will add to
+ *       the overall exit latency.
+ */
+static void irq_gov_reflect(struct cpuidle_device *dev)
+{
+	struct irq_gov_device *data = &__get_cpu_var(irq_gov_devices);
+
+	data->needs_update = 1;
+}
+
+/**
+ * irq_gov_update - accounts the outcome of the last prediction
+ * @dev: the CPU
+ */
+static void irq_gov_update(struct cpuidle_device *dev)
+{
+	struct irq_gov_device *data = &__get_cpu_var(irq_gov_devices);
+	int last_idx = data->last_state_idx;
+	struct cpuidle_state *target = &dev->states[last_idx];
+	int latency_req = pm_qos_request(PM_QOS_CPU_DMA_LATENCY);
+	unsigned int measured_us;
+	unsigned int power_usage;
+	int i, best_idx = last_idx;
+
+	/* Without a residency measurement there is nothing to learn */
+	if (unlikely(!(target->flags & CPUIDLE_FLAG_TIME_VALID)))
+		return;
+
+	measured_us = cpuidle_get_last_residency(dev);
+	if (measured_us > data->exit_us)
+		measured_us -= data->exit_us;
+
+	if (last_idx > CPUIDLE_DRIVER_STATE_START &&
+	    measured_us < target->target_residency) {
+		data->early++;
+		return;
+	}
+
+	/* Would a lower power state have fitted in the measured time? */
+	power_usage = target->power_usage;
+	for (i = CPUIDLE_DRIVER_STATE_START; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+
+		if (s->flags & CPUIDLE_FLAG_IGNORE)
+			continue;
+		if (s->target_residency > measured_us)
+			continue;
+		if (s->exit_latency > latency_req)
+			continue;
+
+		if (s->power_usage < power_usage) {
+			power_usage = s->power_usage;
+			best_idx = i;
+		}
+	}
+
+	if (best_idx != last_idx)
+		data->late++;
+	else
+		data->hits++;
+}
+
+/**
+ * irq_gov_enable_device - scans a CPU's states and does setup
+ * @dev: the CPU
+ */
+static int irq_gov_enable_device(struct cpuidle_device *dev)
+{
+	struct irq_gov_device *data = &per_cpu(irq_gov_devices, dev->cpu);
+
+	memset(data, 0, sizeof(struct irq_gov_device));
+	irq_timings_enable();
+
+	return 0;
+}
+
+static void irq_gov_disable_device(struct cpuidle_device *dev)
+{
+	irq_timings_disable();
+}
+
+#define IRQ_GOV_STAT_ATTR(_name)					\
+static ssize_t show_irq_prediction_##_name(struct sysdev_class *class,	\
+		struct sysdev_class_attribute *attr, char *buf)		\
+{									\
+	unsigned long sum = 0;						\
+	int cpu;							\
+									\
+	for_each_possible_cpu(cpu)					\
+		sum += per_cpu(irq_gov_devices, cpu)._name;		\
+	return sprintf(buf, "%lu\n", sum);				\
+}									\
+static SYSDEV_CLASS_ATTR(irq_prediction_##_name, 0444,		\
+			 show_irq_prediction_##_name, NULL)
+
+IRQ_GOV_STAT_ATTR(hits);
+IRQ_GOV_STAT_ATTR(early);
+IRQ_GOV_STAT_ATTR(late);
+
+static struct attribute *irq_gov_attributes[] = {
+	&attr_irq_prediction_hits.attr,
+	&attr_irq_prediction_early.attr,
+	&attr_irq_prediction_late.attr,
+	NULL
+};
+
+static struct attribute_group irq_gov_attr_group = {
+	.attrs = irq_gov_attributes,
+	.name = "cpuidle",
+};
+
+static struct cpuidle_governor irq_governor = {
+	.name =		"irq",
+	.rating =	25,
+	.enable =	irq_gov_enable_device,
+	.disable =	irq_gov_disable_device,
+	.select =	irq_gov_select,
+	.reflect =	irq_gov_reflect,
+	.owner =	THIS_MODULE,
+};
+
+/**
+ * init_irq_gov - initializes the governor
+ */
+static int __init init_irq_gov(void)
+{
+	int ret;
+
+	ret = cpuidle_register_governor(&irq_governor);
+
+	sysfs_merge_group(&(cpu_sysdev_class.kset.kobj),
+						&irq_gov_attr_group);
+
+	return ret;
+}
+
+/**
+ * exit_irq_gov - exits the governor
+ */
+static void __exit exit_irq_gov(void)
+{
+	sysfs_unmerge_group(&(cpu_sysdev_class.kset.kobj),
+						&irq_gov_attr_group);
+
+	cpuidle_unregister_governor(&irq_governor);
+}
+
+MODULE_LICENSE("GPL");
+module_init(init_irq_gov);
+module_exit(exit_irq_gov);
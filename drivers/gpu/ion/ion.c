@@ -164,12 +164,18 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap,
 static void ion_buffer_destroy(struct kref *kref)
 {
 	struct ion_buffer *buffer = container_of(kref, struct ion_buffer, ref);
+	struct ion_heap *heap = buffer->heap;
 	struct ion_device *dev = buffer->dev;
 
-	buffer->heap->ops->free(buffer);
 	mutex_lock(&dev->lock);
 	rb_erase(&buffer->node, &dev->buffers);
 	mutex_unlock(&dev->lock);
+
+	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE) {
+		ion_heap_freelist_add(heap, buffer);
+		return;
+	}
+	heap->ops->free(buffer);
 	kfree(buffer);
 }
 
@@ -1142,6 +1148,8 @@ static int ion_debug_heap_show(struct seq_file *s, void *unused)
 		seq_printf(s, "%16.s %16u %16u\n", client->name, client->pid,
 			   size);
 	}
+	if (heap->ops->debug_show)
+		heap->ops->debug_show(heap, s);
 	return 0;
 }
 
@@ -1215,6 +1223,13 @@ void ion_device_add_heap(struct ion_device *dev, struct ion_heap *heap)
 	struct ion_heap *entry;
 
 	heap->dev = dev;
+	/* without the thread buffers would never leave the free list */
+	if ((heap->flags & ION_HEAP_FLAG_DEFER_FREE) &&
+	    ion_heap_init_deferred_free(heap))
+		heap->flags &= ~ION_HEAP_FLAG_DEFER_FREE;
+	if ((heap->flags & ION_HEAP_FLAG_DEFER_FREE) || heap->ops->shrink)
+		ion_heap_init_shrinker(heap);
+
 	mutex_lock(&dev->lock);
 	while (*p) {
 		parent = *p;
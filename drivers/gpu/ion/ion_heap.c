@@ -15,9 +15,146 @@
  */
 
 #include <linux/err.h>
+#include <linux/freezer.h>
 #include <linux/ion.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
 #include "ion_priv.h"
 
+void ion_heap_freelist_add(struct ion_heap *heap, struct ion_buffer *buffer)
+{
+	spin_lock(&heap->free_lock);
+	list_add_tail(&buffer->list, &heap->free_list);
+	heap->free_list_size += buffer->size;
+	spin_unlock(&heap->free_lock);
+	wake_up(&heap->waitqueue);
+}
+
+static struct ion_buffer *ion_heap_freelist_next(struct ion_heap *heap)
+{
+	struct ion_buffer *buffer = NULL;
+
+	spin_lock(&heap->free_lock);
+	if (!list_empty(&heap->free_list)) {
+		buffer = list_first_entry(&heap->free_list, struct ion_buffer,
+					  list);
+		list_del(&buffer->list);
+		heap->free_list_size -= buffer->size;
+	}
+	spin_unlock(&heap->free_lock);
+	return buffer;
+}
+
+static size_t ion_heap_freelist_size(struct ion_heap *heap)
+{
+	size_t size;
+
+	spin_lock(&heap->free_lock);
+	size = heap->free_list_size;
+	spin_unlock(&heap->free_lock);
+	return size;
+}
+
+static bool ion_heap_freelist_empty(struct ion_heap *heap)
+{
+	bool empty;
+
+	spin_lock(&heap->free_lock);
+	empty = list_empty(&heap->free_list);
+	spin_unlock(&heap->free_lock);
+	return empty;
+}
+
+/*
+ * Free buffers from the free list until at least @size bytes are gone, or
+ * the list is empty.  Returns the number of bytes freed.
+ */
+static size_t ion_heap_freelist_drain(struct ion_heap *heap, size_t size,
+				      unsigned long private_flags)
+{
+	struct ion_buffer *buffer;
+	size_t drained = 0;
+
+	while (drained < size && (buffer = ion_heap_freelist_next(heap))) {
+		drained += buffer->size;
+		buffer->private_flags |= private_flags;
+		heap->ops->free(buffer);
+		kfree(buffer);
+	}
+	return drained;
+}
+
+static int ion_heap_deferred_free(void *data)
+{
+	struct ion_heap *heap = data;
+
+	set_freezable();
+	while (!kthread_should_stop()) {
+		wait_event_freezable(heap->waitqueue,
+				     !ion_heap_freelist_empty(heap) ||
+				     kthread_should_stop());
+		ion_heap_freelist_drain(heap, ULONG_MAX, 0);
+	}
+
+	return 0;
+}
+
+int ion_heap_init_deferred_free(struct ion_heap *heap)
+{
+	struct sched_param param = { .sched_priority = 0 };
+
+	INIT_LIST_HEAD(&heap->free_list);
+	heap->free_list_size = 0;
+	spin_lock_init(&heap->free_lock);
+	init_waitqueue_head(&heap->waitqueue);
+	heap->task = kthread_run(ion_heap_deferred_free, heap,
+				 "%s", heap->name);
+	if (IS_ERR(heap->task)) {
+		pr_err("%s: creating thread for deferred free failed\n",
+		       __func__);
+		return PTR_ERR(heap->task);
+	}
+	/*
+	 * Zeroing freed memory is background work, keep it off the cpu.  If
+	 * the thread is starved the shrinker frees the waiting buffers.
+	 */
+	sched_setscheduler(heap->task, SCHED_IDLE, &param);
+	return 0;
+}
+
+static int ion_heap_shrink(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct ion_heap *heap = container_of(shrinker, struct ion_heap,
+					     shrinker);
+	int to_scan = sc->nr_to_scan;
+	int total = 0;
+
+	/*
+	 * Free the waiting buffers first, straight to the system: there is no
+	 * point zeroing memory that is only going to be reclaimed.
+	 */
+	if (to_scan && (heap->flags & ION_HEAP_FLAG_DEFER_FREE)) {
+		to_scan -= ion_heap_freelist_drain(heap, to_scan * PAGE_SIZE,
+					ION_PRIV_FLAG_SHRINKER_FREE) / PAGE_SIZE;
+		if (to_scan < 0)
+			to_scan = 0;
+	}
+
+	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE)
+		total = ion_heap_freelist_size(heap) / PAGE_SIZE;
+	if (heap->ops->shrink)
+		total += heap->ops->shrink(heap, sc->gfp_mask, to_scan);
+	return total;
+}
+
+void ion_heap_init_shrinker(struct ion_heap *heap)
+{
+	heap->shrinker.shrink = ion_heap_shrink;
+	heap->shrinker.seeks = DEFAULT_SEEKS;
+	register_shrinker(&heap->shrinker);
+}
+
 struct ion_heap *ion_heap_create(struct ion_platform_heap *heap_data)
 {
 	struct ion_heap *heap = NULL;
@@ -55,6 +192,14 @@ void ion_heap_destroy(struct ion_heap *heap)
 	if (!heap)
 		return;
 
+	if (heap->shrinker.shrink)
+		unregister_shrinker(&heap->shrinker);
+
+	if (!IS_ERR_OR_NULL(heap->task)) {
+		kthread_stop(heap->task);
+		ion_heap_freelist_drain(heap, ULONG_MAX, 0);
+	}
+
 	switch (heap->type) {
 	case ION_HEAP_TYPE_SYSTEM_CONTIG:
 		ion_system_contig_heap_destroy(heap);
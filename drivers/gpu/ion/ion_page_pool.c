@@ -0,0 +1,175 @@
+/*
+ * drivers/gpu/ion/ion_page_pool.c
+ *
+ * Copyright (C) 2011 Google, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/highmem.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include "ion_priv.h"
+
+static void ion_page_pool_zero(struct ion_page_pool *pool, struct page *page)
+{
+	int i;
+
+	for (i = 0; i < (1 << pool->order); i++)
+		clear_highpage(page + i);
+}
+
+/*
+ * The zeroes go through the cpu caches.  Write them back before the page is
+ * handed out, a device may DMA to or from the buffer without any cache
+ * maintenance of its own and must neither read stale data nor have its
+ * writes overwritten by a later eviction of the zeroed lines.
+ */
+static void ion_page_pool_sync(struct ion_page_pool *pool, struct page *page)
+{
+	struct scatterlist sg;
+
+	sg_init_table(&sg, 1);
+	sg_set_page(&sg, page, PAGE_SIZE << pool->order, 0);
+	sg_dma_address(&sg) = page_to_phys(page);
+	dma_sync_sg_for_device(NULL, &sg, 1, DMA_BIDIRECTIONAL);
+}
+
+static void ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+{
+	mutex_lock(&pool->mutex);
+	if (PageHighMem(page)) {
+		list_add(&page->lru, &pool->high_items);
+		pool->high_count++;
+	} else {
+		list_add(&page->lru, &pool->low_items);
+		pool->low_count++;
+	}
+	mutex_unlock(&pool->mutex);
+}
+
+/*
+ * The head of each list is the most recently freed page, allocations take
+ * from there and the shrinker gives back the tail.  Callers hold the mutex.
+ */
+static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high,
+					 bool tail)
+{
+	struct list_head *items = high ? &pool->high_items : &pool->low_items;
+	struct page *page;
+
+	BUG_ON(list_empty(items));
+	if (tail)
+		page = list_entry(items->prev, struct page, lru);
+	else
+		page = list_first_entry(items, struct page, lru);
+	list_del(&page->lru);
+	if (high)
+		pool->high_count--;
+	else
+		pool->low_count--;
+	return page;
+}
+
+/*
+ * Pages sitting in the pool are always zeroed, so a hit in
+ * ion_page_pool_alloc() can be handed out as is.  Pages are linked
+ * through page->lru, which is free for pages the pool owns.
+ */
+struct page *ion_page_pool_alloc(struct ion_page_pool *pool)
+{
+	struct page *page = NULL;
+
+	mutex_lock(&pool->mutex);
+	if (pool->high_count)
+		page = ion_page_pool_remove(pool, true, false);
+	else if (pool->low_count)
+		page = ion_page_pool_remove(pool, false, false);
+	mutex_unlock(&pool->mutex);
+
+	if (!page) {
+		page = alloc_pages(pool->gfp_mask | __GFP_ZERO, pool->order);
+		if (page)
+			ion_page_pool_sync(pool, page);
+	}
+	return page;
+}
+
+void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
+{
+	ion_page_pool_zero(pool, page);
+	ion_page_pool_sync(pool, page);
+	ion_page_pool_add(pool, page);
+}
+
+int ion_page_pool_total(struct ion_page_pool *pool, bool high)
+{
+	int count = pool->low_count;
+
+	if (high)
+		count += pool->high_count;
+	return count << pool->order;
+}
+
+int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
+			 int nr_to_scan)
+{
+	bool high = !!(gfp_mask & __GFP_HIGHMEM);
+	int freed = 0;
+
+	while (freed < nr_to_scan) {
+		struct page *page;
+
+		/* highmem first, it is the least useful to keep */
+		mutex_lock(&pool->mutex);
+		if (high && pool->high_count) {
+			page = ion_page_pool_remove(pool, true, true);
+		} else if (pool->low_count) {
+			page = ion_page_pool_remove(pool, false, true);
+		} else {
+			mutex_unlock(&pool->mutex);
+			break;
+		}
+		mutex_unlock(&pool->mutex);
+
+		__free_pages(page, pool->order);
+		freed += (1 << pool->order);
+	}
+
+	return freed;
+}
+
+struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
+{
+	struct ion_page_pool *pool;
+
+	pool = kmalloc(sizeof(struct ion_page_pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+	pool->high_count = 0;
+	pool->low_count = 0;
+	INIT_LIST_HEAD(&pool->high_items);
+	INIT_LIST_HEAD(&pool->low_items);
+	mutex_init(&pool->mutex);
+	pool->gfp_mask = gfp_mask;
+	pool->order = order;
+	return pool;
+}
+
+void ion_page_pool_destroy(struct ion_page_pool *pool)
+{
+	ion_page_pool_shrink(pool, __GFP_HIGHMEM, INT_MAX);
+	kfree(pool);
+}
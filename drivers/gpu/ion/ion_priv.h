@@ -18,12 +18,16 @@
 #define _ION_PRIV_H
 
 #include <linux/kref.h>
+#include <linux/mm.h>
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
 #include <linux/rbtree.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
 #include <linux/ion.h>
 
 struct ion_mapping;
+struct seq_file;
 
 struct ion_dma_mapping {
 	struct kref ref;
@@ -41,9 +45,12 @@ struct ion_buffer *ion_handle_buffer(struct ion_handle *handle);
  * struct ion_buffer - metadata for a particular buffer
  * @ref:		refernce count
  * @node:		node in the ion_device buffers tree
+ * @list:		element in the heap's free_list once the buffer is
+ *			out of the tree and waiting for deferred free
  * @dev:		back pointer to the ion_device
  * @heap:		back pointer to the heap the buffer came from
  * @flags:		buffer specific flags
+ * @private_flags:	internal buffer specific flags, ION_PRIV_FLAG_*
  * @size:		size of the buffer
  * @priv_virt:		private data to the buffer representable as
  *			a void *
@@ -57,10 +64,14 @@ struct ion_buffer *ion_handle_buffer(struct ion_handle *handle);
 */
 struct ion_buffer {
 	struct kref ref;
-	struct rb_node node;
+	union {
+		struct rb_node node;
+		struct list_head list;
+	};
 	struct ion_device *dev;
 	struct ion_heap *heap;
 	unsigned long flags;
+	unsigned long private_flags;
 	size_t size;
 	union {
 		void *priv_virt;
@@ -84,6 +95,11 @@ struct ion_buffer {
  * @map_kernel		map memory to the kernel
  * @unmap_kernel	unmap memory to the kernel
  * @map_user		map memory to userspace
+ * @debug_show		optional, print heap specific state to the heap's
+ *			debugfs file
+ * @shrink		optional, give memory cached by the heap back to the
+ *			system, freeing up to nr_to_scan pages usable for
+ *			gfp_mask; returns the number of such pages left
  */
 struct ion_heap_ops {
 	int (*allocate) (struct ion_heap *heap,
@@ -99,18 +115,40 @@ struct ion_heap_ops {
 	void (*unmap_kernel) (struct ion_heap *heap, struct ion_buffer *buffer);
 	int (*map_user) (struct ion_heap *mapper, struct ion_buffer *buffer,
 			 struct vm_area_struct *vma);
+	void (*debug_show) (struct ion_heap *heap, struct seq_file *s);
+	int (*shrink) (struct ion_heap *heap, gfp_t gfp_mask, int nr_to_scan);
 };
 
+/**
+ * heap flags - flags between the heaps and core ion code
+ */
+#define ION_HEAP_FLAG_DEFER_FREE (1 << 0)
+
+/**
+ * private buffer flags - set by core ion code for the heap's ops
+ *
+ * ION_PRIV_FLAG_SHRINKER_FREE: the buffer is freed by the shrinker, its
+ * memory should go straight back to the system rather than to a pool.
+ */
+#define ION_PRIV_FLAG_SHRINKER_FREE (1 << 0)
+
 /**
  * struct ion_heap - represents a heap in the system
  * @node:		rb node to put the heap on the device's tree of heaps
  * @dev:		back pointer to the ion_device
  * @type:		type of heap
  * @ops:		ops struct as above
+ * @flags:		flags
  * @id:			id of heap, also indicates priority of this heap when
  *			allocating.  These are specified by platform data and
  *			MUST be unique
  * @name:		used for debugging
+ * @shrinker:		a shrinker for the heap, if the heap caches memory
+ * @free_list:		buffers waiting to be freed, if ION_HEAP_FLAG_DEFER_FREE
+ * @free_list_size:	size in bytes of the buffers on free_list
+ * @free_lock:		protects free_list and free_list_size
+ * @waitqueue:		wakes the deferred free thread
+ * @task:		the deferred free thread
  *
  * Represents a pool of memory from which buffers can be made.  In some
  * systems the only heap is regular system memory allocated via vmalloc.
@@ -122,8 +160,15 @@ struct ion_heap {
 	struct ion_device *dev;
 	enum ion_heap_type type;
 	struct ion_heap_ops *ops;
+	unsigned long flags;
 	int id;
 	const char *name;
+	struct shrinker shrinker;
+	struct list_head free_list;
+	size_t free_list_size;
+	spinlock_t free_lock;
+	wait_queue_head_t waitqueue;
+	struct task_struct *task;
 };
 
 /**
@@ -150,6 +195,29 @@ void ion_device_destroy(struct ion_device *dev);
  */
 void ion_device_add_heap(struct ion_device *dev, struct ion_heap *heap);
 
+/**
+ * ion_heap_init_deferred_free - start the deferred free thread of a heap
+ * @heap:		the heap, must have ION_HEAP_FLAG_DEFER_FREE set
+ *
+ * Buffers of such heaps are handed to ion_heap_freelist_add() when their
+ * last reference goes away and released by the thread, so the work done in
+ * ops->free stays out of the path of the process dropping the buffer.
+ */
+int ion_heap_init_deferred_free(struct ion_heap *heap);
+void ion_heap_freelist_add(struct ion_heap *heap, struct ion_buffer *buffer);
+
+/**
+ * ion_heap_init_shrinker - register the shrinker of a heap
+ * @heap:		the heap, with ION_HEAP_FLAG_DEFER_FREE set or a
+ *			shrink op
+ *
+ * Under memory pressure the shrinker frees the buffers waiting on the free
+ * list straight to the system, without zeroing them, and then calls the
+ * heap's shrink op.  The free list is counted even if the deferred free
+ * thread is not getting to run.
+ */
+void ion_heap_init_shrinker(struct ion_heap *heap);
+
 /**
  * functions for creating and destroying the built in ion heaps.
  * architectures can add their own custom architecture specific
@@ -181,4 +249,46 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  */
 #define ION_CARVEOUT_ALLOCATE_FAIL -1
 
+/**
+ * struct ion_page_pool - pagepool struct
+ * @high_count:		number of highmem items in the pool
+ * @low_count:		number of lowmem items in the pool
+ * @high_items:		list of zeroed highmem pages, linked through page->lru
+ * @low_items:		list of zeroed lowmem pages, linked through page->lru
+ * @mutex:		lock protecting this struct and especially the counts
+ *			and item lists
+ * @gfp_mask:		gfp_mask to use from alloc
+ * @order:		order of pages in the pool
+ *
+ * Allows you to keep a pool of pre-zeroed pages of one order around for
+ * faster allocation.  Pages are zeroed when they are returned with
+ * ion_page_pool_free(), a miss in ion_page_pool_alloc() falls back to the
+ * page allocator.  The owner is expected to call ion_page_pool_shrink()
+ * from a shrinker so the pool gives memory back under pressure.  Highmem
+ * pages are kept apart, freeing them does not help a lowmem allocation.
+ * Zeroed pages are flushed from the cpu caches before they enter the pool.
+ */
+struct ion_page_pool {
+	int high_count;
+	int low_count;
+	struct list_head high_items;
+	struct list_head low_items;
+	struct mutex mutex;
+	gfp_t gfp_mask;
+	unsigned int order;
+};
+
+struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order);
+void ion_page_pool_destroy(struct ion_page_pool *);
+struct page *ion_page_pool_alloc(struct ion_page_pool *);
+void ion_page_pool_free(struct ion_page_pool *, struct page *);
+/* number of order-0 pages held by the pool, including highmem if high */
+int ion_page_pool_total(struct ion_page_pool *pool, bool high);
+/*
+ * free up to nr_to_scan order-0 pages worth usable for gfp_mask, returns the
+ * number freed
+ */
+int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
+			 int nr_to_scan);
+
 #endif /* _ION_PRIV_H */
@@ -19,6 +19,7 @@
 #include <linux/workqueue.h>
 #include <linux/backing-dev.h>
 #include <linux/percpu.h>
+#include <linux/padata.h>
 #include <asm/atomic.h>
 #include <linux/scatterlist.h>
 #include <asm/page.h>
@@ -63,6 +64,20 @@ struct dm_crypt_io {
 	struct dm_crypt_io *base_io;
 };
 
+#ifdef CONFIG_DM_CRYPT_PADATA
+/*
+ * A run of sectors of one conversion handed to padata, which converts
+ * it on some CPU and completes the batches of all bios in the order they
+ * were dispatched.
+ */
+struct dm_crypt_batch {
+	struct padata_priv padata;
+	struct dm_crypt_io *io;
+	struct convert_context ctx;
+	unsigned int sectors;
+};
+#endif
+
 struct dm_crypt_request {
 	struct convert_context *ctx;
 	struct scatterlist sg_in;
@@ -110,6 +125,10 @@ enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID };
  */
 struct crypt_cpu {
 	struct ablkcipher_request *req;
+#ifdef CONFIG_DM_CRYPT_PADATA
+	/* Used only by the padata callback, which runs with BHs off */
+	struct ablkcipher_request *batch_req;
+#endif
 	/* ESSIV: struct crypto_cipher *essiv_tfm */
 	void *iv_private;
 	struct crypto_ablkcipher *tfms[0];
@@ -131,6 +150,10 @@ struct crypt_config {
 	mempool_t *req_pool;
 	mempool_t *page_pool;
 	struct bio_set *bs;
+#ifdef CONFIG_DM_CRYPT_PADATA
+	mempool_t *batch_pool;
+	unsigned int batch_sectors;
+#endif
 
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
@@ -180,6 +203,16 @@ struct crypt_config {
 
 static struct kmem_cache *_crypt_io_pool;
 
+#ifdef CONFIG_DM_CRYPT_PADATA
+static struct workqueue_struct *_crypt_padata_wq;
+static struct padata_instance *_crypt_padata;
+
+static unsigned int batch_sectors = 64;
+module_param(batch_sectors, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(batch_sectors,
+		 "Sectors per parallel conversion batch for new targets, 0 disables");
+#endif
+
 static void clone_init(struct dm_crypt_io *, struct bio *);
 static void kcryptd_queue_crypt(struct dm_crypt_io *io);
 static u8 *iv_of_dmreq(struct crypt_config *cc, struct dm_crypt_request *dmreq);
@@ -688,6 +721,27 @@ static u8 *iv_of_dmreq(struct crypt_config *cc,
 		crypto_ablkcipher_alignmask(any_tfm(cc)) + 1);
 }
 
+/*
+ * Step the bio positions of the context over one sector.
+ */
+static void crypt_convert_advance(struct convert_context *ctx)
+{
+	struct bio_vec *bv_in = bio_iovec_idx(ctx->bio_in, ctx->idx_in);
+	struct bio_vec *bv_out = bio_iovec_idx(ctx->bio_out, ctx->idx_out);
+
+	ctx->offset_in += 1 << SECTOR_SHIFT;
+	if (ctx->offset_in >= bv_in->bv_len) {
+		ctx->offset_in = 0;
+		ctx->idx_in++;
+	}
+
+	ctx->offset_out += 1 << SECTOR_SHIFT;
+	if (ctx->offset_out >= bv_out->bv_len) {
+		ctx->offset_out = 0;
+		ctx->idx_out++;
+	}
+}
+
 static int crypt_convert_block(struct crypt_config *cc,
 			       struct convert_context *ctx,
 			       struct ablkcipher_request *req)
@@ -711,17 +765,7 @@ static int crypt_convert_block(struct crypt_config *cc,
 	sg_set_page(&dmreq->sg_out, bv_out->bv_page, 1 << SECTOR_SHIFT,
 		    bv_out->bv_offset + ctx->offset_out);
 
-	ctx->offset_in += 1 << SECTOR_SHIFT;
-	if (ctx->offset_in >= bv_in->bv_len) {
-		ctx->offset_in = 0;
-		ctx->idx_in++;
-	}
-
-	ctx->offset_out += 1 << SECTOR_SHIFT;
-	if (ctx->offset_out >= bv_out->bv_len) {
-		ctx->offset_out = 0;
-		ctx->idx_out++;
-	}
+	crypt_convert_advance(ctx);
 
 	if (cc->iv_gen_ops) {
 		r = cc->iv_gen_ops->generator(cc, iv, dmreq);
@@ -761,6 +805,130 @@ static void crypt_alloc_req(struct crypt_config *cc,
 	    kcryptd_async_done, dmreq_of_req(cc, this_cc->req));
 }
 
+#ifdef CONFIG_DM_CRYPT_PADATA
+static void kcryptd_crypt_read_done(struct dm_crypt_io *io);
+static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async);
+
+/*
+ * Number of sectors left to convert, limited by the shorter of the bios.
+ */
+static unsigned int crypt_convert_sectors(struct convert_context *ctx)
+{
+	unsigned int in = 0, out = 0, i;
+
+	for (i = ctx->idx_in; i < ctx->bio_in->bi_vcnt; i++)
+		in += bio_iovec_idx(ctx->bio_in, i)->bv_len;
+	for (i = ctx->idx_out; i < ctx->bio_out->bi_vcnt; i++)
+		out += bio_iovec_idx(ctx->bio_out, i)->bv_len;
+
+	return min(in - ctx->offset_in, out - ctx->offset_out) >> SECTOR_SHIFT;
+}
+
+static void kcryptd_batch_parallel(struct padata_priv *padata)
+{
+	struct dm_crypt_batch *batch = container_of(padata,
+						    struct dm_crypt_batch,
+						    padata);
+	struct crypt_config *cc = batch->io->target->private;
+	struct crypt_cpu *this_cc = this_crypt_config(cc);
+	struct ablkcipher_request *req = this_cc->batch_req;
+	struct convert_context *ctx = &batch->ctx;
+	unsigned int key_index, i;
+	int r = 0;
+
+	for (i = 0; i < batch->sectors && !r; i++) {
+		key_index = ctx->sector & (cc->tfms_count - 1);
+		ablkcipher_request_set_tfm(req, this_cc->tfms[key_index]);
+		ablkcipher_request_set_callback(req, 0, NULL, NULL);
+
+		r = crypt_convert_block(cc, ctx, req);
+		ctx->sector++;
+	}
+
+	padata->info = r;
+	padata_do_serial(padata);
+}
+
+static void kcryptd_batch_serial(struct padata_priv *padata)
+{
+	struct dm_crypt_batch *batch = container_of(padata,
+						    struct dm_crypt_batch,
+						    padata);
+	struct dm_crypt_io *io = batch->io;
+	struct crypt_config *cc = io->target->private;
+
+	if (padata->info < 0)
+		io->error = -EIO;
+
+	mempool_free(batch, cc->batch_pool);
+
+	if (!atomic_dec_and_test(&io->ctx.pending))
+		return;
+
+	if (bio_data_dir(io->base_bio) == READ)
+		kcryptd_crypt_read_done(io);
+	else
+		kcryptd_crypt_write_io_submit(io, 1);
+}
+
+/*
+ * Hand all but the last batch of the conversion to padata and advance the
+ * context past them, leaving the rest to the serial loop in crypt_convert.
+ * Each batch holds a reference on ctx->pending which is dropped from the
+ * serial callback, so the bio completes like an async crypto request.
+ *
+ * The batches are converted with the synchronous per-CPU batch_req and
+ * padata_do_serial() must be called on the CPU that ran the parallel
+ * callback, so this is only used for synchronous ciphers.
+ */
+static void crypt_convert_parallel(struct crypt_config *cc,
+				   struct convert_context *ctx)
+{
+	struct dm_crypt_io *io = container_of(ctx, struct dm_crypt_io, ctx);
+	struct dm_crypt_batch *batch;
+	unsigned int remaining, i;
+	int cb_cpu;
+
+	remaining = crypt_convert_sectors(ctx);
+	if (remaining <= cc->batch_sectors)
+		return;
+
+	/* One callback CPU per bio keeps its batches in a single queue */
+	cb_cpu = raw_smp_processor_id();
+
+	while (remaining > cc->batch_sectors) {
+		batch = mempool_alloc(cc->batch_pool, GFP_NOIO);
+		memset(&batch->padata, 0, sizeof(batch->padata));
+		batch->padata.parallel = kcryptd_batch_parallel;
+		batch->padata.serial = kcryptd_batch_serial;
+		batch->io = io;
+		batch->sectors = cc->batch_sectors;
+
+		batch->ctx.bio_in = ctx->bio_in;
+		batch->ctx.bio_out = ctx->bio_out;
+		batch->ctx.offset_in = ctx->offset_in;
+		batch->ctx.offset_out = ctx->offset_out;
+		batch->ctx.idx_in = ctx->idx_in;
+		batch->ctx.idx_out = ctx->idx_out;
+		batch->ctx.sector = ctx->sector;
+
+		atomic_inc(&ctx->pending);
+
+		/* Too many objects in flight or CPU going away: do it here */
+		if (padata_do_parallel(_crypt_padata, &batch->padata, cb_cpu)) {
+			atomic_dec(&ctx->pending);
+			mempool_free(batch, cc->batch_pool);
+			return;
+		}
+
+		for (i = 0; i < cc->batch_sectors; i++)
+			crypt_convert_advance(ctx);
+		ctx->sector += cc->batch_sectors;
+		remaining -= cc->batch_sectors;
+	}
+}
+#endif
+
 /*
  * Encrypt / decrypt data from one bio to another one (can be the same one)
  */
@@ -772,6 +940,11 @@ static int crypt_convert(struct crypt_config *cc,
 
 	atomic_set(&ctx->pending, 1);
 
+#ifdef CONFIG_DM_CRYPT_PADATA
+	if (cc->batch_sectors)
+		crypt_convert_parallel(cc, ctx);
+#endif
+
 	while(ctx->idx_in < ctx->bio_in->bi_vcnt &&
 	      ctx->idx_out < ctx->bio_out->bi_vcnt) {
 
@@ -1380,6 +1553,9 @@ static void crypt_dtr(struct dm_target *ti)
 			cpu_cc = per_cpu_ptr(cc->cpu, cpu);
 			if (cpu_cc->req)
 				mempool_free(cpu_cc->req, cc->req_pool);
+#ifdef CONFIG_DM_CRYPT_PADATA
+			kfree(cpu_cc->batch_req);
+#endif
 			crypt_free_tfms(cc, cpu);
 		}
 
@@ -1392,6 +1568,10 @@ static void crypt_dtr(struct dm_target *ti)
 		mempool_destroy(cc->req_pool);
 	if (cc->io_pool)
 		mempool_destroy(cc->io_pool);
+#ifdef CONFIG_DM_CRYPT_PADATA
+	if (cc->batch_pool)
+		mempool_destroy(cc->batch_pool);
+#endif
 
 	if (cc->iv_gen_ops && cc->iv_gen_ops->dtr)
 		cc->iv_gen_ops->dtr(cc);
@@ -1574,6 +1754,45 @@ bad_mem:
  * Construct an encryption mapping:
  * <cipher> <key> <iv_offset> <dev_path> <start>
  */
+#ifdef CONFIG_DM_CRYPT_PADATA
+/*
+ * Parallel batches need a synchronous cipher, see crypt_convert_parallel.
+ */
+static int crypt_ctr_batch(struct dm_target *ti)
+{
+	struct crypt_config *cc = ti->private;
+	struct crypto_tfm *tfm = crypto_ablkcipher_tfm(any_tfm(cc));
+	struct crypt_cpu *cpu_cc;
+	int cpu;
+
+	if (!batch_sectors || num_possible_cpus() == 1 ||
+	    tfm->__crt_alg->cra_flags & CRYPTO_ALG_ASYNC)
+		return 0;
+
+	cc->batch_pool = mempool_create_kmalloc_pool(MIN_IOS,
+					sizeof(struct dm_crypt_batch));
+	if (!cc->batch_pool) {
+		ti->error = "Cannot allocate crypt batch mempool";
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		cpu_cc = per_cpu_ptr(cc->cpu, cpu);
+		cpu_cc->batch_req = kmalloc(cc->dmreq_start +
+				sizeof(struct dm_crypt_request) + cc->iv_size,
+				GFP_KERNEL);
+		if (!cpu_cc->batch_req) {
+			ti->error = "Cannot allocate crypt batch request";
+			return -ENOMEM;
+		}
+	}
+
+	cc->batch_sectors = batch_sectors;
+
+	return 0;
+}
+#endif
+
 static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 {
 	struct crypt_config *cc;
@@ -1620,6 +1839,14 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
+#ifdef CONFIG_DM_CRYPT_PADATA
+	ret = crypt_ctr_batch(ti);
+	if (ret < 0)
+		goto bad;
+
+	ret = -ENOMEM;
+#endif
+
 	cc->page_pool = mempool_create_page_pool(MIN_POOL_PAGES, 0);
 	if (!cc->page_pool) {
 		ti->error = "Cannot allocate page mempool";
@@ -1839,6 +2066,33 @@ static struct target_type crypt_target = {
 	.iterate_devices = crypt_iterate_devices,
 };
 
+#ifdef CONFIG_DM_CRYPT_PADATA
+static int __init crypt_init_padata(void)
+{
+	_crypt_padata_wq = alloc_workqueue("kcryptd_padata",
+					   WQ_MEM_RECLAIM | WQ_CPU_INTENSIVE,
+					   1);
+	if (!_crypt_padata_wq)
+		return -ENOMEM;
+
+	_crypt_padata = padata_alloc_possible(_crypt_padata_wq);
+	if (!_crypt_padata) {
+		destroy_workqueue(_crypt_padata_wq);
+		return -ENOMEM;
+	}
+
+	padata_start(_crypt_padata);
+	return 0;
+}
+
+static void crypt_exit_padata(void)
+{
+	padata_stop(_crypt_padata);
+	destroy_workqueue(_crypt_padata_wq);
+	padata_free(_crypt_padata);
+}
+#endif
+
 static int __init dm_crypt_init(void)
 {
 	int r;
@@ -1847,9 +2101,20 @@ static int __init dm_crypt_init(void)
 	if (!_crypt_io_pool)
 		return -ENOMEM;
 
+#ifdef CONFIG_DM_CRYPT_PADATA
+	r = crypt_init_padata();
+	if (r < 0) {
+		kmem_cache_destroy(_crypt_io_pool);
+		return r;
+	}
+#endif
+
 	r = dm_register_target(&crypt_target);
 	if (r < 0) {
 		DMERR("register failed %d", r);
+#ifdef CONFIG_DM_CRYPT_PADATA
+		crypt_exit_padata();
+#endif
 		kmem_cache_destroy(_crypt_io_pool);
 	}
 
@@ -1859,6 +2124,9 @@ static int __init dm_crypt_init(void)
 static void __exit dm_crypt_exit(void)
 {
 	dm_unregister_target(&crypt_target);
+#ifdef CONFIG_DM_CRYPT_PADATA
+	crypt_exit_padata();
+#endif
 	kmem_cache_destroy(_crypt_io_pool);
 }
 
@@ -749,6 +749,7 @@ int usbnet_open (struct net_device *net)
 	}
 
 	set_bit(EVENT_DEV_OPEN, &dev->flags);
+	netdev_reset_queue(net);
 	netif_start_queue (net);
 	netif_info(dev, ifup, dev->net,
 		   "open: enable queueing (rx %d, tx %d) mtu %d %s framing\n",
@@ -993,6 +994,7 @@ static void tx_complete (struct urb *urb)
 	struct sk_buff		*skb = (struct sk_buff *) urb->context;
 	struct skb_data		*entry = (struct skb_data *) skb->cb;
 	struct usbnet		*dev = entry->dev;
+	unsigned long		flags;
 
 	if (urb->status == 0) {
 		if (!(dev->driver_info->flags & FLAG_MULTI_PACKET))
@@ -1032,6 +1034,11 @@ static void tx_complete (struct urb *urb)
 		}
 	}
 
+	/* txq.lock serializes byte queue accounting with start_xmit */
+	spin_lock_irqsave(&dev->txq.lock, flags);
+	netdev_completed_queue(dev->net, 1, entry->length);
+	spin_unlock_irqrestore(&dev->txq.lock, flags);
+
 	usb_autopm_put_interface_async(dev->intf);
 	entry->state = tx_done;
 	defer_bh(dev, skb, &dev->txq);
@@ -1120,6 +1127,9 @@ netdev_tx_t usbnet_start_xmit (struct sk_buff *skb,
 		goto drop;
 	}
 
+	/* account before submitting, the urb may complete right away */
+	netdev_sent_queue(net, length);
+
 #ifdef CONFIG_PM
 	/* if this triggers the device is still a sleep */
 	if (test_bit(EVENT_DEV_ASLEEP, &dev->flags)) {
@@ -1150,6 +1160,8 @@ netdev_tx_t usbnet_start_xmit (struct sk_buff *skb,
 		if (dev->txq.qlen >= TX_QLEN (dev))
 			netif_stop_queue (net);
 	}
+	if (retval)
+		netdev_completed_queue(net, 1, length);
 	spin_unlock_irqrestore (&dev->txq.lock, flags);
 
 	if (retval) {
@@ -1523,6 +1535,10 @@ int usbnet_resume (struct usb_interface *intf)
 			skb = (struct sk_buff *)res->context;
 			retval = usb_submit_urb(res, GFP_ATOMIC);
 			if (retval < 0) {
+				struct skb_data *entry = (struct skb_data *)skb->cb;
+
+				netdev_completed_queue(dev->net, 1,
+						       entry->length);
 				dev_kfree_skb_any(skb);
 				usb_free_urb(res);
 				usb_autopm_put_interface_async(dev->intf);
@@ -37,6 +37,8 @@
 #include <linux/usb/f_mtp.h>
 
 #define MTP_BULK_BUFFER_SIZE       16384
+#define MTP_TX_BUFFER_INIT_SIZE    131072
+#define MTP_RX_BUFFER_INIT_SIZE    131072
 #define INTR_BUFFER_SIZE           28
 
 /* String IDs */
@@ -49,11 +51,33 @@
 #define STATE_CANCELED              3   /* transaction canceled by host */
 #define STATE_ERROR                 4   /* error from completion routine */
 
-/* number of tx and rx requests to allocate */
-#define TX_REQ_MAX 4
-#define RX_REQ_MAX 2
+/* default and maximum number of tx and rx requests to allocate */
+#define MTP_TX_REQ_INIT 8
+#define MTP_RX_REQ_INIT 4
+#define MTP_RX_REQ_MAX 16
 #define INTR_REQ_MAX 5
 
+/*
+ * Bulk request geometry, latched at bind time.  Large requests let the UDC
+ * DMA a whole file chunk per completion; if the buffers cannot be allocated
+ * we fall back to MTP_BULK_BUFFER_SIZE.
+ */
+static unsigned int mtp_tx_req_len = MTP_TX_BUFFER_INIT_SIZE;
+module_param(mtp_tx_req_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_tx_req_len, "MTP IN request buffer size in bytes");
+
+static unsigned int mtp_tx_reqs = MTP_TX_REQ_INIT;
+module_param(mtp_tx_reqs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_tx_reqs, "number of MTP IN requests");
+
+static unsigned int mtp_rx_req_len = MTP_RX_BUFFER_INIT_SIZE;
+module_param(mtp_rx_req_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_rx_req_len, "MTP OUT request buffer size in bytes");
+
+static unsigned int mtp_rx_reqs = MTP_RX_REQ_INIT;
+module_param(mtp_rx_reqs, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(mtp_rx_reqs, "number of MTP OUT requests (max 16)");
+
 /* ID for Microsoft MTP OS String */
 #define MTP_OS_STRING_ID   0xEE
 
@@ -91,8 +115,15 @@ struct mtp_dev {
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
 	wait_queue_head_t intr_wq;
-	struct usb_request *rx_req[RX_REQ_MAX];
-	int rx_done;
+	struct usb_request *rx_req[MTP_RX_REQ_MAX];
+	/* number of OUT requests completed since the counter was reset */
+	atomic_t rx_done;
+
+	/* request geometry in use for the current binding */
+	unsigned tx_req_len;
+	unsigned tx_reqs;
+	unsigned rx_req_len;
+	unsigned rx_reqs;
 
 	/* for processing MTP_SEND_FILE, MTP_RECEIVE_FILE and
 	 * MTP_SEND_FILE_WITH_HEADER ioctls on a work queue
@@ -361,8 +392,9 @@ static void mtp_complete_out(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
 
-	dev->rx_done = 1;
-	if (req->status != 0)
+	atomic_inc(&dev->rx_done);
+	/* requests we dequeue ourselves complete with -ECONNRESET */
+	if (req->status != 0 && req->status != -ECONNRESET)
 		dev->state = STATE_ERROR;
 
 	wake_up(&dev->read_wq);
@@ -419,21 +451,44 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	ep->driver_data = dev;		/* claim the endpoint */
 	dev->ep_intr = ep;
 
+	dev->tx_req_len = max_t(unsigned, mtp_tx_req_len, MTP_BULK_BUFFER_SIZE);
+	dev->tx_reqs = clamp_t(unsigned, mtp_tx_reqs, 2, 64);
+	dev->rx_req_len = max_t(unsigned, mtp_rx_req_len, MTP_BULK_BUFFER_SIZE);
+	dev->rx_reqs = clamp_t(unsigned, mtp_rx_reqs, 2, MTP_RX_REQ_MAX);
+
 	/* now allocate requests for our endpoints */
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_in, MTP_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+retry_tx_alloc:
+	for (i = 0; i < dev->tx_reqs; i++) {
+		req = mtp_request_new(dev->ep_in, dev->tx_req_len);
+		if (!req) {
+			if (dev->tx_req_len <= MTP_BULK_BUFFER_SIZE)
+				goto fail;
+			while ((req = mtp_req_get(dev, &dev->tx_idle)))
+				mtp_request_free(req, dev->ep_in);
+			dev->tx_req_len = MTP_BULK_BUFFER_SIZE;
+			goto retry_tx_alloc;
+		}
 		req->complete = mtp_complete_in;
 		mtp_req_put(dev, &dev->tx_idle, req);
 	}
-	for (i = 0; i < RX_REQ_MAX; i++) {
-		req = mtp_request_new(dev->ep_out, MTP_BULK_BUFFER_SIZE);
-		if (!req)
-			goto fail;
+retry_rx_alloc:
+	for (i = 0; i < dev->rx_reqs; i++) {
+		req = mtp_request_new(dev->ep_out, dev->rx_req_len);
+		if (!req) {
+			if (dev->rx_req_len <= MTP_BULK_BUFFER_SIZE)
+				goto fail;
+			while (--i >= 0) {
+				mtp_request_free(dev->rx_req[i], dev->ep_out);
+				dev->rx_req[i] = NULL;
+			}
+			dev->rx_req_len = MTP_BULK_BUFFER_SIZE;
+			goto retry_rx_alloc;
+		}
 		req->complete = mtp_complete_out;
 		dev->rx_req[i] = req;
 	}
+	DBG(cdev, "tx %u x %u bytes, rx %u x %u bytes\n",
+		dev->tx_reqs, dev->tx_req_len, dev->rx_reqs, dev->rx_req_len);
 	for (i = 0; i < INTR_REQ_MAX; i++) {
 		req = mtp_request_new(dev->ep_intr, INTR_BUFFER_SIZE);
 		if (!req)
@@ -460,7 +515,7 @@ static ssize_t mtp_read(struct file *fp, char __user *buf,
 
 	DBG(cdev, "mtp_read(%d)\n", count);
 
-	if (count > MTP_BULK_BUFFER_SIZE)
+	if (count > dev->rx_req_len)
 		return -EINVAL;
 
 	/* we will block until we're online */
@@ -485,7 +540,7 @@ requeue_req:
 	/* queue a request */
 	req = dev->rx_req[0];
 	req->length = count;
-	dev->rx_done = 0;
+	atomic_set(&dev->rx_done, 0);
 	ret = usb_ep_queue(dev->ep_out, req, GFP_KERNEL);
 	if (ret < 0) {
 		r = -EIO;
@@ -495,7 +550,8 @@ requeue_req:
 	}
 
 	/* wait for a request to complete */
-	ret = wait_event_interruptible(dev->read_wq, dev->rx_done);
+	ret = wait_event_interruptible(dev->read_wq,
+		atomic_read(&dev->rx_done));
 	if (ret < 0) {
 		r = ret;
 		usb_ep_dequeue(dev->ep_out, req);
@@ -580,8 +636,8 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > dev->tx_req_len)
+			xfer = dev->tx_req_len;
 		else
 			xfer = count;
 		if (xfer && copy_from_user(req->buf, buf, xfer)) {
@@ -672,8 +728,8 @@ static void send_file_work(struct work_struct *data) {
 			break;
 		}
 
-		if (count > MTP_BULK_BUFFER_SIZE)
-			xfer = MTP_BULK_BUFFER_SIZE;
+		if (count > dev->tx_req_len)
+			xfer = dev->tx_req_len;
 		else
 			xfer = count;
 
@@ -718,16 +774,25 @@ static void send_file_work(struct work_struct *data) {
 	smp_wmb();
 }
 
+/* cancel the OUT requests still queued on the endpoint */
+static void mtp_dequeue_rx(struct mtp_dev *dev, int tail, int queued)
+{
+	while (queued-- > 0) {
+		usb_ep_dequeue(dev->ep_out, dev->rx_req[tail]);
+		tail = (tail + 1) % dev->rx_reqs;
+	}
+}
+
 /* read from USB and write to a local file */
 static void receive_file_work(struct work_struct *data)
 {
 	struct mtp_dev	*dev = container_of(data, struct mtp_dev, receive_file_work);
 	struct usb_composite_dev *cdev = dev->cdev;
-	struct usb_request *read_req = NULL, *write_req = NULL;
+	struct usb_request *req, *write_req = NULL;
 	struct file *filp;
 	loff_t offset;
-	int64_t count;
-	int ret, cur_buf = 0;
+	int64_t count, pending;
+	int ret, depth, head = 0, tail = 0, queued = 0, done = 0;
 	int r = 0;
 
 	/* read our parameters */
@@ -738,22 +803,38 @@ static void receive_file_work(struct work_struct *data)
 
 	DBG(cdev, "receive_file_work(%lld)\n", count);
 
-	while (count > 0 || write_req) {
-		if (count > 0) {
-			/* queue a request */
-			read_req = dev->rx_req[cur_buf];
-			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
-
-			read_req->length = (count > MTP_BULK_BUFFER_SIZE
-					? MTP_BULK_BUFFER_SIZE : count);
-			dev->rx_done = 0;
-			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
+	/* One slot of the ring is always held by the buffer being written
+	 * to the file while the others stay queued on the endpoint.
+	 * If xfer_file_length is 0xFFFFFFFF the transfer is terminated by a
+	 * short packet, so only read one request ahead to avoid consuming
+	 * data that belongs to the next transaction.
+	 */
+	if (count == 0xFFFFFFFF)
+		depth = 1;
+	else
+		depth = dev->rx_reqs - 1;
+	pending = count;
+	atomic_set(&dev->rx_done, 0);
+
+	while (1) {
+		/* keep the OUT pipe full */
+		while (pending > 0 && queued < depth) {
+			req = dev->rx_req[head];
+			req->length = (pending > dev->rx_req_len
+					? dev->rx_req_len : pending);
+			ret = usb_ep_queue(dev->ep_out, req, GFP_KERNEL);
 			if (ret < 0) {
 				r = -EIO;
 				dev->state = STATE_ERROR;
 				break;
 			}
+			if (pending != 0xFFFFFFFF)
+				pending -= req->length;
+			head = (head + 1) % dev->rx_reqs;
+			queued++;
 		}
+		if (r)
+			break;
 
 		if (write_req) {
 			DBG(cdev, "rx %p %d\n", write_req, write_req->actual);
@@ -768,32 +849,44 @@ static void receive_file_work(struct work_struct *data)
 			write_req = NULL;
 		}
 
-		if (read_req) {
-			/* wait for our last read to complete */
-			ret = wait_event_interruptible(dev->read_wq,
-				dev->rx_done || dev->state != STATE_BUSY);
-			if (dev->state == STATE_CANCELED) {
-				r = -ECANCELED;
-				if (!dev->rx_done)
-					usb_ep_dequeue(dev->ep_out, read_req);
-				break;
-			}
-			/* if xfer_file_length is 0xFFFFFFFF, then we read until
-			 * we get a zero length packet
-			 */
-			if (count != 0xFFFFFFFF)
-				count -= read_req->actual;
-			if (read_req->actual < read_req->length) {
-				/* short packet is used to signal EOF for sizes > 4 gig */
-				DBG(cdev, "got short packet\n");
-				count = 0;
-			}
+		if (!queued)
+			break;
 
-			write_req = read_req;
-			read_req = NULL;
+		/* wait for the oldest read; the endpoint completes in order */
+		ret = wait_event_interruptible(dev->read_wq,
+			atomic_read(&dev->rx_done) > done
+			|| dev->state != STATE_BUSY);
+		if (dev->state == STATE_CANCELED) {
+			r = -ECANCELED;
+			break;
+		}
+		if (atomic_read(&dev->rx_done) <= done) {
+			r = ret < 0 ? ret : -EIO;
+			break;
 		}
+
+		req = dev->rx_req[tail];
+		tail = (tail + 1) % dev->rx_reqs;
+		queued--;
+		done++;
+
+		if (count != 0xFFFFFFFF)
+			count -= req->actual;
+		if (req->actual < req->length) {
+			/* short packet is used to signal EOF for sizes > 4 gig */
+			DBG(cdev, "got short packet\n");
+			count = 0;
+			pending = 0;
+			mtp_dequeue_rx(dev, tail, queued);
+			queued = 0;
+		}
+
+		write_req = req;
 	}
 
+	if (queued)
+		mtp_dequeue_rx(dev, tail, queued);
+
 	DBG(cdev, "receive_file_work returning %d\n", r);
 	/* write the result */
 	dev->xfer_result = r;
@@ -1126,8 +1219,10 @@ mtp_function_unbind(struct usb_configuration *c, struct usb_function *f)
 
 	while ((req = mtp_req_get(dev, &dev->tx_idle)))
 		mtp_request_free(req, dev->ep_in);
-	for (i = 0; i < RX_REQ_MAX; i++)
+	for (i = 0; i < dev->rx_reqs; i++) {
 		mtp_request_free(dev->rx_req[i], dev->ep_out);
+		dev->rx_req[i] = NULL;
+	}
 	while ((req = mtp_req_get(dev, &dev->intr_idle)))
 		mtp_request_free(req, dev->ep_intr);
 	dev->state = STATE_OFFLINE;
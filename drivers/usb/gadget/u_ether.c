@@ -480,6 +480,8 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	dev->net->stats.tx_packets++;
 
 	spin_lock(&dev->req_lock);
+	/* req_lock serializes byte queue accounting with eth_start_xmit */
+	netdev_completed_queue(dev->net, 1, skb->len);
 	list_add(&req->list, &dev->tx_reqs);
 	spin_unlock(&dev->req_lock);
 	dev_kfree_skb_any(skb);
@@ -604,6 +606,9 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 			? ((atomic_read(&dev->tx_qlen) % qmult) != 0)
 			: 0;
 
+	/* account before queueing, the request may complete right away */
+	netdev_sent_queue(net, skb->len);
+
 	retval = usb_ep_queue(in, req, GFP_ATOMIC);
 	switch (retval) {
 	default:
@@ -615,6 +620,9 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	}
 
 	if (retval) {
+		spin_lock_irqsave(&dev->req_lock, flags);
+		netdev_completed_queue(net, 1, skb->len);
+		spin_unlock_irqrestore(&dev->req_lock, flags);
 		dev_kfree_skb_any(skb);
 drop:
 		dev->net->stats.tx_dropped++;
@@ -638,6 +646,7 @@ static void eth_start(struct eth_dev *dev, gfp_t gfp_flags)
 
 	/* and open the tx floodgates */
 	atomic_set(&dev->tx_qlen, 0);
+	netdev_reset_queue(dev->net);
 	netif_wake_queue(dev->net);
 }
 
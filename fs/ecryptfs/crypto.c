@@ -37,17 +37,6 @@
 #include <asm/unaligned.h>
 #include "ecryptfs_kernel.h"
 
-static int
-ecryptfs_decrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv);
-static int
-ecryptfs_encrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv);
-
 /**
  * ecryptfs_to_hex
  * @dst: Buffer to take hex character representation of contents of
@@ -243,7 +232,7 @@ void ecryptfs_destroy_crypt_stat(struct ecryptfs_crypt_stat *crypt_stat)
 	struct ecryptfs_key_sig *key_sig, *key_sig_tmp;
 
 	if (crypt_stat->tfm)
-		crypto_free_blkcipher(crypt_stat->tfm);
+		crypto_free_ablkcipher(crypt_stat->tfm);
 	if (crypt_stat->hash_tfm)
 		crypto_free_hash(crypt_stat->hash_tfm);
 	list_for_each_entry_safe(key_sig, key_sig_tmp,
@@ -323,142 +312,229 @@ int virt_to_scatterlist(const void *addr, int size, struct scatterlist *sg,
 }
 
 /**
- * encrypt_scatterlist
- * @crypt_stat: Pointer to the crypt_stat struct to initialize.
- * @dest_sg: Destination of encrypted data
- * @src_sg: Data to be encrypted
- * @size: Length of data to be encrypted
- * @iv: iv to use during encryption
+ * ecryptfs_set_tfm_key
+ * @crypt_stat: The cryptographic context
+ *
+ * Sets the file key on the tfm, once. Extent requests in flight only read
+ * the expanded key, so there is nothing to serialize after this.
  *
- * Returns the number of bytes encrypted; negative value on error
+ * Returns zero on success; non-zero on error
  */
-static int encrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
-			       struct scatterlist *dest_sg,
-			       struct scatterlist *src_sg, int size,
-			       unsigned char *iv)
+static int ecryptfs_set_tfm_key(struct ecryptfs_crypt_stat *crypt_stat)
 {
-	struct blkcipher_desc desc = {
-		.tfm = crypt_stat->tfm,
-		.info = iv,
-		.flags = CRYPTO_TFM_REQ_MAY_SLEEP
-	};
 	int rc = 0;
 
 	BUG_ON(!crypt_stat || !crypt_stat->tfm
 	       || !(crypt_stat->flags & ECRYPTFS_STRUCT_INITIALIZED));
+	mutex_lock(&crypt_stat->cs_tfm_mutex);
+	if (crypt_stat->flags & ECRYPTFS_KEY_SET)
+		goto out_unlock;
 	if (unlikely(ecryptfs_verbosity > 0)) {
 		ecryptfs_printk(KERN_DEBUG, "Key size [%zd]; key:\n",
 				crypt_stat->key_size);
 		ecryptfs_dump_hex(crypt_stat->key,
 				  crypt_stat->key_size);
 	}
-	/* Consider doing this once, when the file is opened */
-	mutex_lock(&crypt_stat->cs_tfm_mutex);
-	if (!(crypt_stat->flags & ECRYPTFS_KEY_SET)) {
-		rc = crypto_blkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
-					     crypt_stat->key_size);
-		crypt_stat->flags |= ECRYPTFS_KEY_SET;
-	}
+	rc = crypto_ablkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
+				      crypt_stat->key_size);
 	if (rc) {
 		ecryptfs_printk(KERN_ERR, "Error setting key; rc = [%d]\n",
 				rc);
-		mutex_unlock(&crypt_stat->cs_tfm_mutex);
 		rc = -EINVAL;
-		goto out;
+		goto out_unlock;
 	}
-	ecryptfs_printk(KERN_DEBUG, "Encrypting [%d] bytes.\n", size);
-	crypto_blkcipher_encrypt_iv(&desc, dest_sg, src_sg, size);
+	crypt_stat->flags |= ECRYPTFS_KEY_SET;
+out_unlock:
 	mutex_unlock(&crypt_stat->cs_tfm_mutex);
-out:
 	return rc;
 }
 
+/* One extent in flight, the tfm's request context follows @req */
+struct ecryptfs_extent_req {
+	struct list_head list;
+	struct ecryptfs_crypt_batch *batch;
+	struct scatterlist src_sg;
+	struct scatterlist dst_sg;
+	char iv[ECRYPTFS_MAX_IV_BYTES];
+	struct ablkcipher_request req;
+};
+
+static void ecryptfs_extent_done(struct crypto_async_request *areq, int err)
+{
+	struct ecryptfs_extent_req *extent_req = areq->data;
+	struct ecryptfs_crypt_batch *batch = extent_req->batch;
+
+	/* A backlogged request has been started; it completes later */
+	if (err == -EINPROGRESS)
+		return;
+	if (err)
+		batch->rc = err;
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
 /**
- * ecryptfs_lower_offset_for_extent
+ * ecryptfs_init_crypt_batch
+ * @batch: The batch to initialize
+ * @crypt_stat: The cryptographic context of the file
  *
- * Convert an eCryptfs page index into a lower byte offset
+ * Prepares @batch for queueing extents and makes sure the file key is
+ * set on the tfm. Once this succeeds, ecryptfs_finish_crypt_batch() must
+ * be called, whether or not queueing extents fails.
+ *
+ * Returns zero on success; non-zero on error
  */
-static void ecryptfs_lower_offset_for_extent(loff_t *offset, loff_t extent_num,
-					     struct ecryptfs_crypt_stat *crypt_stat)
+int ecryptfs_init_crypt_batch(struct ecryptfs_crypt_batch *batch,
+			      struct ecryptfs_crypt_stat *crypt_stat)
 {
-	(*offset) = ecryptfs_lower_header_size(crypt_stat)
-		    + (crypt_stat->extent_size * extent_num);
+	batch->crypt_stat = crypt_stat;
+	/* The submitter holds a count, so completions cannot reach zero early */
+	atomic_set(&batch->pending, 1);
+	batch->rc = 0;
+	init_completion(&batch->done);
+	INIT_LIST_HEAD(&batch->reqs);
+	INIT_LIST_HEAD(&batch->enc_pages);
+	return ecryptfs_set_tfm_key(crypt_stat);
 }
 
 /**
- * ecryptfs_encrypt_extent
- * @enc_extent_page: Allocated page into which to encrypt the data in
- *                   @page
- * @crypt_stat: crypt_stat containing cryptographic context for the
- *              encryption operation
- * @page: Page containing plaintext data extent to encrypt
+ * ecryptfs_finish_crypt_batch
+ * @batch: The batch to wait for
+ *
+ * Waits for every extent queued on @batch and releases the requests and
+ * the pages that held the encrypted data.
+ *
+ * Returns zero if every extent was processed; non-zero otherwise
+ */
+int ecryptfs_finish_crypt_batch(struct ecryptfs_crypt_batch *batch)
+{
+	struct ecryptfs_extent_req *extent_req, *extent_req_tmp;
+	struct page *enc_page, *enc_page_tmp;
+
+	if (!atomic_dec_and_test(&batch->pending))
+		wait_for_completion(&batch->done);
+	list_for_each_entry_safe(extent_req, extent_req_tmp, &batch->reqs,
+				 list) {
+		list_del(&extent_req->list);
+		kfree(extent_req);
+	}
+	list_for_each_entry_safe(enc_page, enc_page_tmp, &batch->enc_pages,
+				 lru) {
+		list_del(&enc_page->lru);
+		__free_page(enc_page);
+	}
+	return batch->rc;
+}
+
+/**
+ * ecryptfs_queue_extent
+ * @batch: The batch to add the extent to
+ * @page: Page from the eCryptfs inode holding the plaintext
+ * @enc_page: Page holding the ciphertext of all of @page's extents
  * @extent_offset: Page extent offset for use in generating IV
+ * @encrypt: Encrypt from @page to @enc_page if set, decrypt the other
+ *           way otherwise
  *
- * Encrypts one extent of data.
+ * Starts the encryption or decryption of one extent without waiting for
+ * it; the extent sits at the same offset in @page and @enc_page.
  *
- * Return zero on success; non-zero otherwise
+ * Returns zero on success; non-zero otherwise
  */
-static int ecryptfs_encrypt_extent(struct page *enc_extent_page,
-				   struct ecryptfs_crypt_stat *crypt_stat,
-				   struct page *page,
-				   unsigned long extent_offset)
+static int ecryptfs_queue_extent(struct ecryptfs_crypt_batch *batch,
+				 struct page *page, struct page *enc_page,
+				 unsigned long extent_offset, int encrypt)
 {
+	struct ecryptfs_crypt_stat *crypt_stat = batch->crypt_stat;
+	struct ecryptfs_extent_req *extent_req;
+	size_t size = crypt_stat->extent_size;
+	unsigned int offset = extent_offset * size;
 	loff_t extent_base;
-	char extent_iv[ECRYPTFS_MAX_IV_BYTES];
 	int rc;
 
+	extent_req = kmalloc(sizeof(*extent_req)
+			     + crypto_ablkcipher_reqsize(crypt_stat->tfm),
+			     GFP_NOFS);
+	if (!extent_req) {
+		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
+				"extent request\n");
+		return -ENOMEM;
+	}
 	extent_base = (((loff_t)page->index)
 		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
-	rc = ecryptfs_derive_iv(extent_iv, crypt_stat,
+	rc = ecryptfs_derive_iv(extent_req->iv, crypt_stat,
 				(extent_base + extent_offset));
 	if (rc) {
 		ecryptfs_printk(KERN_ERR, "Error attempting to derive IV for "
 			"extent [0x%.16llx]; rc = [%d]\n",
 			(unsigned long long)(extent_base + extent_offset), rc);
-		goto out;
+		kfree(extent_req);
+		return rc;
 	}
 	if (unlikely(ecryptfs_verbosity > 0)) {
-		ecryptfs_printk(KERN_DEBUG, "Encrypting extent "
-				"with iv:\n");
-		ecryptfs_dump_hex(extent_iv, crypt_stat->iv_bytes);
-		ecryptfs_printk(KERN_DEBUG, "First 8 bytes before "
-				"encryption:\n");
-		ecryptfs_dump_hex((char *)
-				  (page_address(page)
-				   + (extent_offset * crypt_stat->extent_size)),
-				  8);
-	}
-	rc = ecryptfs_encrypt_page_offset(crypt_stat, enc_extent_page, 0,
-					  page, (extent_offset
-						 * crypt_stat->extent_size),
-					  crypt_stat->extent_size, extent_iv);
-	if (rc < 0) {
-		printk(KERN_ERR "%s: Error attempting to encrypt page with "
+		ecryptfs_printk(KERN_DEBUG, "%s extent [0x%.16llx] with iv:\n",
+				encrypt ? "Encrypting" : "Decrypting",
+				(unsigned long long)(extent_base
+						     + extent_offset));
+		ecryptfs_dump_hex(extent_req->iv, crypt_stat->iv_bytes);
+	}
+	sg_init_table(&extent_req->src_sg, 1);
+	sg_init_table(&extent_req->dst_sg, 1);
+	if (encrypt) {
+		sg_set_page(&extent_req->src_sg, page, size, offset);
+		sg_set_page(&extent_req->dst_sg, enc_page, size, offset);
+	} else {
+		sg_set_page(&extent_req->src_sg, enc_page, size, offset);
+		sg_set_page(&extent_req->dst_sg, page, size, offset);
+	}
+	extent_req->batch = batch;
+	ablkcipher_request_set_tfm(&extent_req->req, crypt_stat->tfm);
+	ablkcipher_request_set_callback(&extent_req->req,
+					CRYPTO_TFM_REQ_MAY_BACKLOG
+					| CRYPTO_TFM_REQ_MAY_SLEEP,
+					ecryptfs_extent_done, extent_req);
+	ablkcipher_request_set_crypt(&extent_req->req, &extent_req->src_sg,
+				     &extent_req->dst_sg, size,
+				     extent_req->iv);
+	list_add_tail(&extent_req->list, &batch->reqs);
+	atomic_inc(&batch->pending);
+	if (encrypt)
+		rc = crypto_ablkcipher_encrypt(&extent_req->req);
+	else
+		rc = crypto_ablkcipher_decrypt(&extent_req->req);
+	if (rc == -EINPROGRESS || rc == -EBUSY)
+		return 0;
+	/* Done synchronously, so the completion callback is not called */
+	atomic_dec(&batch->pending);
+	if (rc) {
+		printk(KERN_ERR "%s: Error attempting to %s extent with "
 		       "page->index = [%ld], extent_offset = [%ld]; "
-		       "rc = [%d]\n", __func__, page->index, extent_offset,
-		       rc);
-		goto out;
-	}
-	rc = 0;
-	if (unlikely(ecryptfs_verbosity > 0)) {
-		ecryptfs_printk(KERN_DEBUG, "Encrypt extent [0x%.16llx]; "
-			"rc = [%d]\n",
-			(unsigned long long)(extent_base + extent_offset), rc);
-		ecryptfs_printk(KERN_DEBUG, "First 8 bytes after "
-				"encryption:\n");
-		ecryptfs_dump_hex((char *)(page_address(enc_extent_page)), 8);
+		       "rc = [%d]\n", __func__, encrypt ? "encrypt" : "decrypt",
+		       page->index, extent_offset, rc);
+		batch->rc = rc;
 	}
-out:
 	return rc;
 }
 
+/**
+ * ecryptfs_lower_offset_for_extent
+ *
+ * Convert an eCryptfs page index into a lower byte offset
+ */
+static void ecryptfs_lower_offset_for_extent(loff_t *offset, loff_t extent_num,
+					     struct ecryptfs_crypt_stat *crypt_stat)
+{
+	(*offset) = ecryptfs_lower_header_size(crypt_stat)
+		    + (crypt_stat->extent_size * extent_num);
+}
+
 /**
  * ecryptfs_encrypt_page
  * @page: Page mapped from the eCryptfs inode for the file; contains
  *        decrypted content that needs to be encrypted (to a temporary
  *        page; not in place) and written out to the lower file
  *
- * Encrypt an eCryptfs page. This is done on a per-extent basis. Note
+ * Encrypt an eCryptfs page. This is done on a per-extent basis, with
+ * all of the page's extents in flight at once. Note
  * that eCryptfs pages may straddle the lower pages -- for instance,
  * if the file was created on a machine with an 8K page size
  * (resulting in an 8K header), and then the file is copied onto a
@@ -472,15 +548,19 @@ int ecryptfs_encrypt_page(struct page *page)
 {
 	struct inode *ecryptfs_inode;
 	struct ecryptfs_crypt_stat *crypt_stat;
-	char *enc_extent_virt;
+	struct ecryptfs_crypt_batch batch;
 	struct page *enc_extent_page = NULL;
-	loff_t extent_offset;
+	unsigned long extents_per_page;
+	unsigned long extent_offset;
+	loff_t offset;
 	int rc = 0;
+	int rc_batch;
 
 	ecryptfs_inode = page->mapping->host;
 	crypt_stat =
 		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
 	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
+	extents_per_page = PAGE_CACHE_SIZE / crypt_stat->extent_size;
 	enc_extent_page = alloc_page(GFP_USER);
 	if (!enc_extent_page) {
 		rc = -ENOMEM;
@@ -488,273 +568,137 @@ int ecryptfs_encrypt_page(struct page *page)
 				"encrypted extent\n");
 		goto out;
 	}
-	enc_extent_virt = kmap(enc_extent_page);
-	for (extent_offset = 0;
-	     extent_offset < (PAGE_CACHE_SIZE / crypt_stat->extent_size);
+	rc = ecryptfs_init_crypt_batch(&batch, crypt_stat);
+	if (rc)
+		goto out;
+	for (extent_offset = 0; extent_offset < extents_per_page;
 	     extent_offset++) {
-		loff_t offset;
-
-		rc = ecryptfs_encrypt_extent(enc_extent_page, crypt_stat, page,
-					     extent_offset);
-		if (rc) {
-			printk(KERN_ERR "%s: Error encrypting extent; "
-			       "rc = [%d]\n", __func__, rc);
-			goto out;
-		}
-		ecryptfs_lower_offset_for_extent(
-			&offset, ((((loff_t)page->index)
-				   * (PAGE_CACHE_SIZE
-				      / crypt_stat->extent_size))
-				  + extent_offset), crypt_stat);
-		rc = ecryptfs_write_lower(ecryptfs_inode, enc_extent_virt,
-					  offset, crypt_stat->extent_size);
-		if (rc < 0) {
-			ecryptfs_printk(KERN_ERR, "Error attempting "
-					"to write lower page; rc = [%d]"
-					"\n", rc);
-			goto out;
-		}
-	}
-	rc = 0;
-out:
-	if (enc_extent_page) {
-		kunmap(enc_extent_page);
-		__free_page(enc_extent_page);
+		rc = ecryptfs_queue_extent(&batch, page, enc_extent_page,
+					   extent_offset, 1);
+		if (rc)
+			break;
 	}
-	return rc;
-}
-
-static int ecryptfs_decrypt_extent(struct page *page,
-				   struct ecryptfs_crypt_stat *crypt_stat,
-				   struct page *enc_extent_page,
-				   unsigned long extent_offset)
-{
-	loff_t extent_base;
-	char extent_iv[ECRYPTFS_MAX_IV_BYTES];
-	int rc;
-
-	extent_base = (((loff_t)page->index)
-		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
-	rc = ecryptfs_derive_iv(extent_iv, crypt_stat,
-				(extent_base + extent_offset));
+	rc_batch = ecryptfs_finish_crypt_batch(&batch);
+	if (!rc)
+		rc = rc_batch;
 	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error attempting to derive IV for "
-			"extent [0x%.16llx]; rc = [%d]\n",
-			(unsigned long long)(extent_base + extent_offset), rc);
+		printk(KERN_ERR "%s: Error encrypting extent; "
+		       "rc = [%d]\n", __func__, rc);
 		goto out;
 	}
-	if (unlikely(ecryptfs_verbosity > 0)) {
-		ecryptfs_printk(KERN_DEBUG, "Decrypting extent "
-				"with iv:\n");
-		ecryptfs_dump_hex(extent_iv, crypt_stat->iv_bytes);
-		ecryptfs_printk(KERN_DEBUG, "First 8 bytes before "
-				"decryption:\n");
-		ecryptfs_dump_hex((char *)
-				  (page_address(enc_extent_page)
-				   + (extent_offset * crypt_stat->extent_size)),
-				  8);
-	}
-	rc = ecryptfs_decrypt_page_offset(crypt_stat, page,
-					  (extent_offset
-					   * crypt_stat->extent_size),
-					  enc_extent_page, 0,
-					  crypt_stat->extent_size, extent_iv);
+	/* The extents of a page are contiguous in the lower file */
+	ecryptfs_lower_offset_for_extent(
+		&offset, ((loff_t)page->index) * extents_per_page, crypt_stat);
+	rc = ecryptfs_write_lower(ecryptfs_inode, kmap(enc_extent_page),
+				  offset, PAGE_CACHE_SIZE);
+	kunmap(enc_extent_page);
 	if (rc < 0) {
-		printk(KERN_ERR "%s: Error attempting to decrypt to page with "
-		       "page->index = [%ld], extent_offset = [%ld]; "
-		       "rc = [%d]\n", __func__, page->index, extent_offset,
-		       rc);
+		ecryptfs_printk(KERN_ERR, "Error attempting "
+				"to write lower page; rc = [%d]"
+				"\n", rc);
 		goto out;
 	}
 	rc = 0;
-	if (unlikely(ecryptfs_verbosity > 0)) {
-		ecryptfs_printk(KERN_DEBUG, "Decrypt extent [0x%.16llx]; "
-			"rc = [%d]\n",
-			(unsigned long long)(extent_base + extent_offset), rc);
-		ecryptfs_printk(KERN_DEBUG, "First 8 bytes after "
-				"decryption:\n");
-		ecryptfs_dump_hex((char *)(page_address(page)
-					   + (extent_offset
-					      * crypt_stat->extent_size)), 8);
-	}
 out:
+	if (enc_extent_page)
+		__free_page(enc_extent_page);
 	return rc;
 }
 
 /**
- * ecryptfs_decrypt_page
+ * ecryptfs_queue_decrypt_page
+ * @batch: The batch to add the page's extents to
  * @page: Page mapped from the eCryptfs inode for the file; data read
  *        and decrypted from the lower file will be written into this
  *        page
  *
- * Decrypt an eCryptfs page. This is done on a per-extent basis. Note
- * that eCryptfs pages may straddle the lower pages -- for instance,
- * if the file was created on a machine with an 8K page size
- * (resulting in an 8K header), and then the file is copied onto a
- * host with a 32K page size, then when reading page 0 of the eCryptfs
- * file, 24K of page 0 of the lower file will be read and decrypted,
- * and then 8K of page 1 of the lower file will be read and decrypted.
+ * Reads the encrypted extents of @page from the lower file and starts
+ * their decryption. @page holds the plaintext once
+ * ecryptfs_finish_crypt_batch() has returned zero.
  *
  * Returns zero on success; negative on error
  */
-int ecryptfs_decrypt_page(struct page *page)
+int ecryptfs_queue_decrypt_page(struct ecryptfs_crypt_batch *batch,
+				struct page *page)
 {
-	struct inode *ecryptfs_inode;
-	struct ecryptfs_crypt_stat *crypt_stat;
-	char *enc_extent_virt;
-	struct page *enc_extent_page = NULL;
+	struct inode *ecryptfs_inode = page->mapping->host;
+	struct ecryptfs_crypt_stat *crypt_stat = batch->crypt_stat;
+	struct page *enc_extent_page;
+	unsigned long extents_per_page;
 	unsigned long extent_offset;
-	int rc = 0;
+	loff_t offset;
+	int rc;
 
-	ecryptfs_inode = page->mapping->host;
-	crypt_stat =
-		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
 	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
+	extents_per_page = PAGE_CACHE_SIZE / crypt_stat->extent_size;
 	enc_extent_page = alloc_page(GFP_USER);
 	if (!enc_extent_page) {
-		rc = -ENOMEM;
 		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
 				"encrypted extent\n");
-		goto out;
+		return -ENOMEM;
 	}
-	enc_extent_virt = kmap(enc_extent_page);
-	for (extent_offset = 0;
-	     extent_offset < (PAGE_CACHE_SIZE / crypt_stat->extent_size);
+	list_add_tail(&enc_extent_page->lru, &batch->enc_pages);
+	ecryptfs_lower_offset_for_extent(
+		&offset, ((loff_t)page->index) * extents_per_page, crypt_stat);
+	rc = ecryptfs_read_lower(kmap(enc_extent_page), offset,
+				 PAGE_CACHE_SIZE, ecryptfs_inode);
+	kunmap(enc_extent_page);
+	if (rc < 0) {
+		ecryptfs_printk(KERN_ERR, "Error attempting "
+				"to read lower page; rc = [%d]"
+				"\n", rc);
+		return rc;
+	}
+	for (extent_offset = 0; extent_offset < extents_per_page;
 	     extent_offset++) {
-		loff_t offset;
-
-		ecryptfs_lower_offset_for_extent(
-			&offset, ((page->index * (PAGE_CACHE_SIZE
-						  / crypt_stat->extent_size))
-				  + extent_offset), crypt_stat);
-		rc = ecryptfs_read_lower(enc_extent_virt, offset,
-					 crypt_stat->extent_size,
-					 ecryptfs_inode);
-		if (rc < 0) {
-			ecryptfs_printk(KERN_ERR, "Error attempting "
-					"to read lower page; rc = [%d]"
-					"\n", rc);
-			goto out;
-		}
-		rc = ecryptfs_decrypt_extent(page, crypt_stat, enc_extent_page,
-					     extent_offset);
+		rc = ecryptfs_queue_extent(batch, page, enc_extent_page,
+					   extent_offset, 0);
 		if (rc) {
-			printk(KERN_ERR "%s: Error encrypting extent; "
+			printk(KERN_ERR "%s: Error decrypting extent; "
 			       "rc = [%d]\n", __func__, rc);
-			goto out;
+			return rc;
 		}
 	}
-out:
-	if (enc_extent_page) {
-		kunmap(enc_extent_page);
-		__free_page(enc_extent_page);
-	}
-	return rc;
+	return 0;
 }
 
 /**
- * decrypt_scatterlist
- * @crypt_stat: Cryptographic context
- * @dest_sg: The destination scatterlist to decrypt into
- * @src_sg: The source scatterlist to decrypt from
- * @size: The number of bytes to decrypt
- * @iv: The initialization vector to use for the decryption
+ * ecryptfs_decrypt_page
+ * @page: Page mapped from the eCryptfs inode for the file; data read
+ *        and decrypted from the lower file will be written into this
+ *        page
  *
- * Returns the number of bytes decrypted; negative value on error
+ * Decrypt an eCryptfs page. This is done on a per-extent basis, with
+ * all of the page's extents in flight at once. Note
+ * that eCryptfs pages may straddle the lower pages -- for instance,
+ * if the file was created on a machine with an 8K page size
+ * (resulting in an 8K header), and then the file is copied onto a
+ * host with a 32K page size, then when reading page 0 of the eCryptfs
+ * file, 24K of page 0 of the lower file will be read and decrypted,
+ * and then 8K of page 1 of the lower file will be read and decrypted.
+ *
+ * Returns zero on success; negative on error
  */
-static int decrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
-			       struct scatterlist *dest_sg,
-			       struct scatterlist *src_sg, int size,
-			       unsigned char *iv)
+int ecryptfs_decrypt_page(struct page *page)
 {
-	struct blkcipher_desc desc = {
-		.tfm = crypt_stat->tfm,
-		.info = iv,
-		.flags = CRYPTO_TFM_REQ_MAY_SLEEP
-	};
-	int rc = 0;
+	struct ecryptfs_crypt_stat *crypt_stat;
+	struct ecryptfs_crypt_batch batch;
+	int rc;
+	int rc_batch;
 
-	/* Consider doing this once, when the file is opened */
-	mutex_lock(&crypt_stat->cs_tfm_mutex);
-	rc = crypto_blkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
-				     crypt_stat->key_size);
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error setting key; rc = [%d]\n",
-				rc);
-		mutex_unlock(&crypt_stat->cs_tfm_mutex);
-		rc = -EINVAL;
-		goto out;
-	}
-	ecryptfs_printk(KERN_DEBUG, "Decrypting [%d] bytes.\n", size);
-	rc = crypto_blkcipher_decrypt_iv(&desc, dest_sg, src_sg, size);
-	mutex_unlock(&crypt_stat->cs_tfm_mutex);
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error decrypting; rc = [%d]\n",
-				rc);
+	crypt_stat =
+		&(ecryptfs_inode_to_private(page->mapping->host)->crypt_stat);
+	rc = ecryptfs_init_crypt_batch(&batch, crypt_stat);
+	if (rc)
 		goto out;
-	}
-	rc = size;
+	rc = ecryptfs_queue_decrypt_page(&batch, page);
+	rc_batch = ecryptfs_finish_crypt_batch(&batch);
+	if (!rc)
+		rc = rc_batch;
 out:
 	return rc;
 }
 
-/**
- * ecryptfs_encrypt_page_offset
- * @crypt_stat: The cryptographic context
- * @dst_page: The page to encrypt into
- * @dst_offset: The offset in the page to encrypt into
- * @src_page: The page to encrypt from
- * @src_offset: The offset in the page to encrypt from
- * @size: The number of bytes to encrypt
- * @iv: The initialization vector to use for the encryption
- *
- * Returns the number of bytes encrypted
- */
-static int
-ecryptfs_encrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv)
-{
-	struct scatterlist src_sg, dst_sg;
-
-	sg_init_table(&src_sg, 1);
-	sg_init_table(&dst_sg, 1);
-
-	sg_set_page(&src_sg, src_page, size, src_offset);
-	sg_set_page(&dst_sg, dst_page, size, dst_offset);
-	return encrypt_scatterlist(crypt_stat, &dst_sg, &src_sg, size, iv);
-}
-
-/**
- * ecryptfs_decrypt_page_offset
- * @crypt_stat: The cryptographic context
- * @dst_page: The page to decrypt into
- * @dst_offset: The offset in the page to decrypt into
- * @src_page: The page to decrypt from
- * @src_offset: The offset in the page to decrypt from
- * @size: The number of bytes to decrypt
- * @iv: The initialization vector to use for the decryption
- *
- * Returns the number of bytes decrypted
- */
-static int
-ecryptfs_decrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv)
-{
-	struct scatterlist src_sg, dst_sg;
-
-	sg_init_table(&src_sg, 1);
-	sg_set_page(&src_sg, src_page, size, src_offset);
-
-	sg_init_table(&dst_sg, 1);
-	sg_set_page(&dst_sg, dst_page, size, dst_offset);
-
-	return decrypt_scatterlist(crypt_stat, &dst_sg, &src_sg, size, iv);
-}
-
 #define ECRYPTFS_MAX_SCATTERLIST_LEN 4
 
 /**
@@ -789,8 +733,7 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat)
 						    crypt_stat->cipher, "cbc");
 	if (rc)
 		goto out_unlock;
-	crypt_stat->tfm = crypto_alloc_blkcipher(full_alg_name, 0,
-						 CRYPTO_ALG_ASYNC);
+	crypt_stat->tfm = crypto_alloc_ablkcipher(full_alg_name, 0, 0);
 	kfree(full_alg_name);
 	if (IS_ERR(crypt_stat->tfm)) {
 		rc = PTR_ERR(crypt_stat->tfm);
@@ -800,7 +743,7 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat)
 				crypt_stat->cipher);
 		goto out_unlock;
 	}
-	crypto_blkcipher_set_flags(crypt_stat->tfm, CRYPTO_TFM_REQ_WEAK_KEY);
+	crypto_ablkcipher_set_flags(crypt_stat->tfm, CRYPTO_TFM_REQ_WEAK_KEY);
 	rc = 0;
 out_unlock:
 	mutex_unlock(&crypt_stat->cs_tfm_mutex);
@@ -36,6 +36,7 @@
 #include <linux/hash.h>
 #include <linux/nsproxy.h>
 #include <linux/backing-dev.h>
+#include <linux/completion.h>
 
 #ifdef CONFIG_WTL_ENCRYPTION_FILTER
 #define ENC_NAME_FILTER_MAX_INSTANCE 5
@@ -288,7 +289,7 @@ struct ecryptfs_crypt_stat {
 	size_t extent_shift;
 	unsigned int extent_mask;
 	struct ecryptfs_mount_crypt_stat *mount_crypt_stat;
-	struct crypto_blkcipher *tfm;
+	struct crypto_ablkcipher *tfm;
 	struct crypto_hash *hash_tfm; /* Crypto context for generating
 				       * the initialization vectors */
 	unsigned char cipher[ECRYPTFS_MAX_CIPHER_NAME_SIZE];
@@ -301,6 +302,21 @@ struct ecryptfs_crypt_stat {
 	struct mutex cs_mutex;
 };
 
+/*
+ * A set of extent encryptions or decryptions in flight on the tfm of one
+ * crypt_stat. The extents of a page, or of all the pages of a readahead
+ * window, are queued without waiting so that an asynchronous cipher can
+ * work on them in parallel, and are then waited for together.
+ */
+struct ecryptfs_crypt_batch {
+	struct ecryptfs_crypt_stat *crypt_stat;
+	atomic_t pending;
+	int rc;
+	struct completion done;
+	struct list_head reqs;
+	struct list_head enc_pages;
+};
+
 /* inode private data. */
 struct ecryptfs_inode_info {
 	struct inode vfs_inode;
@@ -673,6 +689,11 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat);
 int ecryptfs_write_inode_size_to_metadata(struct inode *ecryptfs_inode);
 int ecryptfs_encrypt_page(struct page *page);
 int ecryptfs_decrypt_page(struct page *page);
+int ecryptfs_init_crypt_batch(struct ecryptfs_crypt_batch *batch,
+			      struct ecryptfs_crypt_stat *crypt_stat);
+int ecryptfs_queue_decrypt_page(struct ecryptfs_crypt_batch *batch,
+				struct page *page);
+int ecryptfs_finish_crypt_batch(struct ecryptfs_crypt_batch *batch);
 int ecryptfs_write_metadata(struct dentry *ecryptfs_dentry);
 int ecryptfs_read_metadata(struct dentry *ecryptfs_dentry);
 int ecryptfs_new_file_context(struct dentry *ecryptfs_dentry);
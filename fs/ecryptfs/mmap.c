@@ -26,6 +26,7 @@
  */
 
 #include <linux/pagemap.h>
+#include <linux/pagevec.h>
 #include <linux/writeback.h>
 #include <linux/page-flags.h>
 #include <linux/mount.h>
@@ -251,6 +252,90 @@ out:
 	return rc;
 }
 
+static int ecryptfs_readpage_filler(void *data, struct page *page)
+{
+	return ecryptfs_readpage(data, page);
+}
+
+/*
+ * Decrypts the locked pages in @pvec as one batch and releases them. If
+ * anything fails they are all left !Uptodate, and ecryptfs_readpage()
+ * retries them one at a time when they are actually read.
+ */
+static void ecryptfs_decrypt_pagevec(struct pagevec *pvec,
+				     struct ecryptfs_crypt_stat *crypt_stat)
+{
+	struct ecryptfs_crypt_batch batch;
+	int i, rc, rc_batch;
+
+	rc = ecryptfs_init_crypt_batch(&batch, crypt_stat);
+	if (!rc) {
+		for (i = 0; i < pagevec_count(pvec); i++) {
+			rc = ecryptfs_queue_decrypt_page(&batch,
+							 pvec->pages[i]);
+			if (rc)
+				break;
+		}
+		rc_batch = ecryptfs_finish_crypt_batch(&batch);
+		if (!rc)
+			rc = rc_batch;
+	}
+	if (rc)
+		ecryptfs_printk(KERN_ERR, "Error decrypting readahead pages; "
+				"rc = [%d]\n", rc);
+	for (i = 0; i < pagevec_count(pvec); i++) {
+		if (!rc)
+			SetPageUptodate(pvec->pages[i]);
+		unlock_page(pvec->pages[i]);
+	}
+	pagevec_release(pvec);
+}
+
+/**
+ * ecryptfs_readpages
+ * @file: An eCryptfs file
+ * @mapping: The eCryptfs inode mapping
+ * @pages: Readahead pages, not yet in the page cache
+ * @nr_pages: The number of pages in @pages
+ *
+ * Read in a readahead window. For files that are decrypted, the extents
+ * of up to a pagevec worth of pages are queued on the cipher before any
+ * of them is waited for, so an asynchronous cipher implementation gets
+ * them all to work on at once. Everything else goes page by page through
+ * ecryptfs_readpage().
+ *
+ * Returns zero on success; non-zero on error.
+ */
+static int ecryptfs_readpages(struct file *file, struct address_space *mapping,
+			      struct list_head *pages, unsigned nr_pages)
+{
+	struct ecryptfs_crypt_stat *crypt_stat =
+		&ecryptfs_inode_to_private(mapping->host)->crypt_stat;
+	struct pagevec pvec;
+
+	if (!(crypt_stat->flags & ECRYPTFS_ENCRYPTED)
+	    || (crypt_stat->flags & ECRYPTFS_VIEW_AS_ENCRYPTED))
+		return read_cache_pages(mapping, pages,
+					ecryptfs_readpage_filler, file);
+
+	pagevec_init(&pvec, 0);
+	while (!list_empty(pages)) {
+		struct page *page = list_entry(pages->prev, struct page, lru);
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+					  GFP_KERNEL)) {
+			page_cache_release(page);
+			continue;
+		}
+		if (!pagevec_add(&pvec, page))
+			ecryptfs_decrypt_pagevec(&pvec, crypt_stat);
+	}
+	if (pagevec_count(&pvec))
+		ecryptfs_decrypt_pagevec(&pvec, crypt_stat);
+	return 0;
+}
+
 /**
  * Called with lower inode mutex held.
  */
@@ -560,6 +645,7 @@ static sector_t ecryptfs_bmap(struct address_space *mapping, sector_t block)
 const struct address_space_operations ecryptfs_aops = {
 	.writepage = ecryptfs_writepage,
 	.readpage = ecryptfs_readpage,
+	.readpages = ecryptfs_readpages,
 	.write_begin = ecryptfs_write_begin,
 	.write_end = ecryptfs_write_end,
 	.bmap = ecryptfs_bmap,
@@ -11,6 +11,7 @@
 #include <linux/rmap.h>
 #include <linux/swap.h>
 #include <linux/swapops.h>
+#include <linux/mm_inline.h>
 
 #include <asm/elf.h>
 #include <asm/uaccess.h>
@@ -593,6 +594,149 @@ const struct file_operations proc_clear_refs_operations = {
 	.llseek		= noop_llseek,
 };
 
+#ifdef CONFIG_PROCESS_RECLAIM
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct vm_area_struct *vma = walk->private;
+	pte_t *orig_pte, *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	struct zone *zone;
+	LIST_HEAD(page_list);
+	int nr_isolated[2];
+	int isolated;
+
+	split_huge_page_pmd(walk->mm, pmd);
+cont:
+	isolated = 0;
+	zone = NULL;
+	nr_isolated[0] = nr_isolated[1] = 0;
+	orig_pte = pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+
+		/* Leave pages shared with other processes alone */
+		if (page_mapcount(page) != 1)
+			continue;
+
+		/* One zone per batch, so the isolated counts can be undone */
+		if (zone && page_zone(page) != zone)
+			break;
+
+		if (isolate_lru_page(page))
+			continue;
+
+		zone = page_zone(page);
+		list_add(&page->lru, &page_list);
+		nr_isolated[page_is_file_cache(page)]++;
+		if (++isolated >= SWAP_CLUSTER_MAX) {
+			pte++;
+			addr += PAGE_SIZE;
+			break;
+		}
+	}
+	pte_unmap_unlock(orig_pte, ptl);
+
+	if (!isolated)
+		goto next;
+
+	mod_zone_page_state(zone, NR_ISOLATED_ANON, nr_isolated[0]);
+	mod_zone_page_state(zone, NR_ISOLATED_FILE, nr_isolated[1]);
+
+	/* Reclaim in batches so the page table lock is not held across IO */
+	reclaim_pages_from_list(&page_list);
+
+	/*
+	 * Freed pages never come back through putback, undo the counts
+	 * taken at isolation rather than recomputing them per page.
+	 */
+	mod_zone_page_state(zone, NR_ISOLATED_ANON, -nr_isolated[0]);
+	mod_zone_page_state(zone, NR_ISOLATED_FILE, -nr_isolated[1]);
+next:
+	cond_resched();
+	if (addr != end)
+		goto cont;
+
+	return 0;
+}
+
+enum reclaim_type {
+	RECLAIM_FILE,
+	RECLAIM_ANON,
+	RECLAIM_ALL,
+};
+
+static ssize_t reclaim_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char buffer[PROC_NUMBUF];
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	enum reclaim_type type;
+	char *type_buf;
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count))
+		return -EFAULT;
+
+	type_buf = strstrip(buffer);
+	if (!strcmp(type_buf, "file"))
+		type = RECLAIM_FILE;
+	else if (!strcmp(type_buf, "anon"))
+		type = RECLAIM_ANON;
+	else if (!strcmp(type_buf, "all"))
+		type = RECLAIM_ALL;
+	else
+		return -EINVAL;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+	mm = get_task_mm(task);
+	if (mm) {
+		struct mm_walk reclaim_walk = {
+			.pmd_entry = reclaim_pte_range,
+			.mm = mm,
+		};
+		down_read(&mm->mmap_sem);
+		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+			reclaim_walk.private = vma;
+			if (is_vm_hugetlb_page(vma))
+				continue;
+			if (vma->vm_flags & (VM_LOCKED | VM_PFNMAP))
+				continue;
+			if (type == RECLAIM_ANON && vma->vm_file)
+				continue;
+			if (type == RECLAIM_FILE && !vma->vm_file)
+				continue;
+			walk_page_range(vma->vm_start, vma->vm_end,
+					&reclaim_walk);
+		}
+		flush_tlb_mm(mm);
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+	put_task_struct(task);
+
+	return count;
+}
+
+const struct file_operations proc_reclaim_operations = {
+	.write		= reclaim_write,
+	.llseek		= noop_llseek,
+};
+#endif /* CONFIG_PROCESS_RECLAIM */
+
 struct pagemapread {
 	int pos, len;
 	u64 *buffer;
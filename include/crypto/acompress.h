@@ -0,0 +1,169 @@
+/*
+ * Asynchronous compression: Compression algorithms under the cryptographic
+ * API, working on scatterlists and completing through a callback.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#ifndef _CRYPTO_ACOMPRESS_H
+#define _CRYPTO_ACOMPRESS_H
+
+#include <linux/crypto.h>
+#include <linux/slab.h>
+
+struct scatterlist;
+
+/**
+ * struct acomp_req - asynchronous (de)compression request
+ * @base: common async request, holds the callback
+ * @src: source data
+ * @dst: destination buffer
+ * @slen: number of bytes of @src to process
+ * @dlen: on submission the room in @dst, on completion the bytes written
+ * @__ctx: private space for the implementation, see crypto_acomp_reqsize()
+ *
+ * Requests are independent of each other, any number of them may be in
+ * flight on one transform and they may complete in any order.
+ */
+struct acomp_req {
+	struct crypto_async_request base;
+
+	struct scatterlist *src;
+	struct scatterlist *dst;
+	unsigned int slen;
+	unsigned int dlen;
+
+	void *__ctx[] CRYPTO_MINALIGN_ATTR;
+};
+
+struct crypto_acomp {
+	int (*compress)(struct acomp_req *req);
+	int (*decompress)(struct acomp_req *req);
+
+	unsigned int reqsize;
+	struct crypto_tfm base;
+};
+
+struct acomp_alg {
+	int (*compress)(struct acomp_req *req);
+	int (*decompress)(struct acomp_req *req);
+
+	unsigned int reqsize;
+	struct crypto_alg base;
+};
+
+extern struct crypto_acomp *crypto_alloc_acomp(const char *alg_name, u32 type,
+					       u32 mask);
+
+static inline struct crypto_tfm *crypto_acomp_tfm(struct crypto_acomp *tfm)
+{
+	return &tfm->base;
+}
+
+static inline struct crypto_acomp *__crypto_acomp_tfm(struct crypto_tfm *tfm)
+{
+	return container_of(tfm, struct crypto_acomp, base);
+}
+
+static inline void crypto_free_acomp(struct crypto_acomp *tfm)
+{
+	crypto_destroy_tfm(tfm, crypto_acomp_tfm(tfm));
+}
+
+static inline struct acomp_alg *__crypto_acomp_alg(struct crypto_alg *alg)
+{
+	return container_of(alg, struct acomp_alg, base);
+}
+
+static inline struct acomp_alg *crypto_acomp_alg(struct crypto_acomp *tfm)
+{
+	return __crypto_acomp_alg(crypto_acomp_tfm(tfm)->__crt_alg);
+}
+
+static inline unsigned int crypto_acomp_reqsize(struct crypto_acomp *tfm)
+{
+	return tfm->reqsize;
+}
+
+static inline struct crypto_acomp *crypto_acomp_reqtfm(struct acomp_req *req)
+{
+	return __crypto_acomp_tfm(req->base.tfm);
+}
+
+static inline void acomp_request_set_tfm(struct acomp_req *req,
+					 struct crypto_acomp *tfm)
+{
+	req->base.tfm = crypto_acomp_tfm(tfm);
+}
+
+static inline void *acomp_request_ctx(struct acomp_req *req)
+{
+	return req->__ctx;
+}
+
+static inline struct acomp_req *acomp_request_alloc(struct crypto_acomp *tfm,
+						    gfp_t gfp)
+{
+	struct acomp_req *req;
+
+	req = kmalloc(sizeof(*req) + crypto_acomp_reqsize(tfm), gfp);
+
+	if (likely(req))
+		acomp_request_set_tfm(req, tfm);
+
+	return req;
+}
+
+static inline void acomp_request_free(struct acomp_req *req)
+{
+	kfree(req);
+}
+
+static inline struct acomp_req *acomp_request_cast(
+	struct crypto_async_request *req)
+{
+	return container_of(req, struct acomp_req, base);
+}
+
+static inline void acomp_request_set_callback(struct acomp_req *req,
+					      u32 flags,
+					      crypto_completion_t complete,
+					      void *data)
+{
+	req->base.complete = complete;
+	req->base.data = data;
+	req->base.flags = flags;
+}
+
+static inline void acomp_request_set_params(struct acomp_req *req,
+					    struct scatterlist *src,
+					    struct scatterlist *dst,
+					    unsigned int slen,
+					    unsigned int dlen)
+{
+	req->src = src;
+	req->dst = dst;
+	req->slen = slen;
+	req->dlen = dlen;
+}
+
+/*
+ * Both return 0 if the request was completed synchronously, otherwise
+ * -EINPROGRESS, or -EBUSY if it was put on the backlog because
+ * CRYPTO_TFM_REQ_MAY_BACKLOG was set, and the callback reports the result.
+ */
+static inline int crypto_acomp_compress(struct acomp_req *req)
+{
+	return crypto_acomp_reqtfm(req)->compress(req);
+}
+
+static inline int crypto_acomp_decompress(struct acomp_req *req)
+{
+	return crypto_acomp_reqtfm(req)->decompress(req);
+}
+
+#endif	/* _CRYPTO_ACOMPRESS_H */
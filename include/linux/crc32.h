@@ -11,6 +11,13 @@
 extern u32  crc32_le(u32 crc, unsigned char const *p, size_t len);
 extern u32  crc32_be(u32 crc, unsigned char const *p, size_t len);
 
+/*
+ * Castagnoli CRC32c, with the same conventions as crc32_le().  Most users
+ * want crc32c() from <linux/crc32c.h>, which goes through the crypto API
+ * and picks up accelerated implementations.
+ */
+extern u32  __crc32c_le(u32 crc, unsigned char const *p, size_t len);
+
 #define crc32(seed, data, length)  crc32_le(seed, (unsigned char const *)(data), length)
 
 /*
@@ -690,4 +690,10 @@ extern int early_irq_init(void);
 extern int arch_probe_nr_irqs(void);
 extern int arch_early_irq_init(void);
 
+#ifdef CONFIG_IRQ_TIMINGS
+extern void irq_timings_enable(void);
+extern void irq_timings_disable(void);
+extern u64 irq_timings_next_event(u64 now);
+#endif
+
 #endif
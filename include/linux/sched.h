@@ -1035,6 +1035,32 @@ static inline int test_sd_parent(struct sched_domain *sd, int flag)
 unsigned long default_scale_freq_power(struct sched_domain *sd, int cpu);
 unsigned long default_scale_smt_power(struct sched_domain *sd, int cpu);
 
+/*
+ * Energy model of a group of cpus sharing a clock, used for energy-aware
+ * wakeup placement. Capacity states are sorted by increasing capacity,
+ * with the highest capacity of the system scaled to SCHED_POWER_SCALE;
+ * power is what one cpu draws while busy in that state. Idle states are
+ * sorted from the shallowest to the deepest, in the same unit.
+ */
+struct sched_capacity_state {
+	unsigned long cap;
+	unsigned long power;
+};
+
+struct sched_idle_state {
+	unsigned long power;
+};
+
+struct sched_group_energy {
+	unsigned int nr_cap_states;
+	struct sched_capacity_state *cap_states;
+	unsigned int nr_idle_states;
+	struct sched_idle_state *idle_states;
+};
+
+extern int sched_energy_register(const struct cpumask *cpus,
+				 struct sched_group_energy *sge);
+
 #else /* CONFIG_SMP */
 
 struct sched_domain_attr;
@@ -1044,6 +1070,14 @@ partition_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
 			struct sched_domain_attr *dattr_new)
 {
 }
+
+struct sched_group_energy;
+
+static inline int sched_energy_register(const struct cpumask *cpus,
+					struct sched_group_energy *sge)
+{
+	return 0;
+}
 #endif	/* !CONFIG_SMP */
 
 
@@ -1166,6 +1200,17 @@ struct sched_statistics {
 };
 #endif
 
+/*
+ * Per-entity load tracking: decayed sums of the time an entity was
+ * runnable, in units of ~1us, with a half-life of 32 periods of ~1ms.
+ */
+struct sched_avg {
+	u32			runnable_avg_sum;
+	u32			runnable_avg_period;
+	u64			last_runnable_update;
+	unsigned long		load_avg_contrib;
+};
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
@@ -1179,6 +1224,8 @@ struct sched_entity {
 
 	u64			nr_migrations;
 
+	struct sched_avg	avg;
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
@@ -1192,6 +1239,21 @@ struct sched_entity {
 #endif
 };
 
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Hook for cpufreq governors that follow the scheduler's view of CPU
+ * utilization. @func is called with the runqueue locked and interrupts
+ * off whenever the utilization of the local CPU may have changed.
+ */
+struct update_util_data {
+	void (*func)(struct update_util_data *data,
+		     u64 time, unsigned long util, unsigned long max);
+};
+
+extern void cpufreq_set_update_util_data(int cpu,
+					 struct update_util_data *data);
+#endif
+
 struct sched_rt_entity {
 	struct list_head run_list;
 	unsigned long timeout;
@@ -207,6 +207,44 @@ struct cflayer {
 	 */
 	int (*transmit) (struct cflayer *layr, struct cfpkt *cfpkt);
 
+	/*
+	 *  receive_list() - Receive a batch of packets (non-blocking).
+	 *  Optional, a layer that leaves it NULL gets the packets one by one
+	 *  through receive(), see caif_receive_list().
+	 *	Packet handling rules:
+	 *	      - Ownership of all packets in the queue is passed to
+	 *		the called function, the queue is empty on return.
+	 *
+	 *	      - Packets failing to parse are destroyed, including
+	 *		packets failing the frame checksum. There is no
+	 *		-EILSEQ exception for lists, -EILSEQ must never be
+	 *		returned; a checksum failure is reported as -EPROTO.
+	 *
+	 *  Returns the first error seen (< 0), 0 or positive value
+	 *	     indicates success for all packets.
+	 *
+	 *  @layr:	Pointer to the current layer the receive function is
+	 *		implemented for (this pointer).
+	 *  @pktq:	Queue of CaifPackets to be handled, in order.
+	 */
+	int (*receive_list)(struct cflayer *layr, struct cfpktq *pktq);
+
+	/*
+	 *  transmit_list() - Transmit a batch of packets (non-blocking).
+	 *  Optional, a layer that leaves it NULL gets the packets one by one
+	 *  through transmit(), see caif_transmit_list(). Same ownership and
+	 *  error rules as transmit(), applied to every packet in the queue;
+	 *  the queue is empty on return.
+	 *
+	 *  Returns the first error seen (< 0), 0 or positive value
+	 *	     indicates success for all packets.
+	 *
+	 *  @layr:	Pointer to the current layer the transmit function is
+	 *		implemented for (this pointer).
+	 *  @pktq:	Queue of CaifPackets to be handled, in order.
+	 */
+	int (*transmit_list)(struct cflayer *layr, struct cfpktq *pktq);
+
 	/*
 	 *  cttrlcmd() - Control Function upwards in CAIF Stack  (non-blocking).
 	 *  Used for signaling responses (CAIF_CTRLCMD_*_RSP)
@@ -236,6 +274,27 @@ struct cflayer {
 	char name[CAIF_LAYER_NAME_SZ];
 };
 
+/**
+ * caif_receive_list() - Pass a queue of packets to a layer's receive side.
+ * @layr: Layer to receive the packets.
+ * @pktq: Packets to pass, empty on return.
+ *
+ * Uses receive_list() if the layer has one, receive() per packet
+ * otherwise. Packets the layer returns with -EILSEQ are destroyed here
+ * and the error is reported as -EPROTO.
+ */
+int caif_receive_list(struct cflayer *layr, struct cfpktq *pktq);
+
+/**
+ * caif_transmit_list() - Pass a queue of packets to a layer's transmit side.
+ * @layr: Layer to transmit the packets.
+ * @pktq: Packets to pass, empty on return.
+ *
+ * Uses transmit_list() if the layer has one, transmit() per packet
+ * otherwise.
+ */
+int caif_transmit_list(struct cflayer *layr, struct cfpktq *pktq);
+
 /**
  * layer_set_up() - Set the up pointer for a specified layer.
  *  @layr: Layer where up pointer shall be set.
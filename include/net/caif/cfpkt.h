@@ -10,6 +10,16 @@
 #include <linux/types.h>
 struct cfpkt;
 
+/*
+ * Queue of CAIF packets, used to pass a batch of packets between layers,
+ * see receive_list() and transmit_list() in struct cflayer.
+ */
+struct cfpktq {
+	struct cfpkt *head;
+	struct cfpkt *tail;
+	unsigned int qlen;
+};
+
 /* Create a CAIF packet.
  * len: Length of packet to be created
  * @return New packet.
@@ -157,6 +167,17 @@ struct cfpkt *cfpkt_append(struct cfpkt *dstpkt, struct cfpkt *addpkt,
  */
 struct cfpkt *cfpkt_split(struct cfpkt *pkt, u16 pos);
 
+/*
+ * cfpkt_split_head - Split the head off a packet.
+ * pkt: Packet to be split (will contain the second part of the data on exit)
+ * pos: Position to split packet in two parts.
+ * Only the head is copied, into a packet sized for it, so splitting a
+ * received burst frame by frame is linear in the burst length and every
+ * frame is accounted with its own size.
+ * @return The new packet, containing the first part of the data.
+ */
+struct cfpkt *cfpkt_split_head(struct cfpkt *pkt, u16 pos);
+
 /*
  * Iteration function, iterates the packet buffers from start to end.
  *
@@ -189,6 +210,37 @@ struct cfpkt *cfpkt_fromnative(enum caif_direction dir, void *nativepkt);
 void *cfpkt_tonative(struct cfpkt *pkt);
 
 
+/*
+ * Initialize an empty packet queue.
+ * pktq: Queue to initialize.
+ */
+void cfpktq_init(struct cfpktq *pktq);
+
+/*
+ * Add a packet at the end of a packet queue.
+ * pktq: Queue to add to.
+ * pkt:  Packet to add, owned by the queue until dequeued.
+ */
+void cfpktq_enqueue(struct cfpktq *pktq, struct cfpkt *pkt);
+
+/*
+ * Remove the first packet from a packet queue.
+ * pktq: Queue to remove from.
+ * @return The first packet, or NULL if the queue is empty.
+ */
+struct cfpkt *cfpktq_dequeue(struct cfpktq *pktq);
+
+/*
+ * Destroy all packets in a packet queue.
+ * pktq: Queue to empty.
+ */
+void cfpktq_purge(struct cfpktq *pktq);
+
+static inline unsigned int cfpktq_len(const struct cfpktq *pktq)
+{
+	return pktq->qlen;
+}
+
 /*
  * Returns packet information for a packet.
  * pkt Packet to get info from;
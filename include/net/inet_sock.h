@@ -133,6 +133,7 @@ struct rtable;
  * @mc_ttl - Multicasting TTL
  * @is_icsk - is this an inet_connection_sock?
  * @mc_index - Multicast device index
+ * @rx_dst_ifindex - ifindex the cached input route (sk_rx_dst) is valid for
  * @mc_list - Group array
  * @cork - info to build ip hdr on each ip frag while socket is corked
  */
@@ -169,6 +170,7 @@ struct inet_sock {
 				nodefrag:1;
 	int			mc_index;
 	__be32			mc_addr;
+	int			rx_dst_ifindex;
 	struct ip_mc_socklist __rcu	*mc_list;
 	struct inet_cork_full	cork;
 };
@@ -198,6 +200,25 @@ static inline void inet_sk_copy_descendant(struct sock *sk_to,
 
 extern int inet_sk_rebuild_header(struct sock *sk);
 
+/*
+ * Cache the input route of @skb in @sk for early demux.  Early demux uses
+ * the cached route without taking a reference, which is safe for routes
+ * in the route cache: those are only freed after an RCU-bh grace period.
+ * An uncached route (route caching disabled) is freed as soon as its last
+ * reference is dropped, so it is not cached here.
+ */
+static inline void inet_sk_rx_dst_set(struct sock *sk,
+				      const struct sk_buff *skb)
+{
+	struct dst_entry *dst = skb_dst(skb);
+
+	if (dst && !(dst->flags & DST_NOCACHE)) {
+		dst_hold(dst);
+		inet_sk(sk)->rx_dst_ifindex = skb->skb_iif;
+		sk->sk_rx_dst = dst;
+	}
+}
+
 extern u32 inet_ehash_secret;
 extern void build_ehash_secret(void);
 
@@ -236,6 +236,9 @@ extern int inet_peer_gc_maxtime;
 /* From ip_output.c */
 extern int sysctl_ip_dynaddr;
 
+/* From ip_input.c */
+extern int sysctl_ip_early_demux;
+
 extern void ipfrag_init(void);
 
 extern void ip_static_sysctl_init(void);
@@ -106,8 +106,12 @@ struct rt_cache_stat {
         unsigned int gc_dst_overflow;
         unsigned int in_hlist_search;
         unsigned int out_hlist_search;
+        unsigned int in_early_demux;
 };
 
+DECLARE_PER_CPU(struct rt_cache_stat, rt_cache_stat);
+#define RT_CACHE_STAT_INC(field) __this_cpu_inc(rt_cache_stat.field)
+
 extern struct ip_rt_acct __percpu *ip_rt_acct;
 
 struct in_device;
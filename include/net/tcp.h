@@ -311,6 +311,7 @@ extern void tcp_v4_err(struct sk_buff *skb, u32);
 extern void tcp_shutdown (struct sock *sk, int how);
 
 extern int tcp_v4_rcv(struct sk_buff *skb);
+extern void tcp_v4_early_demux(struct sk_buff *skb);
 
 extern struct inet_peer *tcp_v4_get_peer(struct sock *sk, bool *release_it);
 extern void *tcp_v4_tw_get_peer(struct sock *sk);
@@ -0,0 +1,60 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_boost
+
+#if !defined(_TRACE_CPUFREQ_BOOST_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_BOOST_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(cpufreq_boost,
+	    TP_PROTO(const char *src, unsigned int freq,
+		     unsigned int duration_ms),
+	    TP_ARGS(src, freq, duration_ms),
+	    TP_STRUCT__entry(
+		    __string(src, src)
+		    __field(unsigned int, freq)
+		    __field(unsigned int, duration_ms)
+	    ),
+	    TP_fast_assign(
+		    __assign_str(src, src);
+		    __entry->freq = freq;
+		    __entry->duration_ms = duration_ms;
+	    ),
+	    TP_printk("src=%s freq=%u duration_ms=%u", __get_str(src),
+		      __entry->freq, __entry->duration_ms)
+);
+
+TRACE_EVENT(cpufreq_boost_end,
+	    TP_PROTO(unsigned int freq),
+	    TP_ARGS(freq),
+	    TP_STRUCT__entry(
+		    __field(unsigned int, freq)
+	    ),
+	    TP_fast_assign(
+		    __entry->freq = freq;
+	    ),
+	    TP_printk("freq=%u", __entry->freq)
+);
+
+TRACE_EVENT(cpufreq_boost_reached,
+	    TP_PROTO(unsigned int cpu_id, unsigned int freq,
+		     unsigned long latency_us),
+	    TP_ARGS(cpu_id, freq, latency_us),
+	    TP_STRUCT__entry(
+		    __field(unsigned int, cpu_id)
+		    __field(unsigned int, freq)
+		    __field(unsigned long, latency_us)
+	    ),
+	    TP_fast_assign(
+		    __entry->cpu_id = cpu_id;
+		    __entry->freq = freq;
+		    __entry->latency_us = latency_us;
+	    ),
+	    TP_printk("cpu=%u freq=%u latency_us=%lu", __entry->cpu_id,
+		      __entry->freq, __entry->latency_us)
+);
+
+#endif /* _TRACE_CPUFREQ_BOOST_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -177,6 +177,44 @@ TRACE_EVENT(sched_migrate_task,
 		  __entry->orig_cpu, __entry->dest_cpu)
 );
 
+/*
+ * Tracepoint for energy-aware wakeup placement decisions:
+ */
+TRACE_EVENT(sched_energy_wakeup,
+
+	TP_PROTO(struct task_struct *p, int prev_cpu, int dst_cpu,
+		 unsigned long util, unsigned long prev_energy,
+		 unsigned long dst_energy),
+
+	TP_ARGS(p, prev_cpu, dst_cpu, util, prev_energy, dst_energy),
+
+	TP_STRUCT__entry(
+		__array(	char,		comm,	TASK_COMM_LEN	)
+		__field(	pid_t,		pid			)
+		__field(	int,		prev_cpu		)
+		__field(	int,		dst_cpu			)
+		__field(	unsigned long,	util			)
+		__field(	unsigned long,	prev_energy		)
+		__field(	unsigned long,	dst_energy		)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->prev_cpu	= prev_cpu;
+		__entry->dst_cpu	= dst_cpu;
+		__entry->util		= util;
+		__entry->prev_energy	= prev_energy;
+		__entry->dst_energy	= dst_energy;
+	),
+
+	TP_printk("comm=%s pid=%d prev_cpu=%d dst_cpu=%d util=%lu "
+		  "prev_energy=%lu dst_energy=%lu",
+		  __entry->comm, __entry->pid, __entry->prev_cpu,
+		  __entry->dst_cpu, __entry->util, __entry->prev_energy,
+		  __entry->dst_energy)
+);
+
 DECLARE_EVENT_CLASS(sched_process_template,
 
 	TP_PROTO(struct task_struct *p),
@@ -146,6 +146,8 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 	cpu = smp_processor_id();
 #endif
 
+	record_irq_time(desc);
+
 	do {
 		irqreturn_t res;
 
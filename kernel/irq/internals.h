@@ -169,3 +169,36 @@ static inline bool irqd_has_set(struct irq_data *d, unsigned int mask)
 {
 	return d->state_use_accessors & mask;
 }
+
+#ifdef CONFIG_IRQ_TIMINGS
+#include <linux/jump_label.h>
+#include <linux/sched.h>
+
+#define IRQT_BUF_SIZE	32
+
+/* Interrupts taken by a cpu since it last went idle */
+struct irq_timings {
+	u64		ts[IRQT_BUF_SIZE];
+	unsigned int	irq[IRQT_BUF_SIZE];
+	unsigned int	count;
+};
+
+DECLARE_PER_CPU(struct irq_timings, irq_timings);
+extern struct jump_label_key irq_timing_enabled;
+
+static inline void record_irq_time(struct irq_desc *desc)
+{
+	struct irq_timings *timings;
+	unsigned int i;
+
+	if (!static_branch(&irq_timing_enabled))
+		return;
+
+	timings = &__get_cpu_var(irq_timings);
+	i = timings->count++ & (IRQT_BUF_SIZE - 1);
+	timings->ts[i] = local_clock();
+	timings->irq[i] = desc->irq_data.irq;
+}
+#else
+static inline void record_irq_time(struct irq_desc *desc) { }
+#endif
@@ -0,0 +1,162 @@
+/*
+ * linux/kernel/irq/timings.c
+ *
+ * This file contains the interrupt timing statistics used to predict
+ * the next wakeup of an idle cpu.
+ *
+ * The interrupt path only stores the irq number and a timestamp in a
+ * small per cpu ring. When the cpu is about to go idle, the ring is
+ * folded into per cpu statistics of the interval between two
+ * occurrences of each irq: a running average and variance. An irq whose
+ * intervals are stable enough is expected to fire again one average
+ * interval after its last occurrence, the earliest of these is the
+ * predicted wakeup. Irqs that fire at random, or that have been quiet
+ * for a second, give no prediction.
+ */
+
+#include <linux/irq.h>
+#include <linux/module.h>
+#include <linux/interrupt.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+
+#include "internals.h"
+
+/* Number of irqs tracked per cpu, the least recently seen is replaced */
+#define IRQT_NR_STATS		16
+/* Intervals needed before an irq is used for predictions */
+#define IRQT_MIN_SAMPLES	4
+/* Longer intervals start a new burst */
+#define IRQT_MAX_INTERVAL	NSEC_PER_SEC
+/* The running average weighs the new interval by 1/8 */
+#define IRQT_EWMA_SHIFT		3
+
+struct irqt_stat {
+	unsigned int	irq;
+	unsigned int	nr_samples;
+	u64		last_ts;	/* 0 if the slot is unused */
+	u64		avg;
+	u64		variance;
+};
+
+struct jump_label_key irq_timing_enabled;
+
+DEFINE_PER_CPU(struct irq_timings, irq_timings);
+static DEFINE_PER_CPU(struct irqt_stat [IRQT_NR_STATS], irqt_stats);
+
+/**
+ * irq_timings_enable - start recording interrupt timings
+ *
+ * Calls nest, recording stops when each caller has called
+ * irq_timings_disable().
+ */
+void irq_timings_enable(void)
+{
+	jump_label_inc(&irq_timing_enabled);
+}
+EXPORT_SYMBOL_GPL(irq_timings_enable);
+
+void irq_timings_disable(void)
+{
+	jump_label_dec(&irq_timing_enabled);
+}
+EXPORT_SYMBOL_GPL(irq_timings_disable);
+
+static struct irqt_stat *irqt_get_stat(struct irqt_stat *stats,
+				       unsigned int irq)
+{
+	struct irqt_stat *victim = &stats[0];
+	int i;
+
+	for (i = 0; i < IRQT_NR_STATS; i++) {
+		if (stats[i].last_ts && stats[i].irq == irq)
+			return &stats[i];
+		if (stats[i].last_ts < victim->last_ts)
+			victim = &stats[i];
+	}
+
+	memset(victim, 0, sizeof(*victim));
+	victim->irq = irq;
+	return victim;
+}
+
+static void irqt_update(struct irqt_stat *stat, u64 ts)
+{
+	u64 last = stat->last_ts;
+	s64 interval, diff;
+
+	stat->last_ts = ts;
+
+	/* A new slot has no previous occurrence to measure from */
+	if (!last)
+		return;
+
+	interval = ts - last;
+	if (interval > IRQT_MAX_INTERVAL || interval <= 0) {
+		stat->nr_samples = 0;
+		return;
+	}
+
+	if (!stat->nr_samples++) {
+		/* First interval of a burst, nothing to average yet */
+		stat->avg = interval;
+		stat->variance = 0;
+		return;
+	}
+
+	diff = interval - (s64)stat->avg;
+	stat->avg += diff >> IRQT_EWMA_SHIFT;
+	diff = diff * (interval - (s64)stat->avg) - (s64)stat->variance;
+	stat->variance += diff >> IRQT_EWMA_SHIFT;
+}
+
+/**
+ * irq_timings_next_event - predict the next interrupt on this cpu
+ * @now: current local_clock() value
+ *
+ * Returns the local_clock() time at which the next interrupt is
+ * expected, or ULLONG_MAX if no interrupt can be predicted. Must be called
+ * with interrupts disabled.
+ */
+u64 irq_timings_next_event(u64 now)
+{
+	struct irq_timings *timings = &__get_cpu_var(irq_timings);
+	struct irqt_stat *stats = __get_cpu_var(irqt_stats);
+	u64 next_evt = ULLONG_MAX;
+	unsigned int i, start;
+
+	WARN_ON_ONCE(!irqs_disabled());
+
+	/* Entries older than the ring size have been overwritten */
+	start = timings->count > IRQT_BUF_SIZE ?
+		timings->count - IRQT_BUF_SIZE : 0;
+	for (i = start; i < timings->count; i++) {
+		unsigned int idx = i & (IRQT_BUF_SIZE - 1);
+
+		irqt_update(irqt_get_stat(stats, timings->irq[idx]),
+			    timings->ts[idx]);
+	}
+	timings->count = 0;
+
+	for (i = 0; i < IRQT_NR_STATS; i++) {
+		struct irqt_stat *stat = &stats[i];
+		u64 next;
+
+		if (!stat->last_ts || stat->nr_samples < IRQT_MIN_SAMPLES)
+			continue;
+
+		/* Standard deviation above a quarter of the interval */
+		if (stat->variance > (stat->avg * stat->avg) >> 4)
+			continue;
+
+		/* An irq that is late has probably stopped */
+		next = stat->last_ts + stat->avg;
+		if (next < now)
+			continue;
+
+		next_evt = min(next_evt, next);
+	}
+
+	return next_evt;
+}
+EXPORT_SYMBOL_GPL(irq_timings_next_event);
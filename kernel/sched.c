@@ -335,6 +335,9 @@ struct cfs_rq {
 	 */
 	struct sched_entity *curr, *next, *last, *skip;
 
+	/* Sum of the load contributions of the queued entities */
+	unsigned long runnable_load_avg;
+
 #ifdef	CONFIG_SCHED_DEBUG
 	unsigned int nr_spread_over;
 #endif
@@ -506,6 +509,9 @@ struct rq {
 	u64 clock;
 	u64 clock_task;
 
+	/* Decayed fraction of time this cpu had runnable tasks */
+	struct sched_avg avg;
+
 	atomic_t nr_iowait;
 
 #ifdef CONFIG_SMP
@@ -1786,13 +1792,234 @@ static const struct sched_class rt_sched_class;
 
 #include "sched_stats.h"
 
+/*
+ * Per-entity load tracking.
+ *
+ * Time is split into periods of 1024us. The runnable time of each period
+ * is accumulated in a sum where older periods are decayed geometrically,
+ * such that a period 32 periods (~32ms) ago weighs half as much as the
+ * current one:
+ *
+ *   sum = u_0 + u_1*y + u_2*y^2 + ...,  y^32 = 1/2
+ *
+ * runnable_avg_period is the same sum for a task that is always runnable,
+ * so runnable_avg_sum / runnable_avg_period is the recent fraction of time
+ * the entity was runnable.
+ */
+#define LOAD_AVG_PERIOD	32
+#define LOAD_AVG_MAX	47742	/* maximum possible load avg */
+#define LOAD_AVG_MAX_N	345	/* number of full periods to produce LOAD_MAX_AVG */
+
+/* Precomputed fixed inverse multiplies for multiplication by y^n */
+static const u32 runnable_avg_yN_inv[] = {
+	0xffffffff, 0xfa83b2da, 0xf5257d14, 0xefe4b99a, 0xeac0c6e6, 0xe5b906e6,
+	0xe0ccdeeb, 0xdbfbb796, 0xd744fcc9, 0xd2a81d91, 0xce248c14, 0xc9b9bd85,
+	0xc5672a10, 0xc12c4cc9, 0xbd08a39e, 0xb8fbaf46, 0xb504f333, 0xb123f581,
+	0xad583ee9, 0xa9a15ab4, 0xa5fed6a9, 0xa2704302, 0x9ef5325f, 0x9b8d39b9,
+	0x9837f050, 0x94f4efa8, 0x91c3d373, 0x8ea4398a, 0x8b95c1e3, 0x88980e80,
+	0x85aac367, 0x82cd8698,
+};
+
+/*
+ * Precomputed \Sum y^k { 1<=k<=n }. These are floor(true_value) to prevent
+ * over-estimates when re-combining.
+ */
+static const u32 runnable_avg_yN_sum[] = {
+	    0, 1002, 1982, 2941, 3880, 4798, 5697, 6576, 7437, 8279, 9103,
+	 9909,10698,11470,12226,12966,13690,14398,15091,15769,16433,17082,
+	17718,18340,18949,19545,20128,20698,21256,21802,22336,22859,23371,
+};
+
+/*
+ * Approximate val * y^n, where y^32 ~= 0.5 (~1 scheduling period)
+ */
+static __always_inline u64 decay_load(u64 val, u64 n)
+{
+	unsigned int local_n;
+
+	if (!n)
+		return val;
+	else if (unlikely(n > LOAD_AVG_PERIOD * 63))
+		return 0;
+
+	/* after bounds checking we can collapse to 32-bit */
+	local_n = n;
+
+	/*
+	 * As y^PERIOD = 1/2, we can combine
+	 *    y^n = 1/2^(n/PERIOD) * y^(n%PERIOD)
+	 * With a look-up table which covers y^n (n<PERIOD)
+	 */
+	if (unlikely(local_n >= LOAD_AVG_PERIOD)) {
+		val >>= local_n / LOAD_AVG_PERIOD;
+		local_n %= LOAD_AVG_PERIOD;
+	}
+
+	val *= runnable_avg_yN_inv[local_n];
+	/* We don't use SRR here since we always want to round down. */
+	return val >> 32;
+}
+
+/*
+ * For updates fully spanning n periods, the contribution to runnable
+ * average will be: \Sum 1024*y^n
+ */
+static u32 __compute_runnable_contrib(u64 n)
+{
+	u32 contrib = 0;
+
+	if (likely(n <= LOAD_AVG_PERIOD))
+		return runnable_avg_yN_sum[n];
+	else if (unlikely(n >= LOAD_AVG_MAX_N))
+		return LOAD_AVG_MAX;
+
+	/* Compute \Sum k^n combining precomputed values for k^i, \Sum k^j */
+	do {
+		contrib /= 2; /* y^LOAD_AVG_PERIOD = 1/2 */
+		contrib += runnable_avg_yN_sum[LOAD_AVG_PERIOD];
+
+		n -= LOAD_AVG_PERIOD;
+	} while (n > LOAD_AVG_PERIOD);
+
+	contrib = decay_load(contrib, n);
+	return contrib + runnable_avg_yN_sum[n];
+}
+
+/*
+ * Account the time since the last update as runnable or not and decay
+ * the sums if a period boundary was crossed. Returns 1 in that case.
+ */
+static __always_inline int __update_entity_runnable_avg(u64 now,
+							struct sched_avg *sa,
+							int runnable)
+{
+	u64 delta, periods;
+	u32 runnable_contrib;
+	int delta_w, decayed = 0;
+
+	delta = now - sa->last_runnable_update;
+	/*
+	 * This should only happen when time goes backwards, which it
+	 * unfortunately does during sched clock init when we swap over to TSC.
+	 */
+	if ((s64)delta < 0) {
+		sa->last_runnable_update = now;
+		return 0;
+	}
+
+	/*
+	 * Use 1024ns as the unit of measurement since it's a reasonable
+	 * approximation of 1us and fast to compute.
+	 */
+	delta >>= 10;
+	if (!delta)
+		return 0;
+	sa->last_runnable_update += delta << 10;
+
+	/* delta_w is the amount already accumulated against our next period */
+	delta_w = sa->runnable_avg_period % 1024;
+	if (delta + delta_w >= 1024) {
+		/* period roll-over */
+		decayed = 1;
+
+		/*
+		 * Now that we know we're crossing a period boundary, figure
+		 * out how much from delta we need to complete the current
+		 * period and accrue it.
+		 */
+		delta_w = 1024 - delta_w;
+		if (runnable)
+			sa->runnable_avg_sum += delta_w;
+		sa->runnable_avg_period += delta_w;
+
+		delta -= delta_w;
+
+		/* Figure out how many additional periods this update spans */
+		periods = delta / 1024;
+		delta %= 1024;
+
+		sa->runnable_avg_sum = decay_load(sa->runnable_avg_sum,
+						  periods + 1);
+		sa->runnable_avg_period = decay_load(sa->runnable_avg_period,
+						     periods + 1);
+
+		/* Efficiently calculate \sum (1..n_period) 1024*y^i */
+		runnable_contrib = __compute_runnable_contrib(periods);
+		if (runnable)
+			sa->runnable_avg_sum += runnable_contrib;
+		sa->runnable_avg_period += runnable_contrib;
+	}
+
+	/* Remainder of delta accrued against u_0` */
+	if (runnable)
+		sa->runnable_avg_sum += delta;
+	sa->runnable_avg_period += delta;
+
+	return decayed;
+}
+
+#ifdef CONFIG_CPU_FREQ
+static DEFINE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_set_update_util_data - set the utilization update hook of a cpu
+ * @cpu: cpu to set the hook for
+ * @data: hook to install, or %NULL to remove it
+ *
+ * The caller must wait for synchronize_sched() after removing a hook
+ * before freeing it.
+ */
+void cpufreq_set_update_util_data(int cpu, struct update_util_data *data)
+{
+	if (WARN_ON(data && !data->func))
+		return;
+
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), data);
+}
+EXPORT_SYMBOL_GPL(cpufreq_set_update_util_data);
+
+static inline void cpufreq_update_util(struct rq *rq)
+{
+	struct update_util_data *data;
+	unsigned long util;
+
+	/* Remote updates are picked up at the next local one */
+	if (cpu_of(rq) != smp_processor_id())
+		return;
+
+	data = rcu_dereference_sched(__get_cpu_var(cpufreq_update_util_data));
+	if (!data)
+		return;
+
+	util = rq->avg.runnable_avg_sum * SCHED_POWER_SCALE /
+		(rq->avg.runnable_avg_period + 1);
+	data->func(data, rq->clock, util, SCHED_POWER_SCALE);
+}
+#else
+static inline void cpufreq_update_util(struct rq *rq)
+{
+}
+#endif
+
+/*
+ * Track how busy the cpu is. Called with the clock updated, before
+ * nr_running changes and from the tick.
+ */
+static void update_rq_runnable_avg(struct rq *rq, int runnable)
+{
+	if (__update_entity_runnable_avg(rq->clock_task, &rq->avg, runnable))
+		cpufreq_update_util(rq);
+}
+
 static void inc_nr_running(struct rq *rq)
 {
+	update_rq_runnable_avg(rq, rq->nr_running);
 	rq->nr_running++;
 }
 
 static void dec_nr_running(struct rq *rq)
 {
+	update_rq_runnable_avg(rq, 1);
 	rq->nr_running--;
 }
 
@@ -2845,6 +3072,8 @@ static void __sched_fork(struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+	memset(&p->se.avg, 0, sizeof(p->se.avg));
+
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
@@ -4109,6 +4338,7 @@ void scheduler_tick(void)
 	raw_spin_lock(&rq->lock);
 	update_rq_clock(rq);
 	update_cpu_load_active(rq);
+	update_rq_runnable_avg(rq, rq->nr_running);
 	curr->sched_class->task_tick(rq, curr, 0);
 	raw_spin_unlock(&rq->lock);
 
@@ -680,6 +680,41 @@ add_cfs_task_weight(struct cfs_rq *cfs_rq, unsigned long weight)
 }
 #endif
 
+/*
+ * An entity contributes its weight scaled by the fraction of time it has
+ * recently been runnable. Returns the change of the contribution.
+ */
+static inline long __update_entity_load_avg_contrib(struct sched_entity *se)
+{
+	long old_contrib = se->avg.load_avg_contrib;
+
+	se->avg.load_avg_contrib = div_u64((u64)se->avg.runnable_avg_sum *
+					   scale_load_down(se->load.weight),
+					   se->avg.runnable_avg_period + 1);
+
+	return se->avg.load_avg_contrib - old_contrib;
+}
+
+/*
+ * Update the runnable average of an entity. Time is accounted as runnable
+ * while the entity is queued, running or not. With @update_cfs_rq the
+ * change is propagated to the runnable load of the queue the entity is
+ * on.
+ */
+static void update_entity_load_avg(struct sched_entity *se, int update_cfs_rq)
+{
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+	long contrib_delta;
+
+	if (!__update_entity_runnable_avg(rq_of(cfs_rq)->clock_task, &se->avg,
+					  se->on_rq))
+		return;
+
+	contrib_delta = __update_entity_load_avg_contrib(se);
+	if (update_cfs_rq)
+		cfs_rq->runnable_load_avg += contrib_delta;
+}
+
 static void
 account_entity_enqueue(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
@@ -984,6 +1019,9 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 */
 	update_curr(cfs_rq);
 	update_cfs_load(cfs_rq, 0);
+	/* Decay the time spent sleeping before adding the contribution */
+	update_entity_load_avg(se, 0);
+	cfs_rq->runnable_load_avg += se->avg.load_avg_contrib;
 	account_entity_enqueue(cfs_rq, se);
 	update_cfs_shares(cfs_rq);
 
@@ -1056,6 +1094,9 @@ dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	update_curr(cfs_rq);
 
 	update_stats_dequeue(cfs_rq, se);
+	update_entity_load_avg(se, 1);
+	cfs_rq->runnable_load_avg -= se->avg.load_avg_contrib;
+
 	if (flags & DEQUEUE_SLEEP) {
 #ifdef CONFIG_SCHEDSTATS
 		if (entity_is_task(se)) {
@@ -1215,6 +1256,7 @@ static void put_prev_entity(struct cfs_rq *cfs_rq, struct sched_entity *prev)
 
 	check_spread(cfs_rq, prev);
 	if (prev->on_rq) {
+		update_entity_load_avg(prev, 1);
 		update_stats_wait_start(cfs_rq, prev);
 		/* Put 'current' back into the tree. */
 		__enqueue_entity(cfs_rq, prev);
@@ -1230,6 +1272,11 @@ entity_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr, int queued)
 	 */
 	update_curr(cfs_rq);
 
+	/*
+	 * Ensure that runnable average is periodically updated.
+	 */
+	update_entity_load_avg(curr, 1);
+
 	/*
 	 * Update share accounting for long-running entities.
 	 */
@@ -1675,6 +1722,266 @@ static int select_idle_sibling(struct task_struct *p, int target)
 	return target;
 }
 
+/*
+ * Energy-aware wakeup placement.
+ *
+ * Platforms describe each group of cpus sharing a clock with a table of
+ * capacity states and idle state powers. While the system has spare
+ * capacity, a waking task is put on the cpu for which the sum of the
+ * estimated energy of all the cpus is the lowest: each group runs at the
+ * lowest capacity state that leaves a margin above its busiest cpu, and
+ * each cpu spends the rest of its time idle. Once a cpu gets close to
+ * full, utilization no longer tells how much capacity is needed and the
+ * regular load balancing placement is used instead.
+ */
+struct energy_domain {
+	struct sched_group_energy *sge;
+	unsigned long cpus[0];
+};
+
+static DEFINE_PER_CPU(struct energy_domain *, cpu_energy_domain);
+static DEFINE_MUTEX(energy_domain_mutex);
+
+/* Utilization must stay below 80% of the capacity picked for it */
+static unsigned int capacity_margin = 1280;
+
+static inline struct cpumask *energy_domain_cpus(struct energy_domain *ed)
+{
+	return to_cpumask(ed->cpus);
+}
+
+/**
+ * sched_energy_register - attach an energy model to a group of cpus
+ * @cpus: cpus sharing a clock
+ * @sge: energy model of one cpu of the group, or %NULL to detach it
+ *
+ * @sge must stay valid as long as it is registered.
+ */
+int sched_energy_register(const struct cpumask *cpus,
+			  struct sched_group_energy *sge)
+{
+	struct energy_domain *ed = NULL, *old;
+	int cpu, i;
+
+	if (sge) {
+		if (!sge->nr_cap_states || !sge->cap_states)
+			return -EINVAL;
+
+		ed = kzalloc(sizeof(*ed) + cpumask_size(), GFP_KERNEL);
+		if (!ed)
+			return -ENOMEM;
+		ed->sge = sge;
+		cpumask_copy(energy_domain_cpus(ed), cpus);
+	}
+
+	mutex_lock(&energy_domain_mutex);
+	for_each_cpu(cpu, cpus) {
+		old = per_cpu(cpu_energy_domain, cpu);
+		rcu_assign_pointer(per_cpu(cpu_energy_domain, cpu), ed);
+		if (!old)
+			continue;
+
+		/* Free the old domain once no cpu refers to it any more */
+		for_each_possible_cpu(i) {
+			if (per_cpu(cpu_energy_domain, i) == old)
+				break;
+		}
+		if (i >= nr_cpu_ids) {
+			synchronize_sched();
+			kfree(old);
+		}
+	}
+	mutex_unlock(&energy_domain_mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sched_energy_register);
+
+static inline unsigned long task_util(struct task_struct *p)
+{
+	struct sched_avg *sa = &p->se.avg;
+
+	return sa->runnable_avg_sum * SCHED_POWER_SCALE /
+		(sa->runnable_avg_period + 1);
+}
+
+static inline unsigned long cpu_util(int cpu)
+{
+	struct sched_avg *sa = &cpu_rq(cpu)->avg;
+
+	return sa->runnable_avg_sum * SCHED_POWER_SCALE /
+		(sa->runnable_avg_period + 1);
+}
+
+/*
+ * Utilization of @cpu if @p, which last ran on @prev_cpu, was woken on
+ * @dst_cpu. A sleeping task still accounts in the decayed utilization
+ * of the cpu it ran on.
+ */
+static unsigned long
+cpu_util_wake(int cpu, struct task_struct *p, int prev_cpu, int dst_cpu)
+{
+	unsigned long util = cpu_util(cpu);
+	unsigned long tutil = task_util(p);
+
+	if (cpu == prev_cpu)
+		util -= min(util, tutil);
+	if (cpu == dst_cpu)
+		util += tutil;
+
+	return min_t(unsigned long, util, SCHED_POWER_SCALE);
+}
+
+/* Estimated average power drawn by the online cpus of @ed */
+static unsigned long energy_domain_cost(struct energy_domain *ed,
+		struct task_struct *p, int prev_cpu, int dst_cpu)
+{
+	struct sched_group_energy *sge = ed->sge;
+	struct sched_capacity_state *cs;
+	unsigned long max_cap, max_util = 0;
+	unsigned long energy = 0;
+	int i;
+
+	max_cap = sge->cap_states[sge->nr_cap_states - 1].cap;
+
+	/* The group is clocked for its busiest cpu */
+	for_each_cpu_and(i, energy_domain_cpus(ed), cpu_online_mask)
+		max_util = max(max_util,
+			       cpu_util_wake(i, p, prev_cpu, dst_cpu));
+
+	/* Utilization is tracked in time, turn it into capacity */
+	max_util = max_util * max_cap >> SCHED_POWER_SHIFT;
+
+	for (i = 0; i < sge->nr_cap_states - 1; i++) {
+		if (sge->cap_states[i].cap * SCHED_POWER_SCALE >=
+		    max_util * capacity_margin)
+			break;
+	}
+	cs = &sge->cap_states[i];
+
+	for_each_cpu_and(i, energy_domain_cpus(ed), cpu_online_mask) {
+		unsigned long util, idle_power = 0;
+
+		util = cpu_util_wake(i, p, prev_cpu, dst_cpu);
+		util = min(util * max_cap >> SCHED_POWER_SHIFT, cs->cap);
+
+		/* A cpu with nothing to run gets to its deepest idle state */
+		if (sge->nr_idle_states)
+			idle_power = util ? sge->idle_states[0].power :
+				sge->idle_states[sge->nr_idle_states - 1].power;
+
+		energy += (util * cs->power +
+			   (cs->cap - util) * idle_power) / cs->cap;
+	}
+
+	return energy;
+}
+
+/* Energy of all the cpus with an energy model if @p was woken on @dst_cpu */
+static unsigned long compute_energy(struct task_struct *p, int prev_cpu,
+				    int dst_cpu)
+{
+	struct energy_domain *ed;
+	unsigned long energy = 0;
+	int i;
+
+	for_each_online_cpu(i) {
+		ed = rcu_dereference_sched(per_cpu(cpu_energy_domain, i));
+		if (!ed)
+			continue;
+		/* Account each domain once, at its first online cpu */
+		if (cpumask_first_and(energy_domain_cpus(ed),
+				      cpu_online_mask) != i)
+			continue;
+		energy += energy_domain_cost(ed, p, prev_cpu, dst_cpu);
+	}
+
+	return energy;
+}
+
+/*
+ * Pick the cpu @p should wake up on to save energy, or -1 when the
+ * regular placement should be used: no energy model, or a cpu is too
+ * busy for utilization to be meaningful.
+ *
+ * For each domain, only the least utilized allowed cpu is a candidate
+ * besides @prev_cpu: within a domain it has the same cost as the others
+ * and is the most likely to have room for @p.
+ */
+static int find_energy_efficient_cpu(struct task_struct *p, int prev_cpu)
+{
+	unsigned long prev_energy = ULONG_MAX, best_energy = ULONG_MAX;
+	unsigned long energy;
+	struct energy_domain *ed;
+	int best_cpu = -1;
+	int i, j;
+
+	if (!sched_feat(ENERGY_AWARE))
+		return -1;
+
+	if (!rcu_dereference_sched(per_cpu(cpu_energy_domain, prev_cpu)))
+		return -1;
+
+	for_each_online_cpu(i) {
+		if (cpu_util(i) * capacity_margin >
+		    SCHED_POWER_SCALE * SCHED_POWER_SCALE)
+			return -1;
+	}
+
+	if (cpumask_test_cpu(prev_cpu, &p->cpus_allowed)) {
+		prev_energy = best_energy = compute_energy(p, prev_cpu,
+							   prev_cpu);
+		best_cpu = prev_cpu;
+	}
+
+	for_each_online_cpu(i) {
+		unsigned long min_util = ULONG_MAX;
+		int candidate = -1;
+
+		ed = rcu_dereference_sched(per_cpu(cpu_energy_domain, i));
+		if (!ed)
+			continue;
+		if (cpumask_first_and(energy_domain_cpus(ed),
+				      cpu_online_mask) != i)
+			continue;
+
+		for_each_cpu_and(j, energy_domain_cpus(ed), cpu_online_mask) {
+			unsigned long util;
+
+			if (j == prev_cpu ||
+			    !cpumask_test_cpu(j, &p->cpus_allowed))
+				continue;
+
+			util = cpu_util_wake(j, p, prev_cpu, j);
+			if (util < min_util) {
+				min_util = util;
+				candidate = j;
+			}
+		}
+		if (candidate < 0)
+			continue;
+
+		energy = compute_energy(p, prev_cpu, candidate);
+		if (energy < best_energy) {
+			best_energy = energy;
+			best_cpu = candidate;
+		}
+	}
+
+	if (best_cpu < 0)
+		return -1;
+
+	/* Only migrate for a saving worth the loss of cache affinity */
+	if (prev_energy != ULONG_MAX && best_cpu != prev_cpu &&
+	    prev_energy - best_energy < prev_energy >> 4)
+		best_cpu = prev_cpu;
+
+	trace_sched_energy_wakeup(p, prev_cpu, best_cpu, task_util(p),
+				  prev_energy, best_energy);
+
+	return best_cpu;
+}
+
 /*
  * sched_balance_self: balance the current task (running on cpu) in domains
  * that have the 'flag' flag set. In practice, this is SD_BALANCE_FORK and
@@ -1698,6 +2005,10 @@ select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flags)
 	int sync = wake_flags & WF_SYNC;
 
 	if (sd_flag & SD_BALANCE_WAKE) {
+		new_cpu = find_energy_efficient_cpu(p, prev_cpu);
+		if (new_cpu >= 0)
+			return new_cpu;
+
 		if (cpumask_test_cpu(cpu, &p->cpus_allowed))
 			want_affine = 1;
 		new_cpu = prev_cpu;
@@ -72,3 +72,10 @@ SCHED_FEAT(NONIRQ_POWER, 1)
 SCHED_FEAT(TTWU_QUEUE, 1)
 
 SCHED_FEAT(FORCE_SD_OVERLAP, 0)
+
+/*
+ * Place waking tasks on the cpu that minimizes the estimated energy,
+ * when the platform registered an energy model and the system is not
+ * over-utilized.
+ */
+SCHED_FEAT(ENERGY_AWARE, 1)
@@ -26,15 +26,18 @@
 #include <linux/compiler.h>
 #include <linux/types.h>
 #include <linux/init.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/irqflags.h>
 #include <asm/atomic.h>
 #include "crc32defs.h"
-#if CRC_LE_BITS == 8
+#if CRC_LE_BITS > 8
 # define tole(x) __constant_cpu_to_le32(x)
 #else
 # define tole(x) (x)
 #endif
 
-#if CRC_BE_BITS == 8
+#if CRC_BE_BITS > 8
 # define tobe(x) __constant_cpu_to_be32(x)
 #else
 # define tobe(x) (x)
@@ -45,26 +48,37 @@ MODULE_AUTHOR("Matt Domsch <Matt_Domsch@dell.com>");
 MODULE_DESCRIPTION("Ethernet CRC32 calculations");
 MODULE_LICENSE("GPL");
 
-#if CRC_LE_BITS == 8 || CRC_BE_BITS == 8
+#if CRC_LE_BITS > 8 || CRC_BE_BITS > 8
 
+/*
+ * Word at a time table lookups.  Row n of @tab is the crc of a byte
+ * followed by n zero bytes, so each byte of a word, or of a pair of
+ * words with slice-by-8, is looked up independently and the results
+ * xored together.
+ */
 static inline u32
 crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 {
 # ifdef __LITTLE_ENDIAN
-#  define DO_CRC(x) crc = tab[0][(crc ^ (x)) & 255] ^ (crc >> 8)
-#  define DO_CRC4 crc = tab[3][(crc) & 255] ^ \
-		tab[2][(crc >> 8) & 255] ^ \
-		tab[1][(crc >> 16) & 255] ^ \
-		tab[0][(crc >> 24) & 255]
+#  define DO_CRC(x) crc = t0[(crc ^ (x)) & 255] ^ (crc >> 8)
+#  define DO_CRC4 (t3[(q) & 255] ^ t2[(q >> 8) & 255] ^ \
+		   t1[(q >> 16) & 255] ^ t0[(q >> 24) & 255])
+#  define DO_CRC8 (t7[(q) & 255] ^ t6[(q >> 8) & 255] ^ \
+		   t5[(q >> 16) & 255] ^ t4[(q >> 24) & 255])
 # else
-#  define DO_CRC(x) crc = tab[0][((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
-#  define DO_CRC4 crc = tab[0][(crc) & 255] ^ \
-		tab[1][(crc >> 8) & 255] ^ \
-		tab[2][(crc >> 16) & 255] ^ \
-		tab[3][(crc >> 24) & 255]
+#  define DO_CRC(x) crc = t0[((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
+#  define DO_CRC4 (t0[(q) & 255] ^ t1[(q >> 8) & 255] ^ \
+		   t2[(q >> 16) & 255] ^ t3[(q >> 24) & 255])
+#  define DO_CRC8 (t4[(q) & 255] ^ t5[(q >> 8) & 255] ^ \
+		   t6[(q >> 16) & 255] ^ t7[(q >> 24) & 255])
 # endif
 	const u32 *b;
 	size_t    rem_len;
+	const u32 *t0 = tab[0], *t1 = tab[1], *t2 = tab[2], *t3 = tab[3];
+# if CRC_LE_BITS == 64 || CRC_BE_BITS == 64
+	const u32 *t4 = tab[4], *t5 = tab[5], *t6 = tab[6], *t7 = tab[7];
+# endif
+	u32 q;
 
 	/* Align it */
 	if (unlikely((long)buf & 3 && len)) {
@@ -72,13 +86,26 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 			DO_CRC(*buf++);
 		} while ((--len) && ((long)buf)&3);
 	}
+
+# if CRC_LE_BITS == 32
 	rem_len = len & 3;
-	/* load data 32 bits wide, xor data 32 bits wide. */
 	len = len >> 2;
+# else
+	rem_len = len & 7;
+	len = len >> 3;
+# endif
+
+	/* load data 32 bits wide, xor data 32 bits wide. */
 	b = (const u32 *)buf;
 	for (--b; len; --len) {
-		crc ^= *++b; /* use pre increment for speed */
-		DO_CRC4;
+		q = crc ^ *++b; /* use pre increment for speed */
+# if CRC_LE_BITS == 32
+		crc = DO_CRC4;
+# else
+		crc = DO_CRC8;
+		q = *++b;
+		crc ^= DO_CRC4;
+# endif
 	}
 	len = rem_len;
 	/* And the last few bytes */
@@ -91,80 +118,105 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 	return crc;
 #undef DO_CRC
 #undef DO_CRC4
+#undef DO_CRC8
 }
 #endif
+
 /**
- * crc32_le() - Calculate bitwise little-endian Ethernet AUTODIN II CRC32
- * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
- *	other uses, or the previous crc32 value if computing incrementally.
+ * crc32_le_generic() - Calculate bitwise little-endian CRC32
+ * @crc: seed value for computation.
  * @p: pointer to buffer over which CRC is run
  * @len: length of buffer @p
+ * @tab: little-endian table for @polynomial
+ * @polynomial: CRC32 LE polynomial
  */
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len);
-
-#if CRC_LE_BITS == 1
-/*
- * In fact, the table-based code will work in this case, but it can be
- * simplified by inlining the table in ?: form.
- */
-
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+static inline u32 __pure crc32_le_generic(u32 crc, unsigned char const *p,
+					  size_t len, const u32 (*tab)[256],
+					  u32 polynomial)
 {
+#if CRC_LE_BITS == 1
 	int i;
 	while (len--) {
 		crc ^= *p++;
 		for (i = 0; i < 8; i++)
-			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
+			crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+	}
+# elif CRC_LE_BITS == 2
+	while (len--) {
+		crc ^= *p++;
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
 	}
-	return crc;
-}
-#else				/* Table-based approach */
-
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
-{
-# if CRC_LE_BITS == 8
-	const u32      (*tab)[] = crc32table_le;
-
-	crc = __cpu_to_le32(crc);
-	crc = crc32_body(crc, p, len, tab);
-	return __le32_to_cpu(crc);
 # elif CRC_LE_BITS == 4
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
+		crc = (crc >> 4) ^ tab[0][crc & 15];
+		crc = (crc >> 4) ^ tab[0][crc & 15];
 	}
-	return crc;
-# elif CRC_LE_BITS == 2
+# elif CRC_LE_BITS == 8
+	/* aka Sarwate algorithm */
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
+		crc = (crc >> 8) ^ tab[0][crc & 255];
 	}
+# else
+	crc = (__force u32) __cpu_to_le32(crc);
+	crc = crc32_body(crc, p, len, tab);
+	crc = __le32_to_cpu((__force __le32)crc);
+#endif
 	return crc;
-# endif
 }
-#endif
 
 /**
- * crc32_be() - Calculate bitwise big-endian Ethernet AUTODIN II CRC32
+ * crc32_le() - Calculate bitwise little-endian Ethernet AUTODIN II CRC32
  * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
  *	other uses, or the previous crc32 value if computing incrementally.
  * @p: pointer to buffer over which CRC is run
  * @len: length of buffer @p
  */
-u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len);
+#if CRC_LE_BITS == 1
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, NULL, CRCPOLY_LE);
+}
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, NULL, CRC32C_POLY_LE);
+}
+#else
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, crc32table_le, CRCPOLY_LE);
+}
 
-#if CRC_BE_BITS == 1
-/*
- * In fact, the table-based code will work in this case, but it can be
- * simplified by inlining the table in ?: form.
+/**
+ * __crc32c_le() - Calculate bitwise little-endian CRC32c (Castagnoli)
+ * @crc: seed value, or the previous crc32c value if computing
+ *	incrementally.  There is no final inversion here, users of the
+ *	crypto API get that from the "crc32c" digest.
+ * @p: pointer to buffer over which CRC is run
+ * @len: length of buffer @p
  */
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, crc32ctable_le, CRC32C_POLY_LE);
+}
+#endif
+EXPORT_SYMBOL(crc32_le);
+EXPORT_SYMBOL(__crc32c_le);
 
+/**
+ * crc32_be() - Calculate bitwise big-endian Ethernet AUTODIN II CRC32
+ * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
+ *	other uses, or the previous crc32 value if computing incrementally.
+ * @p: pointer to buffer over which CRC is run
+ * @len: length of buffer @p
+ */
 u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 {
+#if CRC_BE_BITS == 1
 	int i;
 	while (len--) {
 		crc ^= *p++ << 24;
@@ -173,39 +225,32 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 			    (crc << 1) ^ ((crc & 0x80000000) ? CRCPOLY_BE :
 					  0);
 	}
-	return crc;
-}
-
-#else				/* Table-based approach */
-u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
-{
-# if CRC_BE_BITS == 8
-	const u32      (*tab)[] = crc32table_be;
-
-	crc = __cpu_to_be32(crc);
-	crc = crc32_body(crc, p, len, tab);
-	return __be32_to_cpu(crc);
+# elif CRC_BE_BITS == 2
+	while (len--) {
+		crc ^= *p++ << 24;
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+	}
 # elif CRC_BE_BITS == 4
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
 	}
-	return crc;
-# elif CRC_BE_BITS == 2
+# elif CRC_BE_BITS == 8
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
+		crc = (crc << 8) ^ crc32table_be[0][crc >> 24];
 	}
-	return crc;
+# else
+	crc = (__force u32) __cpu_to_be32(crc);
+	crc = crc32_body(crc, p, len, crc32table_be);
+	crc = __be32_to_cpu((__force __be32)crc);
 # endif
+	return crc;
 }
-#endif
-
-EXPORT_SYMBOL(crc32_le);
 EXPORT_SYMBOL(crc32_be);
 
 /*
@@ -335,6 +380,159 @@ EXPORT_SYMBOL(crc32_be);
  * the same way on decoding, it doesn't make a difference.
  */
 
+#ifdef CONFIG_CRC32_SELFTEST
+
+#define CRC32_TEST_BUF_SIZE	4096
+
+/* Filled by crc32_fill_test_buf() before the tests run */
+static u8 __initdata __aligned(8) test_buf[CRC32_TEST_BUF_SIZE];
+
+/*
+ * Expected results were computed with the bit at a time algorithm over
+ * the buffer made by crc32_fill_test_buf(), for a random seed and start
+ * offset and lengths chosen around the word and cacheline boundaries.
+ */
+static struct crc_test {
+	u32 crc;	/* random starting crc */
+	u32 start;	/* random offset in test_buf */
+	u32 length;	/* length of test */
+	u32 crc_le;	/* expected crc32_le result */
+	u32 crc_be;	/* expected crc32_be result */
+	u32 crc32c_le;	/* expected __crc32c_le result */
+} const test[] __initconst = {
+	{0x06671ad1, 0x0000000e, 0x00000000, 0x06671ad1, 0x06671ad1, 0x06671ad1},
+	{0x3eb13b90, 0x00000023, 0x00000001, 0xb5ee7e0a, 0xf0696da9, 0x0d038f21},
+	{0x23b8c1e9, 0x0000001c, 0x00000002, 0x7168706b, 0x52c9523b, 0xed980350},
+	{0xad3c2d6d, 0x0000000d, 0x00000003, 0x45771fb3, 0x011dad18, 0xd423906b},
+	{0x972a8469, 0x0000000b, 0x00000004, 0x385cec80, 0xa3f35a2b, 0x7e221639},
+	{0x0822e8f3, 0x00000036, 0x00000007, 0x453ac640, 0xdf02d216, 0xa7f7bf15},
+	{0x17fc695a, 0x00000003, 0x00000008, 0x6c647d69, 0x7e6a2884, 0x1ff64345},
+	{0x3b8faa18, 0x0000001b, 0x00000009, 0x9695e193, 0x8cabdf58, 0xa2874e3a},
+	{0x8fadc1a6, 0x00000003, 0x0000000f, 0xc1ec25f8, 0x8ae930dc, 0xbf0e9c7d},
+	{0xb74d0fb1, 0x00000019, 0x00000010, 0x6337f550, 0x785db359, 0x004979bd},
+	{0x386ecbe0, 0x00000035, 0x00000011, 0x33228d9c, 0x1fc5fd5c, 0x39f743f6},
+	{0x96da1dac, 0x00000039, 0x0000001f, 0x54bf50b4, 0x277aa25d, 0x92402bba},
+	{0xcf36d58b, 0x00000023, 0x00000020, 0x8374a56c, 0x2e449fa7, 0xd082c562},
+	{0xc241330b, 0x00000000, 0x00000021, 0xe673528a, 0xc3d438e1, 0xf4770283},
+	{0xb2b9437a, 0x00000014, 0x0000003f, 0x4b862022, 0x07df7407, 0xb599a011},
+	{0x571aa876, 0x00000036, 0x00000040, 0x52ec2d24, 0x929ddd73, 0x8174d0b9},
+	{0x27cd8130, 0x00000023, 0x00000041, 0x1e239446, 0x1ada3717, 0xd513e24f},
+	{0xf50bea63, 0x0000001b, 0x0000007f, 0x8895ffc3, 0x53f9a2fa, 0xa49c15f1},
+	{0x1a2a73ed, 0x0000002b, 0x00000080, 0xa1b784e2, 0x529df5e1, 0xe7d0994b},
+	{0x6142ea7d, 0x0000000b, 0x00000081, 0xef219946, 0xd47a3fae, 0xfdceffe4},
+	{0x5be6128e, 0x0000000c, 0x000000ff, 0x33447a47, 0xa51e4a53, 0x5aa8ce74},
+	{0x9a8dca03, 0x0000002c, 0x00000100, 0x214c836e, 0x1221742c, 0x1355c4a6},
+	{0xce9ff57f, 0x00000021, 0x00000101, 0x7ab59ccf, 0xebd3976a, 0x5b8dab4e},
+	{0xbacfb3d0, 0x00000005, 0x000001ff, 0x1e81ebda, 0x7e49e31b, 0xcda01f41},
+	{0x89463e85, 0x0000003a, 0x00000200, 0x9b816730, 0x8793e009, 0xf55fc90a},
+	{0xf91e1d4c, 0x0000000f, 0x000003e8, 0x7f6b4c6c, 0x8793c57e, 0x1fd06b64},
+	{0x142c3fe8, 0x00000030, 0x00000400, 0x8102c4e8, 0x41059163, 0x17b25447},
+	{0xd453dd32, 0x00000025, 0x000005dc, 0xa5b3c7dc, 0xfc036b02, 0xb8a244c0},
+	{0x93cd59bf, 0x0000002e, 0x00000800, 0xd2e6f3ed, 0xc9c17188, 0x4602f90b},
+	{0xb45ed1f0, 0x00000018, 0x00000bb8, 0x6189aff5, 0x06aa9664, 0x2dc3edf0},
+	{0x0bbb2599, 0x00000008, 0x00000fc0, 0x7e1812d1, 0xcf0602a9, 0x06fb9974},
+	{0xc5e7ce8a, 0x0000001d, 0x00000fa0, 0x1ab33545, 0x8b429fe0, 0x536828ad},
+};
+
+/* Keeps the benchmark loops from being optimized away */
+static volatile u32 crc32_sink;
+
+static void __init crc32_fill_test_buf(void)
+{
+	u32 x = 0x2545f491;	/* xorshift32 */
+	int i;
+
+	for (i = 0; i < CRC32_TEST_BUF_SIZE; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		test_buf[i] = x >> 24;
+	}
+}
+
+static int __init crc32_selftest(void)
+{
+	int i, errors = 0;
+
+	for (i = 0; i < ARRAY_SIZE(test); i++) {
+		const u8 *p = test_buf + test[i].start;
+
+		if (crc32_le(test[i].crc, p, test[i].length) != test[i].crc_le)
+			errors++;
+		if (crc32_be(test[i].crc, p, test[i].length) != test[i].crc_be)
+			errors++;
+		if (__crc32c_le(test[i].crc, p, test[i].length) !=
+		    test[i].crc32c_le)
+			errors++;
+	}
+
+	return errors;
+}
+
+/* MB/s of @fn over 1MB worth of @len byte buffers */
+static unsigned int __init crc32_speed(u32 (*fn)(u32, unsigned char const *,
+						 size_t), size_t len)
+{
+	unsigned int i, loops = (1 << 20) / len;
+	unsigned long flags;
+	u32 crc = 0;
+	ktime_t start;
+	s64 nsec;
+
+	local_irq_save(flags);
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		crc = fn(crc, test_buf, len);
+	nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+	local_irq_restore(flags);
+
+	crc32_sink = crc;
+	if (nsec <= 0)
+		return 0;
+	return div64_u64((u64)loops * len * 1000, nsec);
+}
+
+static void __init crc32_benchmark(void)
+{
+	static const unsigned int sizes[] __initconst = {
+		16, 64, 256, 1024, 4096
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++)
+		pr_info("crc32: %4u byte buffers: crc32_le %u MB/s, "
+			"crc32_be %u MB/s, crc32c %u MB/s\n", sizes[i],
+			crc32_speed(crc32_le, sizes[i]),
+			crc32_speed(crc32_be, sizes[i]),
+			crc32_speed(__crc32c_le, sizes[i]));
+}
+
+static int __init crc32_init(void)
+{
+	int errors;
+
+	crc32_fill_test_buf();
+
+	errors = crc32_selftest();
+	if (errors)
+		pr_warning("crc32: %d self tests failed\n", errors);
+	else
+		pr_info("crc32: self tests passed, CRC_LE_BITS=%d\n",
+			CRC_LE_BITS);
+
+	crc32_benchmark();
+
+	return 0;
+}
+
+static void __exit crc32_exit(void)
+{
+}
+
+module_init(crc32_init);
+module_exit(crc32_exit);
+#endif /* CONFIG_CRC32_SELFTEST */
+
 #ifdef UNITTEST
 
 #include <stdlib.h>
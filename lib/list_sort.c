@@ -4,33 +4,40 @@
 #include <linux/slab.h>
 #include <linux/list.h>
 
-#define MAX_LIST_LENGTH_BITS 20
-
 /*
  * Returns a list organized in an intermediate format suited
  * to chaining of merge() calls: null-terminated, no reserved or
- * sentinel head node, "prev" links not maintained.
+ * sentinel head node, "prev" links not maintained.  Both @a and @b
+ * must be non-empty.
  */
 static struct list_head *merge(void *priv,
 				int (*cmp)(void *priv, struct list_head *a,
 					struct list_head *b),
 				struct list_head *a, struct list_head *b)
 {
-	struct list_head head, *tail = &head;
+	struct list_head *head, **tail = &head;
 
-	while (a && b) {
+	for (;;) {
 		/* if equal, take 'a' -- important for sort stability */
 		if ((*cmp)(priv, a, b) <= 0) {
-			tail->next = a;
+			*tail = a;
+			tail = &a->next;
 			a = a->next;
+			if (!a) {
+				*tail = b;
+				break;
+			}
 		} else {
-			tail->next = b;
+			*tail = b;
+			tail = &b->next;
 			b = b->next;
+			if (!b) {
+				*tail = a;
+				break;
+			}
 		}
-		tail = tail->next;
 	}
-	tail->next = a?:b;
-	return head.next;
+	return head;
 }
 
 /*
@@ -47,22 +54,31 @@ static void merge_and_restore_back_links(void *priv,
 				struct list_head *a, struct list_head *b)
 {
 	struct list_head *tail = head;
+	u8 count = 0;
 
-	while (a && b) {
+	for (;;) {
 		/* if equal, take 'a' -- important for sort stability */
 		if ((*cmp)(priv, a, b) <= 0) {
 			tail->next = a;
 			a->prev = tail;
+			tail = a;
 			a = a->next;
+			if (!a)
+				break;
 		} else {
 			tail->next = b;
 			b->prev = tail;
+			tail = b;
 			b = b->next;
+			if (!b) {
+				b = a;
+				break;
+			}
 		}
-		tail = tail->next;
 	}
-	tail->next = a ? : b;
 
+	/* Finish linking the remainder, now in b, onto tail */
+	tail->next = b;
 	do {
 		/*
 		 * In worst cases this loop may run many iterations.
@@ -70,11 +86,12 @@ static void merge_and_restore_back_links(void *priv,
 		 * element comparison is needed, so the client's cmp()
 		 * routine can invoke cond_resched() periodically.
 		 */
-		(*cmp)(priv, tail->next, tail->next);
-
-		tail->next->prev = tail;
-		tail = tail->next;
-	} while (tail->next);
+		if (unlikely(!++count))
+			(*cmp)(priv, b, b);
+		b->prev = tail;
+		tail = b;
+		b = b->next;
+	} while (b);
 
 	tail->next = head;
 	head->prev = tail;
@@ -86,63 +103,87 @@ static void merge_and_restore_back_links(void *priv,
  * @head: the list to sort
  * @cmp: the elements comparison function
  *
- * This function implements "merge sort", which has O(nlog(n))
- * complexity.
+ * This function implements a bottom-up "merge sort", which has
+ * O(nlog(n)) complexity.
  *
  * The comparison function @cmp must return a negative value if @a
  * should sort before @b, and a positive value if @a should sort after
  * @b. If @a and @b are equivalent, and their original relative
  * ordering is to be preserved, @cmp must return 0.
+ *
+ * Sorted sublists waiting to be merged are kept on a "pending" stack
+ * chained through their heads' otherwise unused prev pointers, newest
+ * first, rather than in an array of list heads.  Each sublist has a
+ * power of two size, and two sublists of size 2^k are merged as soon as
+ * a third one of that size is complete behind them.  Merges are thus
+ * never worse than 2:1 balanced, all the data of a merge was touched
+ * recently, and the number of comparisons stays close to the minimum
+ * for a merge sort.
+ *
+ * Which sublists to merge follows from the number of elements moved to
+ * the pending stack so far: if it is of the form x01...1 in binary, with
+ * k trailing ones, the two sublists of size 2^k on top of the stack are
+ * merged before the next element is added, unless x is zero (there is
+ * only one sublist of that size).
  */
 void list_sort(void *priv, struct list_head *head,
 		int (*cmp)(void *priv, struct list_head *a,
 			struct list_head *b))
 {
-	struct list_head *part[MAX_LIST_LENGTH_BITS+1]; /* sorted partial lists
-						-- last slot is a sentinel */
-	int lev;  /* index into part[] */
-	int max_lev = 0;
-	struct list_head *list;
+	struct list_head *list = head->next, *pending = NULL;
+	size_t count = 0;	/* elements moved to pending */
 
-	if (list_empty(head))
+	if (list == head->prev)	/* zero or one elements */
 		return;
 
-	memset(part, 0, sizeof(part));
-
+	/* Convert to a null-terminated singly-linked list. */
 	head->prev->next = NULL;
-	list = head->next;
 
-	while (list) {
-		struct list_head *cur = list;
-		list = list->next;
-		cur->next = NULL;
-
-		for (lev = 0; part[lev]; lev++) {
-			cur = merge(priv, cmp, part[lev], cur);
-			part[lev] = NULL;
-		}
-		if (lev > max_lev) {
-			if (unlikely(lev >= ARRAY_SIZE(part)-1)) {
-				printk_once(KERN_DEBUG "list passed to"
-					" list_sort() too long for"
-					" efficiency\n");
-				lev--;
-			}
-			max_lev = lev;
+	do {
+		size_t bits;
+		struct list_head **tail = &pending;
+
+		/* Find the least-significant clear bit in count */
+		for (bits = count; bits & 1; bits >>= 1)
+			tail = &(*tail)->prev;
+		/* Do the indicated merge */
+		if (likely(bits)) {
+			struct list_head *a = *tail, *b = a->prev;
+
+			a = merge(priv, cmp, b, a);
+			/* Install the merged result in place of the inputs */
+			a->prev = b->prev;
+			*tail = a;
 		}
-		part[lev] = cur;
-	}
 
-	for (lev = 0; lev < max_lev; lev++)
-		if (part[lev])
-			list = merge(priv, cmp, part[lev], list);
+		/* Move one element from input list to pending */
+		list->prev = pending;
+		pending = list;
+		list = list->next;
+		pending->next = NULL;
+		count++;
+	} while (list);
+
+	/* End of input; merge together all the pending lists. */
+	list = pending;
+	pending = pending->prev;
+	for (;;) {
+		struct list_head *next = pending->prev;
+
+		if (!next)
+			break;
+		list = merge(priv, cmp, pending, list);
+		pending = next;
+	}
 
-	merge_and_restore_back_links(priv, cmp, head, part[max_lev], list);
+	/* The final merge, rebuilding prev links */
+	merge_and_restore_back_links(priv, cmp, head, pending, list);
 }
 EXPORT_SYMBOL(list_sort);
 
 #ifdef CONFIG_TEST_LIST_SORT
 
+#include <linux/hrtimer.h>
 #include <linux/random.h>
 
 /*
@@ -165,6 +206,8 @@ struct debug_el {
 /* Array, containing pointers to all elements in the test list */
 static struct debug_el **elts __initdata;
 
+static unsigned long cmp_count __initdata;
+
 static int __init check(struct debug_el *ela, struct debug_el *elb)
 {
 	if (ela->serial >= TEST_LIST_LEN) {
@@ -201,6 +244,7 @@ static int __init cmp(void *priv, struct list_head *a, struct list_head *b)
 	ela = container_of(a, struct debug_el, list);
 	elb = container_of(b, struct debug_el, list);
 
+	cmp_count++;
 	check(ela, elb);
 	return ela->value - elb->value;
 }
@@ -210,6 +254,7 @@ static int __init list_sort_test(void)
 	int i, count = 1, err = -EINVAL;
 	struct debug_el *el;
 	struct list_head *cur, *tmp;
+	ktime_t start;
 	LIST_HEAD(head);
 
 	printk(KERN_DEBUG "list_sort_test: start testing list_sort()\n");
@@ -237,7 +282,11 @@ static int __init list_sort_test(void)
 		list_add_tail(&el->list, &head);
 	}
 
+	start = ktime_get();
 	list_sort(NULL, &head, cmp);
+	printk(KERN_DEBUG "list_sort_test: %d elements, %lu comparisons, "
+	       "%lld ns\n", TEST_LIST_LEN, cmp_count,
+	       (long long)ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 	for (cur = head.next; cur->next != &head; cur = cur->next) {
 		struct debug_el *el1;
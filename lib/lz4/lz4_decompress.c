@@ -92,8 +92,13 @@ static int lz4_uncompress(const char *source, char *dest, int osize)
 			ip += length;
 			break; /* EOF */
 		}
-		LZ4_WILDCOPY(ip, op, cpy);
-		ip -= (op - cpy);
+		if (length >= MEMCPY_LITERALS) {
+			memcpy(op, ip, length);
+			ip += length;
+		} else {
+			LZ4_WILDCOPY(ip, op, cpy);
+			ip -= (op - cpy);
+		}
 		op = cpy;
 
 		/* get offset */
@@ -140,8 +145,13 @@ static int lz4_uncompress(const char *source, char *dest, int osize)
 			/* Error: request to write beyond destination buffer */
 			if (cpy > oend)
 				goto _output_error;
+#if LZ4_ARCH64
+			/* op has moved on by a whole step, it may be past this */
+			if ((ref + COPYLENGTH) > oend)
+#else
 			if ((ref + COPYLENGTH) > oend ||
 					(op + COPYLENGTH) > oend)
+#endif
 				goto _output_error;
 			LZ4_SECURECOPY(ref, op, (oend - COPYLENGTH));
 			while (op < cpy)
@@ -187,6 +197,32 @@ static int lz4_uncompress_unknownoutputsize(const char *source, char *dest,
 		/* get runlength */
 		token = *ip++;
 		length = (token >> ML_BITS);
+
+		/*
+		 * Shortcut for the common case of at most 14 literals and a
+		 * match of at most 18 bytes that does not overlap itself:
+		 * copy fixed size blocks and skip the length loops and the
+		 * end of buffer checks. This reads at most 16 bytes of input
+		 * and writes at most 14 + 24 bytes of output.
+		 */
+		if (length < RUN_MASK && (token & ML_MASK) != ML_MASK &&
+		    iend - ip >= 16 && oend - op >= 38) {
+			LZ4_COPY8(ip, op);
+			LZ4_COPY8(ip + 8, op + 8);
+			op += length;
+			ip += length;
+
+			ref = op - get_unaligned_le16(ip);
+			if (op - ref < 8 || ref < (BYTE * const) dest)
+				goto _get_offset;
+			ip += 2;
+			LZ4_COPY8(ref, op);
+			LZ4_COPY8(ref + 8, op + 8);
+			LZ4_COPY8(ref + 16, op + 16);
+			op += (token & ML_MASK) + MINMATCH;
+			continue;
+		}
+
 		if (length == RUN_MASK) {
 			int s = 255;
 			while ((ip < iend) && (s == 255)) {
@@ -214,12 +250,18 @@ static int lz4_uncompress_unknownoutputsize(const char *source, char *dest,
 			op += length;
 			break;/* Necessarily EOF, due to parsing restrictions */
 		}
-		LZ4_WILDCOPY(ip, op, cpy);
-		ip -= (op - cpy);
+		if (length >= MEMCPY_LITERALS) {
+			memcpy(op, ip, length);
+			ip += length;
+		} else {
+			LZ4_WILDCOPY(ip, op, cpy);
+			ip -= (op - cpy);
+		}
 		op = cpy;
 
+_get_offset:
 		/* get offset */
-		LZ4_READ_LITTLEENDIAN_16(ref, cpy, ip);
+		LZ4_READ_LITTLEENDIAN_16(ref, op, ip);
 		ip += 2;
 		if (ref < (BYTE * const) dest)
 			goto _output_error;
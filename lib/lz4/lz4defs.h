@@ -60,6 +60,7 @@ typedef struct _U64_S { u64 v; } U64_S;
 #endif
 
 #define COPYLENGTH 8
+#define MEMCPY_LITERALS	64	/* runs this long go to the arch memcpy */
 #define ML_BITS  4
 #define ML_MASK  ((1U << ML_BITS) - 1)
 #define RUN_BITS (8 - ML_BITS)
@@ -100,12 +101,6 @@ typedef struct _U64_S { u64 v; } U64_S;
 
 #define LZ4_COPYPACKET(s, d)	LZ4_COPYSTEP(s, d)
 
-#define LZ4_SECURECOPY(s, d, e)			\
-	do {					\
-		if (d < e) {			\
-			LZ4_WILDCOPY(s, d, e);	\
-		}				\
-	} while (0)
 #define HTYPE u32
 
 #ifdef __BIG_ENDIAN
@@ -130,7 +125,6 @@ typedef struct _U64_S { u64 v; } U64_S;
 		LZ4_COPYSTEP(s, d);	\
 	} while (0)
 
-#define LZ4_SECURECOPY	LZ4_WILDCOPY
 #define HTYPE const u8*
 
 #ifdef __BIG_ENDIAN
@@ -141,6 +135,20 @@ typedef struct _U64_S { u64 v; } U64_S;
 
 #endif
 
+/*
+ * Copy 8 bytes without moving the pointers. 32-bit uses two word
+ * accesses, as ldrd/strd on ARM do not take unaligned addresses.
+ */
+#if LZ4_ARCH64
+#define LZ4_COPY8(s, d)	PUT8((s), (d))
+#else
+#define LZ4_COPY8(s, d)				\
+	do {					\
+		PUT4((s), (d));			\
+		PUT4(((s) + 4), ((d) + 4));	\
+	} while (0)
+#endif
+
 #define LZ4_READ_LITTLEENDIAN_16(d, s, p) \
 	(d = s - get_unaligned_le16(p))
 
@@ -149,6 +157,17 @@ typedef struct _U64_S { u64 v; } U64_S;
 		LZ4_COPYPACKET(s, d);	\
 	} while (d < e)
 
+/*
+ * LZ4_WILDCOPY always copies at least one packet, so near the end of the
+ * output this has to check first that there is anything to copy.
+ */
+#define LZ4_SECURECOPY(s, d, e)			\
+	do {					\
+		if (d < e) {			\
+			LZ4_WILDCOPY(s, d, e);	\
+		}				\
+	} while (0)
+
 #define LZ4_BLINDCOPY(s, d, l)	\
 	do {	\
 		u8 *e = (d) + l;	\
@@ -85,16 +85,20 @@ copy_literal_run:
 				if (likely(HAVE_IP(t + 15) && HAVE_OP(t + 15))) {
 					const unsigned char *ie = ip + t;
 					unsigned char *oe = op + t;
-					do {
-						COPY8(op, ip);
-						op += 8;
-						ip += 8;
+					if (unlikely(t >= MEMCPY_LITERALS)) {
+						memcpy(op, ip, t);
+					} else {
+						do {
+							COPY8(op, ip);
+							op += 8;
+							ip += 8;
 #  if !defined(__arm__)
-						COPY8(op, ip);
-						op += 8;
-						ip += 8;
+							COPY8(op, ip);
+							op += 8;
+							ip += 8;
 #  endif
-					} while (ip < ie);
+						} while (ip < ie);
+					}
 					ip = ie;
 					op = oe;
 				} else
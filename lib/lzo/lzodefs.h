@@ -39,6 +39,9 @@
 #define LZO_USE_CTZ32	1
 #endif
 
+/* Literal runs this long are copied with the arch memcpy */
+#define MEMCPY_LITERALS	64
+
 #define M1_MAX_OFFSET	0x0400
 #define M2_MAX_OFFSET	0x0800
 #define M3_MAX_OFFSET	0x4000
@@ -0,0 +1,57 @@
+/* -*- linux-c -*- ------------------------------------------------------- *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation.
+ *
+ * ----------------------------------------------------------------------- */
+
+/*
+ * raid6/neon.c
+ *
+ * Wrappers around the NEON RAID-6 syndrome functions of neonN.c
+ */
+
+#include <linux/raid/pq.h>
+
+#ifdef __KERNEL__
+#include <asm/neon.h>
+#else
+#define kernel_neon_begin()
+#define kernel_neon_end()
+#define cpu_has_neon()		(1)
+#endif
+
+/*
+ * The NEON code lives in its own units, generated from neon.uc, because
+ * it is built with -mfpu=neon: the compiler may then use NEON registers
+ * anywhere in it, and only the calls made from here are bracketed by
+ * kernel_neon_begin() and kernel_neon_end().
+ */
+#define RAID6_NEON_WRAPPER(_n)						\
+	void raid6_neon ## _n ## _gen_syndrome_real(int disks,		\
+				unsigned long bytes, void **ptrs);	\
+	static void raid6_neon ## _n ## _gen_syndrome(int disks,	\
+					size_t bytes, void **ptrs)	\
+	{								\
+		kernel_neon_begin();					\
+		raid6_neon ## _n ## _gen_syndrome_real(disks,		\
+					(unsigned long)bytes, ptrs);	\
+		kernel_neon_end();					\
+	}								\
+	const struct raid6_calls raid6_neonx ## _n = {			\
+		raid6_neon ## _n ## _gen_syndrome,			\
+		raid6_have_neon,					\
+		"neonx" #_n,						\
+		0							\
+	}
+
+static int raid6_have_neon(void)
+{
+	return cpu_has_neon();
+}
+
+RAID6_NEON_WRAPPER(1);
+RAID6_NEON_WRAPPER(2);
+RAID6_NEON_WRAPPER(4);
+RAID6_NEON_WRAPPER(8);
@@ -0,0 +1,98 @@
+/* -*- linux-c -*- ------------------------------------------------------- *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation.
+ *
+ * ----------------------------------------------------------------------- */
+
+/*
+ * raid6/recov_neon_inner.c
+ *
+ * NEON inner loops of the RAID-6 dual failure recovery. A multiplication
+ * by a constant in GF(2^8) is split into lookups of the low and the high
+ * nibble in the 16 entry halves of its raid6_vgfmul[] row, which vtbl
+ * does for 8 bytes at a time.
+ *
+ * Built for NEON without kernel headers, see recov_neon.c.
+ */
+
+#include <arm_neon.h>
+
+/* 16 byte lookup of each byte of @idx in @tbl, all indices below 16 */
+static inline uint8x16_t tbl16(uint8x8x2_t tbl, uint8x16_t idx)
+{
+	return vcombine_u8(vtbl2_u8(tbl, vget_low_u8(idx)),
+			   vtbl2_u8(tbl, vget_high_u8(idx)));
+}
+
+static inline uint8x8x2_t ld_tbl16(const uint8_t *p)
+{
+	uint8x8x2_t t;
+
+	t.val[0] = vld1_u8(p);
+	t.val[1] = vld1_u8(p + 8);
+	return t;
+}
+
+/* @mul * @x, with @mul a raid6_vgfmul[] row */
+static inline uint8x16_t gfmul16(uint8x8x2_t lo, uint8x8x2_t hi,
+				 uint8x16_t x)
+{
+	return veorq_u8(tbl16(lo, vandq_u8(x, vdupq_n_u8(0x0f))),
+			tbl16(hi, vshrq_n_u8(x, 4)));
+}
+
+void __raid6_2data_recov_neon(int bytes, uint8_t *p, uint8_t *q,
+			      uint8_t *dp, uint8_t *dq,
+			      const uint8_t *pbmul, const uint8_t *qmul)
+{
+	uint8x8x2_t pm0 = ld_tbl16(pbmul), pm1 = ld_tbl16(pbmul + 16);
+	uint8x8x2_t qm0 = ld_tbl16(qmul), qm1 = ld_tbl16(qmul + 16);
+	uint8x16_t px, qx, db;
+
+	/*
+	 * for each byte:
+	 *	px = *p ^ *dp;
+	 *	qx = qmul[*q ^ *dq];
+	 *	*dq = db = pbmul[px] ^ qx;
+	 *	*dp = db ^ px;
+	 */
+	while (bytes > 0) {
+		px = veorq_u8(vld1q_u8(p), vld1q_u8(dp));
+		qx = gfmul16(qm0, qm1, veorq_u8(vld1q_u8(q), vld1q_u8(dq)));
+		db = veorq_u8(gfmul16(pm0, pm1, px), qx);
+
+		vst1q_u8(dq, db);
+		vst1q_u8(dp, veorq_u8(db, px));
+
+		bytes -= 16;
+		p += 16;
+		q += 16;
+		dp += 16;
+		dq += 16;
+	}
+}
+
+void __raid6_datap_recov_neon(int bytes, uint8_t *p, uint8_t *q,
+			      uint8_t *dq, const uint8_t *qmul)
+{
+	uint8x8x2_t qm0 = ld_tbl16(qmul), qm1 = ld_tbl16(qmul + 16);
+	uint8x16_t dx;
+
+	/*
+	 * for each byte:
+	 *	*p ^= *dq = qmul[*q ^ *dq];
+	 */
+	while (bytes > 0) {
+		dx = gfmul16(qm0, qm1, veorq_u8(vld1q_u8(q), vld1q_u8(dq)));
+
+		vst1q_u8(dq, dx);
+		vst1q_u8(p, veorq_u8(dx, vld1q_u8(p)));
+
+		bytes -= 16;
+		p += 16;
+		q += 16;
+		dq += 16;
+	}
+}
@@ -1,10 +1,11 @@
 /*
- * A fast, small, non-recursive O(nlog n) sort for the Linux kernel
+ * A fast, small, non-recursive O(n log n) sort for the Linux kernel
  *
  * Jan 23 2005  Matt Mackall <mpm@selenic.com>
  */
 
 #include <linux/kernel.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/sort.h>
 #include <linux/slab.h>
@@ -16,6 +17,26 @@ static void u32_swap(void *a, void *b, int size)
 	*(u32 *)b = t;
 }
 
+static void u64_swap(void *a, void *b, int size)
+{
+	u64 t = *(u64 *)a;
+	*(u64 *)a = *(u64 *)b;
+	*(u64 *)b = t;
+}
+
+static void word_swap(void *a, void *b, int size)
+{
+	unsigned long t;
+
+	do {
+		t = *(unsigned long *)a;
+		*(unsigned long *)a = *(unsigned long *)b;
+		*(unsigned long *)b = t;
+		a += sizeof(t);
+		b += sizeof(t);
+	} while ((size -= sizeof(t)) > 0);
+}
+
 static void generic_swap(void *a, void *b, int size)
 {
 	char t;
@@ -27,33 +48,22 @@ static void generic_swap(void *a, void *b, int size)
 	} while (--size > 0);
 }
 
-/**
- * sort - sort an array of elements
- * @base: pointer to data to sort
- * @num: number of elements
- * @size: size of each element
- * @cmp_func: pointer to comparison function
- * @swap_func: pointer to swap function or NULL
- *
- * This function does a heapsort on the given array. You may provide a
- * swap_func function optimized to your element type.
- *
- * Sorting time is O(n log n) both on average and worst-case. While
- * qsort is about 20% faster on average, it suffers from exploitable
- * O(n*n) worst-case behavior and extra memory requirements that make
- * it less suitable for kernel use.
+/*
+ * All elements are naturally aligned to @align if both the base and the
+ * element size are multiples of it.
  */
+static bool sort_aligned(const void *base, size_t size, size_t align)
+{
+	return !(((unsigned long)base | size) & (align - 1));
+}
 
-void sort(void *base, size_t num, size_t size,
-	  int (*cmp_func)(const void *, const void *),
-	  void (*swap_func)(void *, void *, int size))
+static void heapsort(void *base, size_t num, size_t size,
+		     int (*cmp_func)(const void *, const void *),
+		     void (*swap_func)(void *, void *, int size))
 {
 	/* pre-scale counters for performance */
 	int i = (num/2 - 1) * size, n = num * size, c, r;
 
-	if (!swap_func)
-		swap_func = (size == 4 ? u32_swap : generic_swap);
-
 	/* heapify */
 	for ( ; i >= 0; i -= size) {
 		for (r = i; r * 2 + size < n; r  = c) {
@@ -82,42 +92,325 @@ void sort(void *base, size_t num, size_t size,
 	}
 }
 
-EXPORT_SYMBOL(sort);
+static void insertion_sort(char *base, size_t num, size_t size,
+			   int (*cmp_func)(const void *, const void *),
+			   void (*swap_func)(void *, void *, int size))
+{
+	char *end = base + num * size, *i, *j;
 
-#if 0
-/* a simple boot-time regression test */
+	for (i = base + size; i < end; i += size)
+		for (j = i; j > base && cmp_func(j - size, j) > 0; j -= size)
+			swap_func(j - size, j, size);
+}
 
-int cmpint(const void *a, const void *b)
+/*
+ * Partition @num > 2 elements around the median of the first, middle and
+ * last one.  Elements are only ever moved with @swap_func, so the pivot
+ * stays in the first slot until the end.  Returns its final position.
+ */
+static char *partition(char *lo, size_t num, size_t size,
+		       int (*cmp_func)(const void *, const void *),
+		       void (*swap_func)(void *, void *, int size))
 {
-	return *(int *)a - *(int *)b;
+	char *mid = lo + (num / 2) * size;
+	char *hi = lo + (num - 1) * size;
+	char *i = lo, *j = hi + size;
+
+	if (cmp_func(lo, mid) > 0)
+		swap_func(lo, mid, size);
+	if (cmp_func(mid, hi) > 0) {
+		swap_func(mid, hi, size);
+		if (cmp_func(lo, mid) > 0)
+			swap_func(lo, mid, size);
+	}
+	swap_func(lo, mid, size);
+
+	/*
+	 * *hi is not less than the pivot and the pivot itself bounds the
+	 * downward scan, so neither scan needs a range check.  Both stop on
+	 * elements equal to the pivot, which keeps runs of equal keys from
+	 * producing lopsided partitions.
+	 */
+	for (;;) {
+		do
+			i += size;
+		while (cmp_func(i, lo) < 0);
+		do
+			j -= size;
+		while (cmp_func(lo, j) < 0);
+		if (i >= j)
+			break;
+		swap_func(i, j, size);
+	}
+	swap_func(lo, j, size);
+
+	return j;
 }
 
-static int sort_test(void)
+/* Ranges up to this many elements are finished by insertion sort */
+#define SORT_INSERTION_MAX	16
+
+/**
+ * sort - sort an array of elements
+ * @base: pointer to data to sort
+ * @num: number of elements
+ * @size: size of each element
+ * @cmp_func: pointer to comparison function
+ * @swap_func: pointer to swap function or NULL
+ *
+ * This function does an introsort on the given array: quicksort with a
+ * median of three pivot, insertion sort for short ranges, and heapsort
+ * for any range that partitions badly more than 2*log2(@num) times.
+ * Without a @swap_func, elements are swapped a u32, u64 or machine word
+ * at a time when size and alignment allow it.
+ *
+ * Sorting time is O(n log n) both on average and worst-case, with about
+ * half the comparisons of a plain heapsort on random input.  The range
+ * stack is bounded by the word size, so no memory is allocated.  The sort
+ * is not stable.
+ */
+
+void sort(void *base, size_t num, size_t size,
+	  int (*cmp_func)(const void *, const void *),
+	  void (*swap_func)(void *, void *, int size))
 {
-	int *a, i, r = 1;
+	struct {
+		char *lo;
+		size_t num;
+		unsigned int depth;
+	} stack[BITS_PER_LONG], *sp = stack;
+	char *lo = base, *p;
+	size_t nl, nr;
+	unsigned int depth;
+
+	if (num < 2)
+		return;
 
-	a = kmalloc(1000 * sizeof(int), GFP_KERNEL);
-	BUG_ON(!a);
+	if (!swap_func) {
+		if (size == 4)
+			swap_func = u32_swap;
+		else if (size == 8 && sort_aligned(base, size, sizeof(u64)))
+			swap_func = u64_swap;
+		else if (sort_aligned(base, size, sizeof(unsigned long)))
+			swap_func = word_swap;
+		else
+			swap_func = generic_swap;
+	}
+
+	depth = 2 * ilog2(num);
 
-	printk("testing sort()\n");
+	for (;;) {
+		if (num <= SORT_INSERTION_MAX) {
+			insertion_sort(lo, num, size, cmp_func, swap_func);
+		} else if (!depth) {
+			heapsort(lo, num, size, cmp_func, swap_func);
+		} else {
+			p = partition(lo, num, size, cmp_func, swap_func);
+			nl = (p - lo) / size;
+			nr = num - nl - 1;
+			depth--;
 
-	for (i = 0; i < 1000; i++) {
-		r = (r * 725861) % 6599;
-		a[i] = r;
+			/*
+			 * Stack the larger side and carry on with the smaller
+			 * one, which at least halves each time, so the stack
+			 * never holds more than log2(@num) ranges.
+			 */
+			sp->depth = depth;
+			if (nl > nr) {
+				sp->lo = lo;
+				sp->num = nl;
+				lo = p + size;
+				num = nr;
+			} else {
+				sp->lo = p + size;
+				sp->num = nr;
+				num = nl;
+			}
+			sp++;
+			continue;
+		}
+
+		if (sp == stack)
+			break;
+		sp--;
+		lo = sp->lo;
+		num = sp->num;
+		depth = sp->depth;
 	}
+}
+
+EXPORT_SYMBOL(sort);
+
+#ifdef CONFIG_TEST_SORT
+
+#include <linux/hrtimer.h>
+#include <linux/random.h>
+#include <linux/vmalloc.h>
+
+/*
+ * Boot-time check and benchmark of sort() against the heapsort it
+ * replaced.  Each element holds a u32 key followed by bytes derived from
+ * it, so a torn or duplicated element is caught as well as a bad order.
+ */
+#define TEST_SORT_LEN 4096
+
+static const size_t test_sort_sizes[] __initconst = { 4, 5, 8, 12, 16, 24 };
+static const char * const test_sort_patterns[] __initconst = {
+	"random", "sorted", "reversed", "few keys"
+};
+
+static unsigned long test_sort_cmps __initdata;
+static unsigned long test_sort_swaps __initdata;
+static void (*test_sort_swap)(void *, void *, int) __initdata;
+
+static u32 __init test_sort_key(const void *a)
+{
+	u32 key;
 
-	sort(a, 1000, sizeof(int), cmpint, NULL);
+	memcpy(&key, a, sizeof(key));
+	return key;
+}
+
+static int __init test_sort_cmp(const void *a, const void *b)
+{
+	u32 ka = test_sort_key(a), kb = test_sort_key(b);
+
+	return ka < kb ? -1 : ka > kb;
+}
+
+static int __init test_sort_count_cmp(const void *a, const void *b)
+{
+	test_sort_cmps++;
+	return test_sort_cmp(a, b);
+}
+
+static void __init test_sort_count_swap(void *a, void *b, int size)
+{
+	test_sort_swaps++;
+	test_sort_swap(a, b, size);
+}
+
+static void __init test_sort_fill(char *a, size_t size, int pattern)
+{
+	u32 key;
+	size_t i, j;
 
-	for (i = 0; i < 999; i++)
-		if (a[i] > a[i+1]) {
-			printk("sort() failed!\n");
+	for (i = 0; i < TEST_SORT_LEN; i++) {
+		switch (pattern) {
+		case 0:
+			key = random32();
+			break;
+		case 1:
+			key = i;
+			break;
+		case 2:
+			key = TEST_SORT_LEN - i;
+			break;
+		default:
+			key = random32() % 8;
 			break;
 		}
+		memcpy(a + i * size, &key, sizeof(key));
+		for (j = sizeof(key); j < size; j++)
+			a[i * size + j] = key + j;
+	}
+}
+
+static int __init test_sort_check(const char *a, size_t size, u64 sum)
+{
+	u32 key, prev = 0;
+	size_t i, j;
+
+	for (i = 0; i < TEST_SORT_LEN; i++) {
+		key = test_sort_key(a + i * size);
+		if (key < prev)
+			return -EINVAL;
+		for (j = sizeof(key); j < size; j++)
+			if (a[i * size + j] != (char)(key + j))
+				return -EINVAL;
+		sum -= key;
+		prev = key;
+	}
+
+	return sum ? -EINVAL : 0;
+}
+
+static void __init test_sort_run(char *a, const char *orig, size_t size,
+		void (*sort_func)(void *, size_t, size_t,
+				  int (*)(const void *, const void *),
+				  void (*)(void *, void *, int)),
+		s64 *ns)
+{
+	ktime_t start;
 
-	kfree(a);
+	/* timed with the default swap, then again counting operations */
+	memcpy(a, orig, TEST_SORT_LEN * size);
+	start = ktime_get();
+	sort_func(a, TEST_SORT_LEN, size, test_sort_cmp,
+		  sort_func == sort ? NULL : test_sort_swap);
+	*ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	memcpy(a, orig, TEST_SORT_LEN * size);
+	test_sort_cmps = test_sort_swaps = 0;
+	sort_func(a, TEST_SORT_LEN, size, test_sort_count_cmp,
+		  test_sort_count_swap);
+}
+
+static int __init sort_test(void)
+{
+	char *a, *orig;
+	unsigned long cmps, swaps;
+	s64 ns, heap_ns;
+	size_t size, n;
+	u64 sum;
+	int i, p, err = 0;
+
+	a = vmalloc(TEST_SORT_LEN * 24);
+	orig = vmalloc(TEST_SORT_LEN * 24);
+	if (!a || !orig) {
+		printk(KERN_ERR "sort_test: cannot allocate memory\n");
+		err = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(test_sort_sizes); i++) {
+		size = test_sort_sizes[i];
+		test_sort_swap = size == 4 ? u32_swap : generic_swap;
+
+		for (p = 0; p < ARRAY_SIZE(test_sort_patterns); p++) {
+			test_sort_fill(orig, size, p);
+			for (sum = 0, n = 0; n < TEST_SORT_LEN; n++)
+				sum += test_sort_key(orig + n * size);
+
+			test_sort_run(a, orig, size, heapsort, &heap_ns);
+			cmps = test_sort_cmps;
+			swaps = test_sort_swaps;
+			if (test_sort_check(a, size, sum))
+				err = -EINVAL;
+
+			test_sort_run(a, orig, size, sort, &ns);
+			if (test_sort_check(a, size, sum)) {
+				printk(KERN_ERR "sort_test: sort() failed, "
+				       "size %zu, %s input\n", size,
+				       test_sort_patterns[p]);
+				err = -EINVAL;
+			}
+
+			printk(KERN_INFO "sort_test: size %2zu %-8s: "
+			       "cmp %lu/%lu swap %lu/%lu ns %lld/%lld "
+			       "(intro/heap)\n", size, test_sort_patterns[p],
+			       test_sort_cmps, cmps, test_sort_swaps, swaps,
+			       (long long)ns, (long long)heap_ns);
+		}
+	}
 
-	return 0;
+	if (!err)
+		printk(KERN_INFO "sort_test: all tests passed\n");
+out:
+	vfree(orig);
+	vfree(a);
+	return err;
 }
 
 module_init(sort_test);
-#endif
+#endif /* CONFIG_TEST_SORT */
@@ -14,11 +14,20 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/compaction.h>
 
+/*
+ * kcompactd compacts proactively to keep allocations of this order cheap.
+ * It covers the 64K chunks ion and hwmem buffers are built from, as well
+ * as jumbo skbs, without trying to assemble whole pageblocks.
+ */
+#define COMPACTION_PROACTIVE_ORDER	(PAGE_ALLOC_COSTLY_ORDER + 1)
+
 /*
  * compact_control is used to track pages being migrated and the free pages
  * they are being migrated to during memory compaction. The free_pfn starts
@@ -34,6 +43,7 @@ struct compact_control {
 	unsigned long free_pfn;		/* isolate_freepages search base */
 	unsigned long migrate_pfn;	/* isolate_migratepages search base */
 	bool sync;			/* Synchronous migration */
+	bool proactive;			/* kcompactd lowering fragmentation */
 
 	/* Account for isolated anon and file pages */
 	unsigned long nr_anon;
@@ -44,6 +54,22 @@ struct compact_control {
 	struct zone *zone;
 };
 
+/*
+ * A tunable in [0, 100] that controls how hard kcompactd works to keep the
+ * free memory of a zone usable for COMPACTION_PROACTIVE_ORDER allocations.
+ * Fragmentation above the high mark starts proactive compaction, which
+ * then runs until it drops to the low mark.
+ */
+int sysctl_compaction_proactiveness = 20;
+
+static unsigned int fragmentation_score_wmark(bool low)
+{
+	unsigned int wmark_low;
+
+	wmark_low = max(100 - sysctl_compaction_proactiveness, 5);
+	return low ? wmark_low : min(wmark_low + 10, 100U);
+}
+
 static unsigned long release_freepages(struct list_head *freelist)
 {
 	struct page *page, *next;
@@ -464,6 +490,15 @@ static int compact_finished(struct zone *zone,
 	if (cc->free_pfn <= cc->migrate_pfn)
 		return COMPACT_COMPLETE;
 
+	/* Proactive compaction stops once fragmentation is low enough */
+	if (cc->proactive) {
+		if (kthread_should_stop() ||
+		    extfrag_for_order(zone, COMPACTION_PROACTIVE_ORDER) <=
+						fragmentation_score_wmark(true))
+			return COMPACT_PARTIAL;
+		return COMPACT_CONTINUE;
+	}
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -746,6 +781,29 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * Changing proactiveness may turn the periodic wakeups of kcompactd on,
+ * so kick the sleeping threads to pick up the new timeout.
+ */
+int sysctl_compaction_proactiveness_handler(struct ctl_table *table,
+			int write, void __user *buffer, size_t *length,
+			loff_t *ppos)
+{
+	int nid, ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write)
+		return ret;
+
+	for_each_node_state(nid, N_HIGH_MEMORY) {
+		pg_data_t *pgdat = NODE_DATA(nid);
+
+		if (pgdat->kcompactd)
+			wake_up_interruptible(&pgdat->kcompactd_wait);
+	}
+	return 0;
+}
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
@@ -767,3 +825,288 @@ void compaction_unregister_node(struct node *node)
 	return sysdev_remove_file(&node->sysdev, &attr_compact);
 }
 #endif /* CONFIG_SYSFS && CONFIG_NUMA */
+
+static inline bool kcompactd_work_requested(pg_data_t *pgdat)
+{
+	return pgdat->kcompactd_max_order > 0 || kthread_should_stop();
+}
+
+static bool kcompactd_node_suitable(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	enum zone_type classzone_idx = pgdat->kcompactd_classzone_idx;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		if (compaction_suitable(zone, pgdat->kcompactd_max_order) ==
+							COMPACT_CONTINUE)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Compact the zones of a node for the order kswapd could not satisfy.
+ * Migration is asynchronous and deferral is shared with direct
+ * compaction, so a zone that failed recently is left alone.
+ */
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	int order = pgdat->kcompactd_max_order;
+	enum zone_type classzone_idx = pgdat->kcompactd_classzone_idx;
+
+	count_vm_event(KCOMPACTD_WAKE);
+	lru_add_drain();
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		/*
+		 * Compaction frees blocks inside movable pageblocks, so the
+		 * movable free lists are where success shows up first.
+		 */
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = order,
+			.migratetype = MIGRATE_MOVABLE,
+			.sync = false,
+		};
+		int status;
+
+		zone = &pgdat->node_zones[zoneid];
+		if (!populated_zone(zone))
+			continue;
+
+		if (compaction_deferred(zone))
+			continue;
+
+		if (kthread_should_stop())
+			return;
+
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		status = compact_zone(zone, &cc);
+
+		if (zone_watermark_ok(zone, order, low_wmark_pages(zone),
+				      0, 0)) {
+			zone->compact_considered = 0;
+			zone->compact_defer_shift = 0;
+		} else if (status == COMPACT_COMPLETE) {
+			/* The whole zone was scanned without success */
+			defer_compaction(zone);
+		}
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+
+	/*
+	 * Regardless of success, we are done until woken up next. A request
+	 * for a higher order or a lower zone that came in meanwhile is kept.
+	 */
+	if (pgdat->kcompactd_max_order <= order)
+		pgdat->kcompactd_max_order = 0;
+	if (pgdat->kcompactd_classzone_idx >= classzone_idx)
+		pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
+}
+
+/*
+ * Compact the zones whose fragmentation is above the high mark. Returns
+ * true if any of them ended up below the low mark.
+ */
+static bool kcompactd_do_proactive(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	bool progress = false;
+
+	for (zoneid = 0; zoneid < pgdat->nr_zones; zoneid++) {
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = -1,
+			.sync = false,
+			.proactive = true,
+		};
+
+		zone = &pgdat->node_zones[zoneid];
+		if (!populated_zone(zone))
+			continue;
+
+		if (extfrag_for_order(zone, COMPACTION_PROACTIVE_ORDER) <=
+					fragmentation_score_wmark(false))
+			continue;
+
+		/* Not worth it if a failure would be due to lack of memory */
+		if (compaction_suitable(zone, COMPACTION_PROACTIVE_ORDER) ==
+							COMPACT_SKIPPED)
+			continue;
+
+		if (kthread_should_stop())
+			break;
+
+		count_vm_event(KCOMPACTD_PROACTIVE);
+		lru_add_drain();
+
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		compact_zone(zone, &cc);
+
+		if (extfrag_for_order(zone, COMPACTION_PROACTIVE_ORDER) <=
+					fragmentation_score_wmark(true))
+			progress = true;
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+
+	return progress;
+}
+
+/*
+ * Interval at which kcompactd checks the fragmentation of its node while
+ * proactive compaction is enabled.
+ */
+#define KCOMPACTD_PROACTIVE_INTERVAL	(HZ / 2)
+
+static long kcompactd_timeout(void)
+{
+	if (sysctl_compaction_proactiveness)
+		return KCOMPACTD_PROACTIVE_INTERVAL;
+	return MAX_SCHEDULE_TIMEOUT;
+}
+
+/*
+ * The background compaction daemon, started as a kernel thread
+ * from the init process.
+ */
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	struct task_struct *tsk = current;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	unsigned int proactive_defer = 0;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(tsk, cpumask);
+
+	set_freezable();
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
+
+	while (!kthread_should_stop()) {
+		long timeout = kcompactd_timeout();
+		struct task_struct *kswapd;
+
+		/* Also wake up to pick up a change of proactiveness */
+		if (wait_event_freezable_timeout(pgdat->kcompactd_wait,
+				kcompactd_work_requested(pgdat) ||
+				kcompactd_timeout() != timeout, timeout)) {
+			if (kcompactd_work_requested(pgdat))
+				kcompactd_do_work(pgdat);
+			continue;
+		}
+
+		if (!sysctl_compaction_proactiveness)
+			continue;
+
+		/* Leave the node alone while kswapd is reclaiming from it */
+		kswapd = pgdat->kswapd;
+		if (kswapd && kswapd->state == TASK_RUNNING)
+			continue;
+
+		if (proactive_defer) {
+			proactive_defer--;
+			continue;
+		}
+
+		/*
+		 * Compaction that fails to bring fragmentation down is likely
+		 * to fail again soon, so back off for a while.
+		 */
+		if (!kcompactd_do_proactive(pgdat))
+			proactive_defer = 1 << COMPACT_MAX_DEFER_SHIFT;
+	}
+
+	return 0;
+}
+
+/*
+ * kswapd has balanced the node but the high-order allocation that woke
+ * it may still fail because of fragmentation. Have kcompactd compact the
+ * node in the background instead of leaving it to direct compaction.
+ */
+void wakeup_kcompactd(pg_data_t *pgdat, int order, int classzone_idx)
+{
+	if (!order)
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+
+	if (pgdat->kcompactd_classzone_idx > classzone_idx)
+		pgdat->kcompactd_classzone_idx = classzone_idx;
+
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+
+	if (!kcompactd_node_suitable(pgdat))
+		return;
+
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * This kcompactd start function will be called by init and node-hot-add.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd on node %d\n", nid);
+		ret = PTR_ERR(pgdat->kcompactd);
+		pgdat->kcompactd = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+module_init(kcompactd_init)
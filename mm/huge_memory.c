@@ -1685,7 +1685,12 @@ static int __collapse_huge_page_isolate(struct vm_area_struct *vma,
 		}
 		VM_BUG_ON(PageCompound(page));
 		BUG_ON(!PageAnon(page));
-		VM_BUG_ON(!PageSwapBacked(page));
+
+		/* lazily freed by MADV_FREE, let reclaim have it instead */
+		if (!PageSwapBacked(page)) {
+			release_pte_pages(pte, _pte);
+			goto out;
+		}
 
 		/* cannot use mapcount: can't collapse if there's a gup pin */
 		if (page_count(page) != 1) {
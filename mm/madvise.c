@@ -13,6 +13,10 @@
 #include <linux/hugetlb.h>
 #include <linux/sched.h>
 #include <linux/ksm.h>
+#include <linux/swap.h>
+#include <linux/swapops.h>
+
+#include <asm/tlbflush.h>
 
 /*
  * Any behaviour which results in changes to the vma->vm_flags needs to
@@ -25,6 +29,7 @@ static int madvise_need_mmap_write(int behavior)
 	case MADV_REMOVE:
 	case MADV_WILLNEED:
 	case MADV_DONTNEED:
+	case MADV_FREE:
 		return 0;
 	default:
 		/* be safe, default to 1. list exceptions explicitly */
@@ -183,6 +188,114 @@ static long madvise_dontneed(struct vm_area_struct * vma,
 	return 0;
 }
 
+static int madvise_free_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct vm_area_struct *vma = walk->private;
+	struct mm_struct *mm = walk->mm;
+	pte_t *orig_pte, *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	int nr_swap = 0;
+
+	split_huge_page_pmd(mm, pmd);
+
+	orig_pte = pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+
+		if (pte_none(ptent))
+			continue;
+
+		/*
+		 * The contents are going away anyway, so a swapped out page
+		 * can be dropped right now, together with its swap slot.
+		 */
+		if (!pte_present(ptent)) {
+			swp_entry_t entry = pte_to_swp_entry(ptent);
+
+			if (pte_file(ptent) || non_swap_entry(entry))
+				continue;
+			nr_swap--;
+			free_swap_and_cache(entry);
+			pte_clear_not_present_full(mm, addr, pte, 0);
+			continue;
+		}
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page || !PageAnon(page) || PageKsm(page))
+			continue;
+
+		/*
+		 * A page shared with another process (e.g. after fork) still
+		 * holds data for that process, leave it alone.
+		 */
+		if (page_mapcount(page) != 1)
+			continue;
+
+		if (PageSwapCache(page) || PageDirty(page)) {
+			if (!trylock_page(page))
+				continue;
+			if (page_mapcount(page) != 1 ||
+			    (PageSwapCache(page) && !try_to_free_swap(page))) {
+				unlock_page(page);
+				continue;
+			}
+			/* try_to_free_swap() redirtied the page */
+			ClearPageDirty(page);
+			unlock_page(page);
+		}
+
+		/*
+		 * With a clean pte and a clean page, reclaim can discard the
+		 * page instead of swapping it out.  A write before then dirties
+		 * the pte again and the page is kept.
+		 */
+		if (pte_young(ptent) || pte_dirty(ptent)) {
+			ptent = ptep_get_and_clear(mm, addr, pte);
+			ptent = pte_mkold(pte_mkclean(ptent));
+			set_pte_at(mm, addr, pte, ptent);
+		}
+		ClearPageReferenced(page);
+		mark_page_lazyfree(page);
+	}
+
+	if (nr_swap)
+		add_mm_counter(mm, MM_SWAPENTS, nr_swap);
+	pte_unmap_unlock(orig_pte, ptl);
+	cond_resched();
+	return 0;
+}
+
+/*
+ * Application no longer needs the contents of an anonymous range but will
+ * probably reuse it.  Rather than zapping the pages like MADV_DONTNEED, mark
+ * them clean so reclaim can free them without swapping when memory is
+ * short, while a write before then simply keeps the page.
+ */
+static long madvise_free(struct vm_area_struct *vma,
+			     struct vm_area_struct **prev,
+			     unsigned long start, unsigned long end)
+{
+	struct mm_walk free_walk = {
+		.pmd_entry = madvise_free_pte_range,
+		.mm = vma->vm_mm,
+		.private = vma,
+	};
+
+	*prev = vma;
+	if (vma->vm_flags & (VM_LOCKED|VM_HUGETLB|VM_PFNMAP))
+		return -EINVAL;
+
+	/* MADV_FREE only works on private anonymous memory */
+	if (vma->vm_file)
+		return -EINVAL;
+
+	walk_page_range(start, end, &free_walk);
+	flush_tlb_range(vma, start, end);
+	return 0;
+}
+
 /*
  * Application wants to free up the pages and associated backing store.
  * This is effectively punching a hole into the middle of a file.
@@ -268,6 +381,8 @@ madvise_vma(struct vm_area_struct *vma, struct vm_area_struct **prev,
 		return madvise_willneed(vma, prev, start, end);
 	case MADV_DONTNEED:
 		return madvise_dontneed(vma, prev, start, end);
+	case MADV_FREE:
+		return madvise_free(vma, prev, start, end);
 	default:
 		return madvise_behavior(vma, prev, start, end, behavior);
 	}
@@ -285,6 +400,7 @@ madvise_behavior_valid(int behavior)
 	case MADV_REMOVE:
 	case MADV_WILLNEED:
 	case MADV_DONTNEED:
+	case MADV_FREE:
 #ifdef CONFIG_KSM
 	case MADV_MERGEABLE:
 	case MADV_UNMERGEABLE:
@@ -322,6 +438,9 @@ madvise_behavior_valid(int behavior)
  *		some pages ahead.
  *  MADV_DONTNEED - the application is finished with the given range,
  *		so the kernel can free resources associated with it.
+ *  MADV_FREE - the application no longer needs the contents of the given
+ *		anonymous range, the kernel may free the pages under memory
+ *		pressure unless they are written to again.
  *  MADV_REMOVE - the application wants to free up the given range of
  *		pages and associated backing store.
  *  MADV_DONTFORK - omit this area from child's address space when forking:
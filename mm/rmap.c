@@ -1192,6 +1192,17 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 		if (TTU_ACTION(flags) == TTU_MUNLOCK)
 			goto out_unmap;
 	}
+	/*
+	 * A page freed with MADV_FREE can only be discarded while nobody
+	 * has written to it again.  Check before flushing the TLB so that
+	 * dirty pages, the common case, back out cheaply.  Setting
+	 * PG_swapbacked turns the page back into normal anonymous memory.
+	 */
+	if ((flags & TTU_LZFREE) && pte_dirty(*pte)) {
+		SetPageSwapBacked(page);
+		ret = SWAP_FAIL;
+		goto out_unmap;
+	}
 	if (!(flags & TTU_IGNORE_ACCESS)) {
 		if (ptep_clear_flush_young_notify(vma, address, pte)) {
 			ret = SWAP_FAIL;
@@ -1203,6 +1214,23 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 	flush_cache_page(vma, address, page_to_pfn(page));
 	pteval = ptep_clear_flush_notify(vma, address, pte);
 
+	/*
+	 * Keep a lazily freed page that was written to before the TLB flush
+	 * completed, or that someone else holds a reference to, e.g. through
+	 * get_user_pages(), and may still write to.  The caller's reference
+	 * and one per mapping are all a discardable page has.  With the pte
+	 * cleared and flushed, no new reference can be taken through it, so
+	 * once every pte passed this check the page may be discarded.
+	 */
+	if ((flags & TTU_LZFREE) &&
+	    (pte_dirty(pteval) || PageDirty(page) ||
+	     page_count(page) > page_mapcount(page) + 1)) {
+		set_pte_at(mm, address, pte, pteval);
+		SetPageSwapBacked(page);
+		ret = SWAP_FAIL;
+		goto out_unmap;
+	}
+
 	/* Move the dirty bit to the physical page now the pte is gone. */
 	if (pte_dirty(pteval))
 		set_page_dirty(page);
@@ -1217,6 +1245,9 @@ int try_to_unmap_one(struct page *page, struct vm_area_struct *vma,
 			dec_mm_counter(mm, MM_FILEPAGES);
 		set_pte_at(mm, address, pte,
 				swp_entry_to_pte(make_hwpoison_entry(page)));
+	} else if (flags & TTU_LZFREE) {
+		/* Clean lazily freed page, the next fault zero-fills */
+		dec_mm_counter(mm, MM_ANONPAGES);
 	} else if (PageAnon(page)) {
 		swp_entry_t entry = { .val = page_private(page) };
 
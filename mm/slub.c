@@ -1422,10 +1422,15 @@ static inline int lock_and_freeze_slab(struct kmem_cache_node *n,
 
 /*
  * Try to allocate a partial slab from a specific node.
+ *
+ * While the list_lock is held a few more slabs are frozen and moved to
+ * the cpu partial list, so that the next refills do not have to come
+ * back to the node.
  */
-static struct page *get_partial_node(struct kmem_cache_node *n)
+static struct page *get_partial_node(struct kmem_cache *s,
+		struct kmem_cache_node *n, struct kmem_cache_cpu *c)
 {
-	struct page *page;
+	struct page *page, *page2, *first = NULL;
 
 	/*
 	 * Racy check. If we mistakenly see no partial slabs then we
@@ -1437,19 +1442,32 @@ static struct page *get_partial_node(struct kmem_cache_node *n)
 		return NULL;
 
 	spin_lock(&n->list_lock);
-	list_for_each_entry(page, &n->partial, lru)
-		if (lock_and_freeze_slab(n, page))
-			goto out;
-	page = NULL;
-out:
+	list_for_each_entry_safe(page, page2, &n->partial, lru) {
+		if (!lock_and_freeze_slab(n, page))
+			continue;
+
+		if (!first) {
+			/* Returned with the slab lock held */
+			first = page;
+		} else {
+			c->partial_objects += page->objects - page->inuse;
+			slab_unlock(page);
+			list_add(&page->lru, &c->partial);
+			c->partial_pages++;
+			stat(s, CPU_PARTIAL_NODE);
+		}
+		if (c->partial_objects >= s->cpu_partial / 2)
+			break;
+	}
 	spin_unlock(&n->list_lock);
-	return page;
+	return first;
 }
 
 /*
  * Get a page from somewhere. Search in increasing NUMA distances.
  */
-static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
+static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags,
+		struct kmem_cache_cpu *c)
 {
 #ifdef CONFIG_NUMA
 	struct zonelist *zonelist;
@@ -1489,7 +1507,7 @@ static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
 
 		if (n && cpuset_zone_allowed_hardwall(zone, flags) &&
 				n->nr_partial > s->min_partial) {
-			page = get_partial_node(n);
+			page = get_partial_node(s, n, c);
 			if (page) {
 				put_mems_allowed();
 				return page;
@@ -1504,16 +1522,17 @@ static struct page *get_any_partial(struct kmem_cache *s, gfp_t flags)
 /*
  * Get a partial page, lock it and return it.
  */
-static struct page *get_partial(struct kmem_cache *s, gfp_t flags, int node)
+static struct page *get_partial(struct kmem_cache *s, gfp_t flags, int node,
+		struct kmem_cache_cpu *c)
 {
 	struct page *page;
 	int searchnode = (node == NUMA_NO_NODE) ? numa_node_id() : node;
 
-	page = get_partial_node(get_node(s, searchnode));
+	page = get_partial_node(s, get_node(s, searchnode), c);
 	if (page || node != NUMA_NO_NODE)
 		return page;
 
-	return get_any_partial(s, flags);
+	return get_any_partial(s, flags, c);
 }
 
 /*
@@ -1563,6 +1582,77 @@ static void unfreeze_slab(struct kmem_cache *s, struct page *page, int tail)
 	}
 }
 
+/*
+ * Move all slabs on the cpu partial list back to the node lists.
+ *
+ * Called with interrupts disabled, either on the cpu owning the list
+ * or on behalf of a cpu that is gone.
+ */
+static void unfreeze_partials(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct page *page, *page2;
+
+	list_for_each_entry_safe(page, page2, &c->partial, lru) {
+		list_del(&page->lru);
+		slab_lock(page);
+		unfreeze_slab(s, page, 1);
+	}
+	c->partial_pages = 0;
+	c->partial_objects = 0;
+}
+
+/*
+ * Put a slab that was full and just had an object freed into the cpu
+ * partial list of this cpu. The slab has already been frozen, so frees
+ * racing with us will not try to put it onto the node partial list.
+ *
+ * The object count is approximate: it is taken when the slab is added
+ * and is not updated by later frees. Once it reaches cpu_partial the
+ * existing slabs are handed back to the node before the new one is
+ * added.
+ *
+ * Called with interrupts disabled.
+ */
+static void put_cpu_partial(struct kmem_cache *s, struct page *page,
+			    int objects)
+{
+	struct kmem_cache_cpu *c = this_cpu_ptr(s->cpu_slab);
+
+	if (c->partial_objects >= s->cpu_partial) {
+		unfreeze_partials(s, c);
+		stat(s, CPU_PARTIAL_DRAIN);
+	}
+	list_add(&page->lru, &c->partial);
+	c->partial_pages++;
+	c->partial_objects += objects;
+	stat(s, CPU_PARTIAL_FREE);
+}
+
+/*
+ * Take a slab from the cpu partial list that satisfies the node
+ * constraint. The slab is returned locked.
+ */
+static struct page *get_cpu_partial(struct kmem_cache *s,
+				    struct kmem_cache_cpu *c, int node)
+{
+	struct page *page;
+
+	list_for_each_entry(page, &c->partial, lru) {
+		if (node != NUMA_NO_NODE && page_to_nid(page) != node)
+			continue;
+
+		list_del(&page->lru);
+		c->partial_pages--;
+		slab_lock(page);
+		c->partial_objects -= page->objects - page->inuse;
+		if (c->partial_objects < 0 || !c->partial_pages)
+			c->partial_objects = 0;
+		stat(s, CPU_PARTIAL_ALLOC);
+		return page;
+	}
+	return NULL;
+}
+
 #ifdef CONFIG_PREEMPT
 /*
  * Calculate the next globally unique transaction for disambiguiation
@@ -1626,8 +1716,12 @@ void init_kmem_cache_cpus(struct kmem_cache *s)
 {
 	int cpu;
 
-	for_each_possible_cpu(cpu)
-		per_cpu_ptr(s->cpu_slab, cpu)->tid = init_tid(cpu);
+	for_each_possible_cpu(cpu) {
+		struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
+
+		c->tid = init_tid(cpu);
+		INIT_LIST_HEAD(&c->partial);
+	}
 }
 /*
  * Remove the cpu slab
@@ -1682,6 +1776,9 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 
 	if (likely(c && c->page))
 		flush_slab(s, c);
+
+	if (c && !list_empty(&c->partial))
+		unfreeze_partials(s, c);
 }
 
 static void flush_cpu_slab(void *d)
@@ -1847,7 +1944,14 @@ another_slab:
 	deactivate_slab(s, c);
 
 new_slab:
-	page = get_partial(s, gfpflags, node);
+	page = get_cpu_partial(s, c, node);
+	if (page) {
+		c->node = page_to_nid(page);
+		c->page = page;
+		goto load_freelist;
+	}
+
+	page = get_partial(s, gfpflags, node, c);
 	if (page) {
 		stat(s, ALLOC_FROM_PARTIAL);
 		c->node = page_to_nid(page);
@@ -2061,9 +2165,19 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 
 	/*
 	 * Objects left in the slab. If it was not on the partial list before
-	 * then add it.
+	 * then add it. Prefer the partial list of this cpu: it avoids the
+	 * list_lock here and the next allocations will refill from it.
 	 */
 	if (unlikely(!prior)) {
+		if (s->cpu_partial && !kmem_cache_debug(s)) {
+			int objects = page->objects - page->inuse;
+
+			__SetPageSlubFrozen(page);
+			slab_unlock(page);
+			put_cpu_partial(s, page, objects);
+			local_irq_restore(flags);
+			return;
+		}
 		add_partial(get_node(s, page_to_nid(page)), page, 1);
 		stat(s, FREE_ADD_PARTIAL);
 	}
@@ -2600,6 +2714,24 @@ static int kmem_cache_open(struct kmem_cache *s,
 	 * list to avoid pounding the page allocator excessively.
 	 */
 	set_min_partial(s, ilog2(s->size));
+
+	/*
+	 * cpu_partial bounds the number of free objects kept on the per cpu
+	 * partial lists. Large objects come in slabs holding few of them, so
+	 * fewer objects are kept around for those. Debugging needs every
+	 * free to go through the node lists, so no cpu partials then.
+	 */
+	if (kmem_cache_debug(s))
+		s->cpu_partial = 0;
+	else if (s->size >= PAGE_SIZE)
+		s->cpu_partial = 2;
+	else if (s->size >= 1024)
+		s->cpu_partial = 6;
+	else if (s->size >= 256)
+		s->cpu_partial = 13;
+	else
+		s->cpu_partial = 30;
+
 	s->refcount = 1;
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
@@ -4147,6 +4279,29 @@ static ssize_t min_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(min_partial);
 
+static ssize_t cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	return sprintf(buf, "%d\n", s->cpu_partial);
+}
+
+static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
+				 size_t length)
+{
+	unsigned long objects;
+	int err;
+
+	err = strict_strtoul(buf, 10, &objects);
+	if (err)
+		return err;
+	if (objects && kmem_cache_debug(s))
+		return -EINVAL;
+
+	s->cpu_partial = objects;
+	flush_all(s);
+	return length;
+}
+SLAB_ATTR(cpu_partial);
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -4185,6 +4340,36 @@ static ssize_t objects_partial_show(struct kmem_cache *s, char *buf)
 }
 SLAB_ATTR_RO(objects_partial);
 
+static ssize_t slabs_cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	int objects = 0;
+	int pages = 0;
+	int cpu;
+	int len;
+
+	for_each_online_cpu(cpu) {
+		struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
+
+		pages += ACCESS_ONCE(c->partial_pages);
+		objects += ACCESS_ONCE(c->partial_objects);
+	}
+
+	len = sprintf(buf, "%d(%d)", objects, pages);
+
+#ifdef CONFIG_SMP
+	for_each_online_cpu(cpu) {
+		struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
+
+		pages = ACCESS_ONCE(c->partial_pages);
+		if (pages && len < PAGE_SIZE - 20)
+			len += sprintf(buf + len, " C%d=%d(%d)", cpu,
+				       ACCESS_ONCE(c->partial_objects), pages);
+	}
+#endif
+	return len + sprintf(buf + len, "\n");
+}
+SLAB_ATTR_RO(slabs_cpu_partial);
+
 static ssize_t reclaim_account_show(struct kmem_cache *s, char *buf)
 {
 	return sprintf(buf, "%d\n", !!(s->flags & SLAB_RECLAIM_ACCOUNT));
@@ -4493,6 +4678,10 @@ STAT_ATTR(DEACTIVATE_TO_HEAD, deactivate_to_head);
 STAT_ATTR(DEACTIVATE_TO_TAIL, deactivate_to_tail);
 STAT_ATTR(DEACTIVATE_REMOTE_FREES, deactivate_remote_frees);
 STAT_ATTR(ORDER_FALLBACK, order_fallback);
+STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
+STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
+STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
+STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
 #endif
 
 static struct attribute *slab_attrs[] = {
@@ -4501,10 +4690,12 @@ static struct attribute *slab_attrs[] = {
 	&objs_per_slab_attr.attr,
 	&order_attr.attr,
 	&min_partial_attr.attr,
+	&cpu_partial_attr.attr,
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
 	&cpu_slabs_attr.attr,
+	&slabs_cpu_partial_attr.attr,
 	&ctor_attr.attr,
 	&aliases_attr.attr,
 	&align_attr.attr,
@@ -4550,6 +4741,10 @@ static struct attribute *slab_attrs[] = {
 	&deactivate_to_tail_attr.attr,
 	&deactivate_remote_frees_attr.attr,
 	&order_fallback_attr.attr,
+	&cpu_partial_alloc_attr.attr,
+	&cpu_partial_free_attr.attr,
+	&cpu_partial_node_attr.attr,
+	&cpu_partial_drain_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
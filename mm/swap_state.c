@@ -19,6 +19,7 @@
 #include <linux/pagevec.h>
 #include <linux/migrate.h>
 #include <linux/page_cgroup.h>
+#include <linux/blkdev.h>
 
 #include <asm/pgtable.h>
 
@@ -254,33 +255,75 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
 	}
 }
 
+/*
+ * VMA based swap readahead state, kept per VMA in swap_readahead_info:
+ * the address of the last swap fault, the last readahead window and the
+ * number of readahead hits since then.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* Start with a few hits, so a new VMA gets a small window */
+#define GET_SWAP_RA_VAL(vma)					\
+	(atomic_long_read(&(vma)->swap_readahead_info) ? : 4)
+
+/* Upper bound for the window, in pages, is 1 << SWAP_RA_ORDER_CEILING */
+#define SWAP_RA_ORDER_CEILING	3
+
+bool swap_vma_readahead __read_mostly = true;
+
 /*
  * Lookup a swap entry in the swap cache. A found page will be returned
  * unlocked and with its refcount incremented - we rely on the kernel
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
+ *
+ * @vma and @addr are the faulting VMA and address, if any: a readahead
+ * hit grows the readahead window of @vma.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
+			       unsigned long addr)
 {
 	struct page *page;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
+		int readahead = TestClearPageReadahead(page);
+
 		INC_CACHE_INFO(find_success);
+		if (vma) {
+			unsigned long ra_val = GET_SWAP_RA_VAL(vma);
+			unsigned long win = SWAP_RA_WIN(ra_val);
+			unsigned long hits = SWAP_RA_HITS(ra_val);
+
+			if (readahead)
+				hits = min(hits + 1, SWAP_RA_HITS_MAX);
+			atomic_long_set(&vma->swap_readahead_info,
+					SWAP_RA_VAL(addr, win, hits));
+		}
+		if (readahead)
+			count_vm_event(SWAP_RA_HIT);
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
 }
 
-/* 
- * Locate a page of swap in physical memory, reserving swap cache space
- * and reading the disk if it is not already cached.
- * A failure return means that either the page allocation failed or that
- * the swap entry is no longer in use.
- */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			bool readahead)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
@@ -334,6 +377,10 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 * Initiate read into locked page and return.
 			 */
 			lru_cache_add_anon(new_page);
+			if (readahead) {
+				SetPageReadahead(new_page);
+				count_vm_event(SWAP_RA);
+			}
 			swap_readpage(new_page);
 			return new_page;
 		}
@@ -352,6 +399,18 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+/*
+ * Locate a page of swap in physical memory, reserving swap cache space
+ * and reading the disk if it is not already cached.
+ * A failure return means that either the page allocation failed or that
+ * the swap entry is no longer in use.
+ */
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr, false);
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -398,3 +457,189 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+static unsigned int swapin_nr_pages(unsigned long prev_pfn, unsigned long pfn,
+				    unsigned int hits, unsigned int max_pages,
+				    unsigned int prev_win)
+{
+	unsigned int pages, last_ra;
+
+	/*
+	 * Grow the window with the readahead hits of the previous window,
+	 * rounded up to a power of two.
+	 */
+	pages = hits + 2;
+	if (pages == 2) {
+		/*
+		 * No hits to judge by, but do not get stuck without
+		 * readahead: keep going if the fault is next to the last one.
+		 */
+		if (pfn != prev_pfn + 1 && pfn != prev_pfn - 1)
+			pages = 1;
+	} else {
+		unsigned int roundup = 4;
+
+		while (roundup < pages)
+			roundup <<= 1;
+		pages = roundup;
+	}
+
+	if (pages > max_pages)
+		pages = max_pages;
+
+	/* Don't shrink the window too fast */
+	last_ra = prev_win / 2;
+	if (pages < last_ra)
+		pages = last_ra;
+
+	return pages;
+}
+
+/**
+ * swapin_vma_readahead - swap in pages in hope we need them soon
+ * @fentry: swap entry of the faulting page
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma the faulting address belongs to
+ * @addr: faulting address
+ * @pmd: pmd mapping the page table of @addr
+ *
+ * Returns the struct page for @fentry and @addr, after queueing swapin.
+ *
+ * Unlike swapin_readahead(), which reads the neighbours of the swap slot,
+ * this reads the swap entries of the ptes around @addr in @vma.  Those
+ * are much more likely to be used next when slots carry no locality, as
+ * with zram.  The window is sized from the readahead hits in @vma and
+ * points in the direction of the last fault.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swapin_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			pmd_t *pmd)
+{
+	pte_t ptes[1 << SWAP_RA_ORDER_CEILING];
+	struct blk_plug plug;
+	unsigned long ra_val, pfn, fpfn, start, end, left;
+	unsigned int max_win, hits, prev_win, win, i;
+	struct page *page;
+	pte_t *pte;
+
+	max_win = 1 << min_t(unsigned int, page_cluster, SWAP_RA_ORDER_CEILING);
+	if (max_win == 1)
+		goto skip;
+
+	fpfn = PFN_DOWN(addr);
+	ra_val = GET_SWAP_RA_VAL(vma);
+	pfn = PFN_DOWN(SWAP_RA_ADDR(ra_val));
+	prev_win = SWAP_RA_WIN(ra_val);
+	hits = SWAP_RA_HITS(ra_val);
+	win = swapin_nr_pages(pfn, fpfn, hits, max_win, prev_win);
+	atomic_long_set(&vma->swap_readahead_info, SWAP_RA_VAL(addr, win, 0));
+	if (win == 1)
+		goto skip;
+
+	/* Read ahead in the direction of the last fault */
+	if (fpfn == pfn + 1) {
+		start = fpfn;
+		end = fpfn + win;
+	} else if (pfn == fpfn + 1) {
+		start = fpfn - win + 1;
+		end = fpfn + 1;
+	} else {
+		left = (win - 1) / 2;
+		start = fpfn - left;
+		end = fpfn + win - left;
+	}
+	/* Stay within the VMA and the page table of the fault */
+	start = max3(start, PFN_DOWN(vma->vm_start), PFN_DOWN(addr & PMD_MASK));
+	end = min3(end, PFN_DOWN(vma->vm_end),
+		   PFN_DOWN((addr & PMD_MASK) + PMD_SIZE));
+	if (start >= end)
+		goto skip;
+
+	/* Copy the ptes, the page table may not stay mapped while we sleep */
+	pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (i = 0; i < end - start; i++)
+		ptes[i] = pte[i];
+	pte_unmap(pte);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < end - start; i++) {
+		swp_entry_t entry;
+
+		if (start + i == fpfn)
+			continue;
+		if (pte_none(ptes[i]) || pte_present(ptes[i]) ||
+		    pte_file(ptes[i]))
+			continue;
+		entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(entry)))
+			continue;
+		page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+					       true);
+		if (!page)
+			continue;
+		page_cache_release(page);
+	}
+	blk_finish_plug(&plug);
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+skip:
+	return read_swap_cache_async(fentry, gfp_mask, vma, addr);
+}
+
+#ifdef CONFIG_SYSFS
+static ssize_t vma_ra_enabled_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%s\n", swap_vma_readahead ? "true" : "false");
+}
+
+static ssize_t vma_ra_enabled_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	if (!strncmp(buf, "true", 4) || !strncmp(buf, "1", 1))
+		swap_vma_readahead = true;
+	else if (!strncmp(buf, "false", 5) || !strncmp(buf, "0", 1))
+		swap_vma_readahead = false;
+	else
+		return -EINVAL;
+
+	return count;
+}
+
+static struct kobj_attribute vma_ra_enabled_attr =
+	__ATTR(vma_ra_enabled, 0644, vma_ra_enabled_show,
+	       vma_ra_enabled_store);
+
+static struct attribute *swap_attrs[] = {
+	&vma_ra_enabled_attr.attr,
+	NULL,
+};
+
+static struct attribute_group swap_attr_group = {
+	.attrs = swap_attrs,
+};
+
+static int __init swap_init_sysfs(void)
+{
+	struct kobject *swap_kobj;
+	int err;
+
+	swap_kobj = kobject_create_and_add("swap", mm_kobj);
+	if (unlikely(!swap_kobj)) {
+		printk(KERN_ERR "swap: failed to create swap kobject\n");
+		return -ENOMEM;
+	}
+
+	err = sysfs_create_group(swap_kobj, &swap_attr_group);
+	if (err) {
+		printk(KERN_ERR "swap: failed to register swap group\n");
+		kobject_put(swap_kobj);
+		return err;
+	}
+
+	return 0;
+}
+subsys_initcall(swap_init_sysfs);
+#endif
@@ -43,6 +43,7 @@
 #include <linux/sysctl.h>
 #include <linux/oom.h>
 #include <linux/prefetch.h>
+#include <linux/ksm.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -108,6 +109,12 @@ struct scan_control {
 	/* Which cgroup do we reclaim from */
 	struct mem_cgroup *mem_cgroup;
 
+	/*
+	 * Reclaim pages regardless of their referenced state, for pages the
+	 * caller has already decided are cold (per-process reclaim).
+	 */
+	int ignore_references;
+
 	/*
 	 * Nodemask of nodes allowed by the caller. If NULL, all nodes
 	 * are scanned.
@@ -479,9 +486,11 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
 
 /*
  * Same as remove_mapping, but if the page is removed from the mapping, it
- * gets returned with a refcount of 0.
+ * gets returned with a refcount of 0.  A page cache page removed by reclaim
+ * leaves a shadow entry for workingset detection.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -530,6 +539,8 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		if (reclaimed && page_is_file_cache(page))
+			workingset_eviction(mapping, page);
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -553,7 +564,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -727,6 +738,11 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 	unsigned long nr_dirty = 0;
 	unsigned long nr_congested = 0;
 	unsigned long nr_reclaimed = 0;
+	unsigned long nr_lazyfreed = 0;
+	enum ttu_flags ttu = TTU_UNMAP;
+
+	if (sc->ignore_references)
+		ttu |= TTU_IGNORE_ACCESS;
 
 	cond_resched();
 
@@ -745,7 +761,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			goto keep;
 
 		VM_BUG_ON(PageActive(page));
-		VM_BUG_ON(page_zone(page) != zone);
+		VM_BUG_ON(zone && page_zone(page) != zone);
 
 		sc->nr_scanned++;
 
@@ -780,7 +796,10 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		references = page_check_references(page, sc);
+		if (sc->ignore_references)
+			references = PAGEREF_RECLAIM;
+		else
+			references = page_check_references(page, sc);
 		switch (references) {
 		case PAGEREF_ACTIVATE:
 			goto activate_locked;
@@ -791,6 +810,38 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			; /* try to reclaim the page below */
 		}
 
+		/*
+		 * Anonymous memory released with MADV_FREE has PG_swapbacked
+		 * cleared and can be discarded without any swap, unless it
+		 * was written to again.  try_to_unmap() checks for that: it
+		 * leaves such a page mapped and sets PG_swapbacked, and the
+		 * page is activated as normal anonymous memory.
+		 */
+		if (PageAnon(page) && !PageSwapBacked(page)) {
+			if (page_mapped(page)) {
+				switch (try_to_unmap(page, ttu | TTU_LZFREE)) {
+				case SWAP_FAIL:
+					goto activate_locked;
+				case SWAP_AGAIN:
+					goto keep_locked;
+				case SWAP_MLOCK:
+					goto cull_mlocked;
+				case SWAP_SUCCESS:
+					; /* try to free the page below */
+				}
+			}
+			/*
+			 * Only a speculative reference can have been taken
+			 * since: it does not write to the page, which is clean
+			 * and unmapped and is freed when reclaim sees it again.
+			 */
+			if (!page_freeze_refs(page, 1))
+				goto keep_locked;
+			__clear_page_locked(page);
+			nr_lazyfreed++;
+			goto free_it;
+		}
+
 		/*
 		 * Anonymous process memory has backing store?
 		 * Try to allocate it some swap space here.
@@ -810,7 +861,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		 * processes. Try to unmap it here.
 		 */
 		if (page_mapped(page) && mapping) {
-			switch (try_to_unmap(page, TTU_UNMAP)) {
+			switch (try_to_unmap(page, ttu)) {
 			case SWAP_FAIL:
 				goto activate_locked;
 			case SWAP_AGAIN:
@@ -901,7 +952,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		/*
@@ -952,13 +1003,15 @@ keep_lumpy:
 	 * back off and wait for congestion to clear because further reclaim
 	 * will encounter the same problem
 	 */
-	if (nr_dirty && nr_dirty == nr_congested && scanning_global_lru(sc))
+	if (nr_dirty && nr_dirty == nr_congested && scanning_global_lru(sc) &&
+	    zone)
 		zone_set_flag(zone, ZONE_CONGESTED);
 
 	free_page_list(&free_pages);
 
 	list_splice(&ret_pages, page_list);
 	count_vm_events(PGACTIVATE, pgactivate);
+	count_vm_events(PGLAZYFREED, nr_lazyfreed);
 	return nr_reclaimed;
 }
 
@@ -1112,6 +1165,7 @@ static unsigned long isolate_lru_pages(unsigned long nr_to_scan,
 			 * pointless.
 			 */
 			if (nr_swap_pages <= 0 && PageAnon(cursor_page) &&
+			    PageSwapBacked(cursor_page) &&
 			    !PageSwapCache(cursor_page))
 				break;
 
@@ -2662,7 +2716,8 @@ out:
 	return order;
 }
 
-static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
+static void kswapd_try_to_sleep(pg_data_t *pgdat, int alloc_order, int order,
+				int classzone_idx)
 {
 	long remaining = 0;
 	DEFINE_WAIT(wait);
@@ -2695,6 +2750,14 @@ static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
 		 * them before going back to sleep.
 		 */
 		set_pgdat_percpu_threshold(pgdat, calculate_normal_threshold);
+
+		/*
+		 * Reclaim may have given up on the order it was woken for.
+		 * Compact in the background before the next such allocation
+		 * has to stall in direct compaction.
+		 */
+		wakeup_kcompactd(pgdat, alloc_order, classzone_idx);
+
 		schedule();
 		set_pgdat_percpu_threshold(pgdat, calculate_pressure_threshold);
 	} else {
@@ -2721,7 +2784,7 @@ static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
  */
 static int kswapd(void *p)
 {
-	unsigned long order, new_order;
+	unsigned long order, new_order, alloc_order;
 	int classzone_idx, new_classzone_idx;
 	pg_data_t *pgdat = (pg_data_t*)p;
 	struct task_struct *tsk = current;
@@ -2752,7 +2815,7 @@ static int kswapd(void *p)
 	tsk->flags |= PF_MEMALLOC | PF_SWAPWRITE | PF_KSWAPD;
 	set_freezable();
 
-	order = new_order = 0;
+	order = new_order = alloc_order = 0;
 	classzone_idx = new_classzone_idx = pgdat->nr_zones - 1;
 	for ( ; ; ) {
 		int ret;
@@ -2777,7 +2840,8 @@ static int kswapd(void *p)
 			order = new_order;
 			classzone_idx = new_classzone_idx;
 		} else {
-			kswapd_try_to_sleep(pgdat, order, classzone_idx);
+			kswapd_try_to_sleep(pgdat, alloc_order, order,
+					    classzone_idx);
 			order = pgdat->kswapd_max_order;
 			classzone_idx = pgdat->classzone_idx;
 			pgdat->kswapd_max_order = 0;
@@ -2794,6 +2858,7 @@ static int kswapd(void *p)
 		 */
 		if (!ret) {
 			trace_mm_vmscan_kswapd_wake(pgdat->node_id, order);
+			alloc_order = order;
 			order = balance_pgdat(pgdat, order, &classzone_idx);
 		}
 	}
@@ -2905,6 +2970,43 @@ unsigned long shrink_all_memory(unsigned long nr_to_reclaim)
 }
 #endif /* CONFIG_HIBERNATION */
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/*
+ * Reclaim a list of pages isolated by the caller, regardless of how
+ * recently they were referenced.  Pages that cannot be reclaimed are put
+ * back on the LRU.  The caller accounts NR_ISOLATED_* for the whole list.
+ * Returns the number of pages freed.
+ */
+unsigned long reclaim_pages_from_list(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+		.swappiness = vm_swappiness,
+		.ignore_references = 1,
+	};
+	unsigned long nr_reclaimed;
+	struct page *page;
+
+	list_for_each_entry(page, page_list, lru)
+		ClearPageActive(page);
+
+	nr_reclaimed = shrink_page_list(page_list, NULL, &sc);
+	count_vm_events(PGSCAN_PROCESS, sc.nr_scanned);
+	count_vm_events(PGSTEAL_PROCESS, nr_reclaimed);
+
+	while (!list_empty(page_list)) {
+		page = lru_to_page(page_list);
+		list_del(&page->lru);
+		putback_lru_page(page);
+	}
+
+	return nr_reclaimed;
+}
+#endif /* CONFIG_PROCESS_RECLAIM */
+
 /* It's optimal to keep kswapds on the same CPUs as their memory, but
    not required for correctness.  So if the last cpu in a node goes
    away, we get changed to run anywhere: as the first one comes back,
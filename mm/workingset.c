@@ -0,0 +1,188 @@
+/*
+ * Workingset detection
+ *
+ * When a page cache page is reclaimed, a shadow entry recording the
+ * eviction time is kept; when the page is faulted back in, the shadow
+ * tells how long it has been gone.
+ *
+ * Every zone keeps a counter, inactive_age, that is bumped on each
+ * eviction from and each activation out of the inactive file list.  The
+ * difference between the counter at refault time and the value stored
+ * in the shadow is the refault distance: the number of inactive list
+ * slots that were consumed while the page was out of memory.  Had the
+ * inactive list been larger by that many pages, the page would still be
+ * resident.  Those slots can only come from the active list, so a page
+ * whose refault distance is smaller than the active file list is part
+ * of the working set and is activated right away, making it compete
+ * with the active pages instead of being thrashed out again by a
+ * streaming read.
+ *
+ * Shadows are kept in a set-associative hash table indexed by mapping
+ * and page index, sized to cover about half of memory.  The table is
+ * only a hint: entries are not removed on truncation, may be replaced
+ * by later evictions and are updated without locking, so a racing
+ * update can at worst lose a shadow or misjudge a single refault.
+ */
+
+#include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/bootmem.h>
+#include <linux/vmstat.h>
+
+#define SHADOW_WAYS	4
+
+struct shadow_entry {
+	u32 key;		/* hash of mapping and index, 0 if unused */
+	u32 eviction;		/* packed zone and inactive_age */
+};
+
+struct shadow_bucket {
+	struct shadow_entry entry[SHADOW_WAYS];
+};
+
+static struct shadow_bucket *shadow_table __read_mostly;
+static unsigned int shadow_hash_shift __read_mostly;
+
+#define EVICTION_SHIFT	(NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK	(~0U >> EVICTION_SHIFT)
+
+static u32 pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	return eviction;
+}
+
+static struct zone *unpack_shadow(u32 eviction, unsigned long *distance)
+{
+	unsigned long age;
+	int zid, nid;
+	struct zone *zone;
+
+	zid = eviction & ((1U << ZONES_SHIFT) - 1);
+	eviction >>= ZONES_SHIFT;
+	nid = eviction & ((1U << NODES_SHIFT) - 1);
+	eviction >>= NODES_SHIFT;
+	zone = NODE_DATA(nid)->node_zones + zid;
+
+	age = atomic_long_read(&zone->inactive_age);
+	*distance = (age - eviction) & EVICTION_MASK;
+	return zone;
+}
+
+static struct shadow_bucket *shadow_lookup(struct address_space *mapping,
+					   pgoff_t index, u32 *key)
+{
+	unsigned long hash = (unsigned long)mapping + index;
+
+	*key = hash_32((u32)index ^ hash_ptr(mapping, 32), 32) | 1;
+	return &shadow_table[hash_long(hash, shadow_hash_shift)];
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Called with the page locked, frozen and still in @mapping.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	struct shadow_bucket *bucket;
+	unsigned long eviction;
+	u32 key;
+	int i;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	if (!shadow_table)
+		return;
+
+	bucket = shadow_lookup(mapping, page->index, &key);
+	for (i = 0; i < SHADOW_WAYS; i++) {
+		u32 old = ACCESS_ONCE(bucket->entry[i].key);
+
+		if (!old || old == key)
+			break;
+	}
+	/* No free way, replace a pseudo-random one */
+	if (i == SHADOW_WAYS)
+		i = eviction & (SHADOW_WAYS - 1);
+
+	bucket->entry[i].eviction = pack_shadow(eviction, zone);
+	smp_wmb();
+	bucket->entry[i].key = key;
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @mapping: address space the page is added to
+ * @index: index of the page in @mapping
+ *
+ * Consumes the shadow entry of the page, if there is one.  Returns %true
+ * if the page should be activated because it would have stayed resident
+ * with an inactive list larger by the size of the active list.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct shadow_bucket *bucket;
+	unsigned long distance;
+	struct zone *zone;
+	u32 key, eviction;
+	int i;
+
+	if (!shadow_table)
+		return false;
+
+	bucket = shadow_lookup(mapping, index, &key);
+	for (i = 0; i < SHADOW_WAYS; i++) {
+		if (ACCESS_ONCE(bucket->entry[i].key) == key)
+			break;
+	}
+	if (i == SHADOW_WAYS)
+		return false;
+
+	smp_rmb();
+	eviction = ACCESS_ONCE(bucket->entry[i].eviction);
+	bucket->entry[i].key = 0;
+
+	zone = unpack_shadow(eviction, &distance);
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	struct shadow_bucket *table;
+	unsigned long buckets;
+
+	buckets = max(totalram_pages / (2 * SHADOW_WAYS), 1UL);
+	table = alloc_large_system_hash("Workingset shadow",
+					sizeof(struct shadow_bucket),
+					buckets, 0, 0,
+					&shadow_hash_shift, NULL, 0);
+	memset(table, 0, sizeof(*table) << shadow_hash_shift);
+
+	smp_wmb();
+	shadow_table = table;
+	return 0;
+}
+module_init(workingset_init);
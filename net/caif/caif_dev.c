@@ -20,6 +20,7 @@
 #include <net/netns/generic.h>
 #include <net/net_namespace.h>
 #include <net/pkt_sched.h>
+#include <net/sock.h>
 #include <net/caif/caif_device.h>
 #include <net/caif/caif_layer.h>
 #include <net/caif/cfpkt.h>
@@ -134,6 +135,58 @@ static int transmit(struct cflayer *layer, struct cfpkt *pkt)
 	return err;
 }
 
+/*
+ * Links with serial framing carry a byte stream that the other end splits
+ * into frames again, so a batch of frames is sent as one skb of up to the
+ * device MTU: one pass through the qdisc and one driver write instead of
+ * one per frame.
+ */
+static int transmit_list(struct cflayer *layer, struct cfpktq *pktq)
+{
+	struct caif_device_entry *caifd =
+	    container_of(layer, struct caif_device_entry, layer);
+	struct net_device *dev = caifd->netdev;
+	struct sk_buff *skb, *agg = NULL;
+	struct cfpkt *pkt;
+	int ret = 0, err;
+
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		skb = cfpkt_tonative(pkt);
+		if (agg != NULL && agg->len + skb->len <= dev->mtu) {
+			skb_copy_bits(skb, 0, skb_put(agg, skb->len), skb->len);
+			kfree_skb(skb);
+			continue;
+		}
+		if (agg != NULL) {
+			err = transmit(layer, cfpkt_fromnative(CAIF_DIR_OUT, agg));
+			if (err < 0 && ret == 0)
+				ret = err;
+			agg = NULL;
+		}
+		if (cfpktq_len(pktq) && skb->len < dev->mtu)
+			agg = alloc_skb(dev->mtu + LL_RESERVED_SPACE(dev),
+					GFP_ATOMIC);
+		if (agg == NULL) {
+			err = transmit(layer, pkt);
+			if (err < 0 && ret == 0)
+				ret = err;
+			continue;
+		}
+		skb_reserve(agg, LL_RESERVED_SPACE(dev));
+		agg->priority = skb->priority;
+		if (skb->sk)
+			skb_set_owner_w(agg, skb->sk);
+		skb_copy_bits(skb, 0, skb_put(agg, skb->len), skb->len);
+		kfree_skb(skb);
+	}
+	if (agg != NULL) {
+		err = transmit(layer, cfpkt_fromnative(CAIF_DIR_OUT, agg));
+		if (err < 0 && ret == 0)
+			ret = err;
+	}
+	return ret;
+}
+
 /*
  * Stuff received packets into the CAIF stack.
  * On error, returns non-zero and releases the skb.
@@ -232,9 +285,10 @@ static int caif_device_notify(struct notifier_block *me, unsigned long what,
 
 		caifd->layer.transmit = transmit;
 
-		if (caifdev->use_frag)
+		if (caifdev->use_frag) {
 			phy_type = CFPHYTYPE_FRAG;
-		else
+			caifd->layer.transmit_list = transmit_list;
+		} else
 			phy_type = CFPHYTYPE_CAIF;
 
 		switch (caifdev->link_select) {
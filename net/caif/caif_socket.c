@@ -621,6 +621,29 @@ err:
  * Changed removed permission handling and added waiting for flow on
  * and other minor adaptations.
  */
+static int transmit_pktq(struct cfpktq *pktq, struct caifsock *cf_sk,
+			 int *sent, int *queued)
+{
+	int err;
+
+	if (cf_sk->layer.dn == NULL) {
+		cfpktq_purge(pktq);
+		*queued = 0;
+		return -EINVAL;
+	}
+
+	/*
+	 * The stack takes every chunk of the batch and only reports the
+	 * first error, the chunks around a failing one still go out. Count
+	 * them as sent so that a partial failure returns the bytes already
+	 * passed down, as sending chunk by chunk did.
+	 */
+	err = caif_transmit_list(cf_sk->layer.dn, pktq);
+	*sent += *queued;
+	*queued = 0;
+	return err;
+}
+
 static int caif_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 				struct msghdr *msg, size_t len)
 {
@@ -628,7 +651,9 @@ static int caif_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 	struct caifsock *cf_sk = container_of(sk, struct caifsock, sk);
 	int err, size;
 	struct sk_buff *skb;
+	struct cfpktq pktq;
 	int sent = 0;
+	int queued = 0;
 	long timeo;
 
 	err = -EOPNOTSUPP;
@@ -644,9 +669,11 @@ static int caif_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 	if (unlikely(sk->sk_shutdown & SEND_SHUTDOWN))
 		goto pipe_err;
 
-	while (sent < len) {
+	cfpktq_init(&pktq);
+	err = 0;
+	while (sent + queued < len) {
 
-		size = len-sent;
+		size = len - sent - queued;
 
 		if (size > cf_sk->maxframe)
 			size = cf_sk->maxframe;
@@ -658,13 +685,25 @@ static int caif_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 		if (size > SKB_MAX_ALLOC)
 			size = SKB_MAX_ALLOC;
 
+		/*
+		 * The chunks are passed down as one batch, but never wait
+		 * for send buffer space while holding on to queued chunks:
+		 * send those first.
+		 */
 		skb = sock_alloc_send_skb(sk,
 					size + cf_sk->headroom +
 					cf_sk->tailroom,
-					msg->msg_flags&MSG_DONTWAIT,
+					(msg->msg_flags&MSG_DONTWAIT) ||
+					cfpktq_len(&pktq),
 					&err);
-		if (skb == NULL)
-			goto out_err;
+		if (skb == NULL) {
+			if (!cfpktq_len(&pktq))
+				goto out_err;
+			err = transmit_pktq(&pktq, cf_sk, &sent, &queued);
+			if (err < 0)
+				goto pipe_err;
+			continue;
+		}
 
 		skb_reserve(skb, cf_sk->headroom);
 		/*
@@ -679,16 +718,19 @@ static int caif_stream_sendmsg(struct kiocb *kiocb, struct socket *sock,
 		err = memcpy_fromiovec(skb_put(skb, size), msg->msg_iov, size);
 		if (err) {
 			kfree_skb(skb);
-			goto out_err;
+			break;
 		}
-		err = transmit_skb(skb, cf_sk,
-				msg->msg_flags&MSG_DONTWAIT, timeo);
-		if (err < 0) {
-			kfree_skb(skb);
+		memset(skb->cb, 0, sizeof(struct caif_payload_info));
+		cfpktq_enqueue(&pktq, cfpkt_fromnative(CAIF_DIR_OUT, skb));
+		queued += size;
+	}
+
+	if (cfpktq_len(&pktq)) {
+		if (transmit_pktq(&pktq, cf_sk, &sent, &queued) < 0)
 			goto pipe_err;
-		}
-		sent += size;
 	}
+	if (err)
+		goto out_err;
 
 	return sent;
 
@@ -27,6 +27,8 @@ struct cffrml {
 
 static int cffrml_receive(struct cflayer *layr, struct cfpkt *pkt);
 static int cffrml_transmit(struct cflayer *layr, struct cfpkt *pkt);
+static int cffrml_receive_list(struct cflayer *layr, struct cfpktq *pktq);
+static int cffrml_transmit_list(struct cflayer *layr, struct cfpktq *pktq);
 static void cffrml_ctrlcmd(struct cflayer *layr, enum caif_ctrlcmd ctrl,
 				int phyid);
 
@@ -47,6 +49,8 @@ struct cflayer *cffrml_create(u16 phyid, bool use_fcs)
 
 	this->layer.receive = cffrml_receive;
 	this->layer.transmit = cffrml_transmit;
+	this->layer.receive_list = cffrml_receive_list;
+	this->layer.transmit_list = cffrml_transmit_list;
 	this->layer.ctrlcmd = cffrml_ctrlcmd;
 	snprintf(this->layer.name, CAIF_LAYER_NAME_SZ, "frm%d", phyid);
 	this->dofcs = use_fcs;
@@ -79,14 +83,17 @@ static u16 cffrml_checksum(u16 chks, void *buf, u16 len)
 	return crc_ccitt(chks, buf, len);
 }
 
-static int cffrml_receive(struct cflayer *layr, struct cfpkt *pkt)
+/*
+ * Strip the framing off a received packet.  On error the packet is
+ * destroyed, except for -EILSEQ (checksum error) where it is left to the
+ * caller.
+ */
+static int cffrml_unframe(struct cffrml *this, struct cfpkt *pkt)
 {
 	u16 tmp;
 	u16 len;
 	u16 hdrchks;
 	u16 pktchks;
-	struct cffrml *this;
-	this = container_obj(layr);
 
 	cfpkt_extr_head(pkt, &tmp, 2);
 	len = le16_to_cpu(tmp);
@@ -124,6 +131,16 @@ static int cffrml_receive(struct cflayer *layr, struct cfpkt *pkt)
 		cfpkt_destroy(pkt);
 		return -EPROTO;
 	}
+	return 0;
+}
+
+static int cffrml_receive(struct cflayer *layr, struct cfpkt *pkt)
+{
+	int ret;
+
+	ret = cffrml_unframe(container_obj(layr), pkt);
+	if (ret < 0)
+		return ret;
 
 	if (layr->up == NULL) {
 		pr_err("Layr up is missing!\n");
@@ -134,12 +151,46 @@ static int cffrml_receive(struct cflayer *layr, struct cfpkt *pkt)
 	return layr->up->receive(layr->up, pkt);
 }
 
-static int cffrml_transmit(struct cflayer *layr, struct cfpkt *pkt)
+static int cffrml_receive_list(struct cflayer *layr, struct cfpktq *pktq)
+{
+	struct cffrml *this = container_obj(layr);
+	struct cfpktq frames;
+	struct cfpkt *pkt;
+	int ret = 0, err;
+
+	if (layr->up == NULL) {
+		pr_err("Layr up is missing!\n");
+		cfpktq_purge(pktq);
+		return -EINVAL;
+	}
+
+	cfpktq_init(&frames);
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		err = cffrml_unframe(this, pkt);
+		if (err == -EILSEQ) {
+			/* The list owns the frame, no -EILSEQ exception */
+			cfpkt_destroy(pkt);
+			err = -EPROTO;
+		}
+		if (err < 0) {
+			if (ret == 0)
+				ret = err;
+			continue;
+		}
+		cfpktq_enqueue(&frames, pkt);
+	}
+
+	err = caif_receive_list(layr->up, &frames);
+	return ret < 0 ? ret : err;
+}
+
+/* Add the framing to a packet to transmit, destroying it on error. */
+static int cffrml_frame(struct cffrml *this, struct cfpkt *pkt)
 {
 	int tmp;
 	u16 chks;
 	u16 len;
-	struct cffrml *this = container_obj(layr);
+
 	if (this->dofcs) {
 		chks = cfpkt_iterate(pkt, cffrml_checksum, 0xffff);
 		tmp = cpu_to_le16(chks);
@@ -156,6 +207,16 @@ static int cffrml_transmit(struct cflayer *layr, struct cfpkt *pkt)
 		cfpkt_destroy(pkt);
 		return -EPROTO;
 	}
+	return 0;
+}
+
+static int cffrml_transmit(struct cflayer *layr, struct cfpkt *pkt)
+{
+	int ret;
+
+	ret = cffrml_frame(container_obj(layr), pkt);
+	if (ret < 0)
+		return ret;
 
 	if (layr->dn == NULL) {
 		cfpkt_destroy(pkt);
@@ -165,6 +226,33 @@ static int cffrml_transmit(struct cflayer *layr, struct cfpkt *pkt)
 	return layr->dn->transmit(layr->dn, pkt);
 }
 
+static int cffrml_transmit_list(struct cflayer *layr, struct cfpktq *pktq)
+{
+	struct cffrml *this = container_obj(layr);
+	struct cfpktq frames;
+	struct cfpkt *pkt;
+	int ret = 0, err;
+
+	if (layr->dn == NULL) {
+		cfpktq_purge(pktq);
+		return -ENODEV;
+	}
+
+	cfpktq_init(&frames);
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		err = cffrml_frame(this, pkt);
+		if (err < 0) {
+			if (ret == 0)
+				ret = err;
+			continue;
+		}
+		cfpktq_enqueue(&frames, pkt);
+	}
+
+	err = caif_transmit_list(layr->dn, &frames);
+	return ret < 0 ? ret : err;
+}
+
 static void cffrml_ctrlcmd(struct cflayer *layr, enum caif_ctrlcmd ctrl,
 					int phyid)
 {
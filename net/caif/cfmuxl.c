@@ -41,6 +41,8 @@ struct cfmuxl {
 
 static int cfmuxl_receive(struct cflayer *layr, struct cfpkt *pkt);
 static int cfmuxl_transmit(struct cflayer *layr, struct cfpkt *pkt);
+static int cfmuxl_receive_list(struct cflayer *layr, struct cfpktq *pktq);
+static int cfmuxl_transmit_list(struct cflayer *layr, struct cfpktq *pktq);
 static void cfmuxl_ctrlcmd(struct cflayer *layr, enum caif_ctrlcmd ctrl,
 				int phyid);
 static struct cflayer *get_up(struct cfmuxl *muxl, u16 id);
@@ -53,6 +55,8 @@ struct cflayer *cfmuxl_create(void)
 	memset(this, 0, sizeof(*this));
 	this->layer.receive = cfmuxl_receive;
 	this->layer.transmit = cfmuxl_transmit;
+	this->layer.receive_list = cfmuxl_receive_list;
+	this->layer.transmit_list = cfmuxl_transmit_list;
 	this->layer.ctrlcmd = cfmuxl_ctrlcmd;
 	INIT_LIST_HEAD(&this->srvl_list);
 	INIT_LIST_HEAD(&this->frml_list);
@@ -243,6 +247,121 @@ static int cfmuxl_transmit(struct cflayer *layr, struct cfpkt *pkt)
 	return err;
 }
 
+/* Pass a run of packets for the same link ID to its service layer */
+static int cfmuxl_receive_run(struct cfmuxl *muxl, u8 id, struct cfpktq *run)
+{
+	struct cflayer *up;
+	int ret;
+
+	rcu_read_lock();
+	up = get_up(muxl, id);
+	if (up == NULL) {
+		pr_debug("Received data on unknown link ID = %d (0x%x)"
+			" up == NULL", id, id);
+		rcu_read_unlock();
+		cfpktq_purge(run);
+		/* Not an error, see cfmuxl_receive() */
+		return 0;
+	}
+	cfsrvl_get(up);
+	rcu_read_unlock();
+
+	ret = caif_receive_list(up, run);
+
+	cfsrvl_put(up);
+	return ret;
+}
+
+static int cfmuxl_receive_list(struct cflayer *layr, struct cfpktq *pktq)
+{
+	struct cfmuxl *muxl = container_obj(layr);
+	struct cfpktq run;
+	struct cfpkt *pkt;
+	u8 id, run_id = 0;
+	int ret = 0, err;
+
+	cfpktq_init(&run);
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		if (cfpkt_extr_head(pkt, &id, 1) < 0) {
+			pr_err("erroneous Caif Packet\n");
+			cfpkt_destroy(pkt);
+			if (ret == 0)
+				ret = -EPROTO;
+			continue;
+		}
+		if (cfpktq_len(&run) && id != run_id) {
+			err = cfmuxl_receive_run(muxl, run_id, &run);
+			if (err < 0 && ret == 0)
+				ret = err;
+		}
+		run_id = id;
+		cfpktq_enqueue(&run, pkt);
+	}
+	if (cfpktq_len(&run)) {
+		err = cfmuxl_receive_run(muxl, run_id, &run);
+		if (err < 0 && ret == 0)
+			ret = err;
+	}
+	return ret;
+}
+
+/* Pass a run of packets for the same physical interface down to it */
+static int cfmuxl_transmit_run(struct cfmuxl *muxl, struct dev_info *dev_info,
+			       struct cfpktq *run)
+{
+	struct cflayer *dn;
+	int err;
+
+	rcu_read_lock();
+	dn = get_dn(muxl, dev_info);
+	if (dn == NULL) {
+		pr_debug("Send data on unknown phy ID = %d (0x%x)\n",
+			dev_info->id, dev_info->id);
+		rcu_read_unlock();
+		cfpktq_purge(run);
+		return -ENOTCONN;
+	}
+	cffrml_hold(dn);
+	rcu_read_unlock();
+
+	err = caif_transmit_list(dn, run);
+
+	cffrml_put(dn);
+	return err;
+}
+
+static int cfmuxl_transmit_list(struct cflayer *layr, struct cfpktq *pktq)
+{
+	struct cfmuxl *muxl = container_obj(layr);
+	struct dev_info *run_dev = NULL;
+	struct caif_payload_info *info;
+	struct cfpktq run;
+	struct cfpkt *pkt;
+	int ret = 0, err;
+	u8 linkid;
+
+	cfpktq_init(&run);
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		info = cfpkt_info(pkt);
+		if (cfpktq_len(&run) && info->dev_info->id != run_dev->id) {
+			err = cfmuxl_transmit_run(muxl, run_dev, &run);
+			if (err < 0 && ret == 0)
+				ret = err;
+		}
+		info->hdr_len += 1;
+		linkid = info->channel_id;
+		cfpkt_add_head(pkt, &linkid, 1);
+		run_dev = info->dev_info;
+		cfpktq_enqueue(&run, pkt);
+	}
+	if (cfpktq_len(&run)) {
+		err = cfmuxl_transmit_run(muxl, run_dev, &run);
+		if (err < 0 && ret == 0)
+			ret = err;
+	}
+	return ret;
+}
+
 static void cfmuxl_ctrlcmd(struct cflayer *layr, enum caif_ctrlcmd ctrl,
 				int phyid)
 {
@@ -21,13 +21,6 @@ do {					   \
 	pr_warn(errmsg);		   \
 } while (0)
 
-struct cfpktq {
-	struct sk_buff_head head;
-	atomic_t count;
-	/* Lock protects count updates */
-	spinlock_t lock;
-};
-
 /*
  * net/caif/ is generic and does not
  * understand SKB, so we do this typecast
@@ -232,19 +225,18 @@ inline int cfpkt_addbdy(struct cfpkt *pkt, u8 data)
 int cfpkt_add_head(struct cfpkt *pkt, const void *data2, u16 len)
 {
 	struct sk_buff *skb = pkt_to_skb(pkt);
-	struct sk_buff *lastskb;
 	u8 *to;
 	const u8 *data = data2;
 	int ret;
 	if (unlikely(is_erronous(pkt)))
 		return -EPROTO;
-	if (unlikely(skb_headroom(skb) < len)) {
-		PKT_ERROR(pkt, "no headroom\n");
-		return -EPROTO;
-	}
 
-	/* Make sure data is writable */
-	ret = skb_cow_data(skb, 0, &lastskb);
+	/*
+	 * Only the header area is written, so the payload is left alone.
+	 * Senders reserve enough headroom for the whole stack, so this
+	 * normally neither copies nor reallocates.
+	 */
+	ret = skb_cow_head(skb, len);
 	if (unlikely(ret < 0)) {
 		PKT_ERROR(pkt, "cow failed\n");
 		return ret;
@@ -330,8 +322,11 @@ struct cfpkt *cfpkt_append(struct cfpkt *dstpkt,
 	else
 		neededtailspace = addlen;
 
-	if (dst->tail + neededtailspace > dst->end) {
-		/* Create a dumplicate of 'dst' with more tail space */
+	if (dst->tail + neededtailspace > dst->end || skb_cloned(dst)) {
+		/*
+		 * Create a duplicate of 'dst' with more tail space, 'dst' may
+		 * also share its data with a clone, e.g. one held by a tap.
+		 */
 		struct cfpkt *tmppkt;
 		dstlen = skb_headlen(dst);
 		createlen = dstlen + neededtailspace;
@@ -389,6 +384,35 @@ struct cfpkt *cfpkt_split(struct cfpkt *pkt, u16 pos)
 	return skb_to_pkt(skb2);
 }
 
+struct cfpkt *cfpkt_split_head(struct cfpkt *pkt, u16 pos)
+{
+	struct sk_buff *skb2;
+	struct sk_buff *skb = pkt_to_skb(pkt);
+	struct cfpkt *tmppkt;
+
+	if (unlikely(is_erronous(pkt)))
+		return NULL;
+
+	if (skb->data + pos > skb_tail_pointer(skb)) {
+		PKT_ERROR(pkt, "trying to split beyond end of packet\n");
+		return NULL;
+	}
+
+	/*
+	 * Copy the head into a packet of its own size rather than cloning,
+	 * a clone would account the whole buffer to every frame in it.
+	 */
+	tmppkt = cfpkt_create_pfx(pos + PKT_PREFIX + PKT_POSTFIX, PKT_PREFIX);
+	if (tmppkt == NULL)
+		return NULL;
+	skb2 = pkt_to_skb(tmppkt);
+	memcpy(skb_put(skb2, pos), skb->data, pos);
+	*cfpkt_priv(tmppkt) = *cfpkt_priv(pkt);
+
+	skb_pull(skb, pos);
+	return tmppkt;
+}
+
 bool cfpkt_erroneous(struct cfpkt *pkt)
 {
 	return cfpkt_priv(pkt)->erronous;
@@ -398,3 +422,86 @@ struct caif_payload_info *cfpkt_info(struct cfpkt *pkt)
 {
 	return (struct caif_payload_info *)&pkt_to_skb(pkt)->cb;
 }
+
+void cfpktq_init(struct cfpktq *pktq)
+{
+	pktq->head = NULL;
+	pktq->tail = NULL;
+	pktq->qlen = 0;
+}
+EXPORT_SYMBOL(cfpktq_init);
+
+void cfpktq_enqueue(struct cfpktq *pktq, struct cfpkt *pkt)
+{
+	pkt_to_skb(pkt)->next = NULL;
+	if (pktq->tail)
+		pkt_to_skb(pktq->tail)->next = pkt_to_skb(pkt);
+	else
+		pktq->head = pkt;
+	pktq->tail = pkt;
+	pktq->qlen++;
+}
+EXPORT_SYMBOL(cfpktq_enqueue);
+
+struct cfpkt *cfpktq_dequeue(struct cfpktq *pktq)
+{
+	struct cfpkt *pkt = pktq->head;
+
+	if (pkt == NULL)
+		return NULL;
+	if (pkt_to_skb(pkt)->next)
+		pktq->head = skb_to_pkt(pkt_to_skb(pkt)->next);
+	else
+		pktq->head = pktq->tail = NULL;
+	pkt_to_skb(pkt)->next = NULL;
+	pktq->qlen--;
+	return pkt;
+}
+EXPORT_SYMBOL(cfpktq_dequeue);
+
+void cfpktq_purge(struct cfpktq *pktq)
+{
+	struct cfpkt *pkt;
+
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL)
+		cfpkt_destroy(pkt);
+}
+EXPORT_SYMBOL(cfpktq_purge);
+
+int caif_receive_list(struct cflayer *layr, struct cfpktq *pktq)
+{
+	struct cfpkt *pkt;
+	int ret = 0, err;
+
+	if (layr->receive_list)
+		return layr->receive_list(layr, pktq);
+
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		err = layr->receive(layr, pkt);
+		if (err == -EILSEQ) {
+			cfpkt_destroy(pkt);
+			err = -EPROTO;
+		}
+		if (err < 0 && ret >= 0)
+			ret = err;
+	}
+	return ret;
+}
+EXPORT_SYMBOL(caif_receive_list);
+
+int caif_transmit_list(struct cflayer *layr, struct cfpktq *pktq)
+{
+	struct cfpkt *pkt;
+	int ret = 0, err;
+
+	if (layr->transmit_list)
+		return layr->transmit_list(layr, pktq);
+
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		err = layr->transmit(layr, pkt);
+		if (err < 0 && ret >= 0)
+			ret = err;
+	}
+	return ret;
+}
+EXPORT_SYMBOL(caif_transmit_list);
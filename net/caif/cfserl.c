@@ -28,6 +28,7 @@ struct cfserl {
 
 static int cfserl_receive(struct cflayer *layr, struct cfpkt *pkt);
 static int cfserl_transmit(struct cflayer *layr, struct cfpkt *pkt);
+static int cfserl_transmit_list(struct cflayer *layr, struct cfpktq *pktq);
 static void cfserl_ctrlcmd(struct cflayer *layr, enum caif_ctrlcmd ctrl,
 				int phyid);
 
@@ -39,6 +40,7 @@ struct cflayer *cfserl_create(int type, int instance, bool use_stx)
 	caif_assert(offsetof(struct cfserl, layer) == 0);
 	this->layer.receive = cfserl_receive;
 	this->layer.transmit = cfserl_transmit;
+	this->layer.transmit_list = cfserl_transmit_list;
 	this->layer.ctrlcmd = cfserl_ctrlcmd;
 	this->layer.type = type;
 	this->usestx = use_stx;
@@ -56,10 +58,12 @@ static int cfserl_receive(struct cflayer *l, struct cfpkt *newpkt)
 	u8 tmp8;
 	u16 tmp;
 	u8 stx = CFSERL_STX;
-	int ret;
+	struct cfpktq frames;
+	int ret = 0, err;
 	u16 expectlen = 0;
 
 	caif_assert(newpkt != NULL);
+	cfpktq_init(&frames);
 	spin_lock(&layr->sync);
 
 	if (layr->incomplete_frm != NULL) {
@@ -87,8 +91,8 @@ static int cfserl_receive(struct cflayer *l, struct cfpkt *newpkt)
 				if (!cfpkt_more(pkt)) {
 					cfpkt_destroy(pkt);
 					layr->incomplete_frm = NULL;
-					spin_unlock(&layr->sync);
-					return -EPROTO;
+					ret = -EPROTO;
+					goto out;
 				}
 			}
 		}
@@ -105,8 +109,7 @@ static int cfserl_receive(struct cflayer *l, struct cfpkt *newpkt)
 			if (layr->usestx)
 				cfpkt_add_head(pkt, &stx, 1);
 			layr->incomplete_frm = pkt;
-			spin_unlock(&layr->sync);
-			return 0;
+			goto out;
 		}
 
 		/*
@@ -125,8 +128,8 @@ static int cfserl_receive(struct cflayer *l, struct cfpkt *newpkt)
 					cfpkt_destroy(pkt);
 				layr->incomplete_frm = NULL;
 				expectlen = 0;
-				spin_unlock(&layr->sync);
-				return -EPROTO;
+				ret = -EPROTO;
+				goto out;
 			}
 			continue;
 		}
@@ -136,41 +139,63 @@ static int cfserl_receive(struct cflayer *l, struct cfpkt *newpkt)
 			if (layr->usestx)
 				cfpkt_add_head(pkt, &stx, 1);
 			layr->incomplete_frm = pkt;
-			spin_unlock(&layr->sync);
-			return 0;
+			goto out;
 		}
 
 		/*
 		 * Enough data for at least one frame.
 		 * Split the frame, if too long
 		 */
-		if (pkt_len > expectlen)
-			tail_pkt = cfpkt_split(pkt, expectlen);
-		else
+		if (pkt_len > expectlen) {
+			tail_pkt = pkt;
+			pkt = cfpkt_split_head(tail_pkt, expectlen);
+			if (pkt == NULL) {
+				cfpkt_destroy(tail_pkt);
+				layr->incomplete_frm = NULL;
+				ret = -ENOMEM;
+				goto out;
+			}
+		} else
 			tail_pkt = NULL;
 
+		/*
+		 * Without STX a frame failing the checksum cannot be
+		 * resynchronized on, so collect the frames of the burst and
+		 * pass them up in one go.
+		 */
+		if (!layr->usestx) {
+			cfpktq_enqueue(&frames, pkt);
+			pkt = tail_pkt;
+			continue;
+		}
+
 		/* Send the first part of packet upwards.*/
 		spin_unlock(&layr->sync);
-		ret = layr->layer.up->receive(layr->layer.up, pkt);
+		err = layr->layer.up->receive(layr->layer.up, pkt);
 		spin_lock(&layr->sync);
-		if (ret == -EILSEQ) {
-			if (layr->usestx) {
-				if (tail_pkt != NULL)
-					pkt = cfpkt_append(pkt, tail_pkt, 0);
-				/* Start search for next STX if frame failed */
-				continue;
-			} else {
-				cfpkt_destroy(pkt);
-				pkt = NULL;
-			}
+		if (err == -EILSEQ) {
+			if (tail_pkt != NULL)
+				pkt = cfpkt_append(pkt, tail_pkt, 0);
+			/* Start search for next STX if frame failed */
+			continue;
 		}
 
 		pkt = tail_pkt;
 
 	} while (pkt != NULL);
 
+out:
 	spin_unlock(&layr->sync);
-	return 0;
+	if (cfpktq_len(&frames)) {
+		/*
+		 * The frames are owned by the list from here on, the caller
+		 * must not see -EILSEQ and free the burst a second time.
+		 */
+		err = caif_receive_list(layr->layer.up, &frames);
+		if (ret == 0 && err != -EILSEQ)
+			ret = err;
+	}
+	return ret;
 }
 
 static int cfserl_transmit(struct cflayer *layer, struct cfpkt *newpkt)
@@ -182,6 +207,24 @@ static int cfserl_transmit(struct cflayer *layer, struct cfpkt *newpkt)
 	return layer->dn->transmit(layer->dn, newpkt);
 }
 
+static int cfserl_transmit_list(struct cflayer *layer, struct cfpktq *pktq)
+{
+	struct cfserl *layr = container_obj(layer);
+	u8 tmp8 = CFSERL_STX;
+	struct cfpktq frames;
+	struct cfpkt *pkt;
+
+	if (!layr->usestx)
+		return caif_transmit_list(layer->dn, pktq);
+
+	cfpktq_init(&frames);
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		cfpkt_add_head(pkt, &tmp8, 1);
+		cfpktq_enqueue(&frames, pkt);
+	}
+	return caif_transmit_list(layer->dn, &frames);
+}
+
 static void cfserl_ctrlcmd(struct cflayer *layr, enum caif_ctrlcmd ctrl,
 				int phyid)
 {
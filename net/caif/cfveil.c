@@ -22,6 +22,7 @@
 
 static int cfvei_receive(struct cflayer *layr, struct cfpkt *pkt);
 static int cfvei_transmit(struct cflayer *layr, struct cfpkt *pkt);
+static int cfvei_transmit_list(struct cflayer *layr, struct cfpktq *pktq);
 
 struct cflayer *cfvei_create(u8 channel_id, struct dev_info *dev_info)
 {
@@ -32,6 +33,7 @@ struct cflayer *cfvei_create(u8 channel_id, struct dev_info *dev_info)
 	cfsrvl_init(vei, channel_id, dev_info, true);
 	vei->layer.receive = cfvei_receive;
 	vei->layer.transmit = cfvei_transmit;
+	vei->layer.transmit_list = cfvei_transmit_list;
 	snprintf(vei->layer.name, CAIF_LAYER_NAME_SZ - 1, "vei%d", channel_id);
 	return &vei->layer;
 }
@@ -72,21 +74,16 @@ static int cfvei_receive(struct cflayer *layr, struct cfpkt *pkt)
 	}
 }
 
-static int cfvei_transmit(struct cflayer *layr, struct cfpkt *pkt)
+/* Add the payload header and routing info, destroying the packet on error */
+static int cfvei_prepare(struct cfsrvl *service, struct cfpkt *pkt)
 {
 	u8 tmp = 0;
 	struct caif_payload_info *info;
-	int ret;
-	struct cfsrvl *service = container_obj(layr);
-	if (!cfsrvl_ready(service, &ret))
-		goto err;
-	caif_assert(layr->dn != NULL);
-	caif_assert(layr->dn->transmit != NULL);
 
 	if (cfpkt_add_head(pkt, &tmp, 1) < 0) {
 		pr_err("Packet is erroneous!\n");
-		ret = -EPROTO;
-		goto err;
+		cfpkt_destroy(pkt);
+		return -EPROTO;
 	}
 
 	/* Add info-> for MUX-layer to route the packet out. */
@@ -94,8 +91,50 @@ static int cfvei_transmit(struct cflayer *layr, struct cfpkt *pkt)
 	info->channel_id = service->layer.id;
 	info->hdr_len = 1;
 	info->dev_info = &service->dev_info;
+	return 0;
+}
+
+static int cfvei_transmit(struct cflayer *layr, struct cfpkt *pkt)
+{
+	int ret;
+	struct cfsrvl *service = container_obj(layr);
+	if (!cfsrvl_ready(service, &ret)) {
+		cfpkt_destroy(pkt);
+		return ret;
+	}
+	caif_assert(layr->dn != NULL);
+	caif_assert(layr->dn->transmit != NULL);
+
+	ret = cfvei_prepare(service, pkt);
+	if (ret < 0)
+		return ret;
 	return layr->dn->transmit(layr->dn, pkt);
-err:
-	cfpkt_destroy(pkt);
-	return ret;
+}
+
+static int cfvei_transmit_list(struct cflayer *layr, struct cfpktq *pktq)
+{
+	struct cfsrvl *service = container_obj(layr);
+	struct cfpktq payload;
+	struct cfpkt *pkt;
+	int ret = 0, err;
+
+	if (!cfsrvl_ready(service, &ret)) {
+		cfpktq_purge(pktq);
+		return ret;
+	}
+	caif_assert(layr->dn != NULL);
+
+	cfpktq_init(&payload);
+	while ((pkt = cfpktq_dequeue(pktq)) != NULL) {
+		err = cfvei_prepare(service, pkt);
+		if (err < 0) {
+			if (ret == 0)
+				ret = err;
+			continue;
+		}
+		cfpktq_enqueue(&payload, pkt);
+	}
+
+	err = caif_transmit_list(layr->dn, &payload);
+	return ret < 0 ? ret : err;
 }
@@ -1374,6 +1374,15 @@ void sock_rfree(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(sock_rfree);
 
+/*
+ * Destructor for the socket reference taken by early demux.
+ */
+void sock_edemux(struct sk_buff *skb)
+{
+	sock_put(skb->sk);
+}
+EXPORT_SYMBOL(sock_edemux);
+
 
 int sock_i_uid(struct sock *sk)
 {
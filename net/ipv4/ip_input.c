@@ -145,6 +145,8 @@
 #include <linux/mroute.h>
 #include <linux/netlink.h>
 
+int sysctl_ip_early_demux __read_mostly = 1;
+
 /*
  *	Process Router Attention IP option (RFC 2113)
  */
@@ -319,6 +321,23 @@ static int ip_rcv_finish(struct sk_buff *skb)
 	const struct iphdr *iph = ip_hdr(skb);
 	struct rtable *rt;
 
+	/*
+	 *	Let the transport protocol find the owning socket early; a
+	 *	connected socket may carry an input route that saves us the
+	 *	route cache hash walk below.
+	 */
+	if (sysctl_ip_early_demux && !skb_dst(skb)) {
+		const struct net_protocol *ipprot;
+
+		rcu_read_lock();
+		ipprot = rcu_dereference(inet_protos[iph->protocol]);
+		if (ipprot && ipprot->early_demux)
+			ipprot->early_demux(skb);
+		rcu_read_unlock();
+		/* early_demux may have pulled, reload the header pointer */
+		iph = ip_hdr(skb);
+	}
+
 	/*
 	 *	Initialise the virtual path cache for the packet. It describes
 	 *	how the packet travels inside Linux networking.
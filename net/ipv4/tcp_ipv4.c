@@ -1588,7 +1588,18 @@ int tcp_v4_do_rcv(struct sock *sk, struct sk_buff *skb)
 #endif
 
 	if (sk->sk_state == TCP_ESTABLISHED) { /* Fast path */
+		struct dst_entry *dst = sk->sk_rx_dst;
+
 		sock_rps_save_rxhash(sk, skb->rxhash);
+		if (dst) {
+			if (inet_sk(sk)->rx_dst_ifindex != skb->skb_iif ||
+			    dst->ops->check(dst, 0) == NULL) {
+				dst_release(dst);
+				sk->sk_rx_dst = NULL;
+			}
+		}
+		if (unlikely(sk->sk_rx_dst == NULL))
+			inet_sk_rx_dst_set(sk, skb);
 		if (tcp_rcv_established(sk, skb, tcp_hdr(skb), skb->len)) {
 			rsk = sk;
 			goto reset;
@@ -1638,6 +1649,57 @@ csum_err:
 }
 EXPORT_SYMBOL(tcp_v4_do_rcv);
 
+/*
+ * Look up the established socket of an incoming segment before the input
+ * route is resolved.  The socket reference travels with the skb and is
+ * picked up again by __inet_lookup_skb(); a still valid input route cached
+ * in the socket is attached so that ip_rcv_finish() skips the route cache.
+ */
+void tcp_v4_early_demux(struct sk_buff *skb)
+{
+	struct net *net = dev_net(skb->dev);
+	const struct iphdr *iph;
+	const struct tcphdr *th;
+	struct dst_entry *dst;
+	struct sock *sk;
+
+	if (skb->pkt_type != PACKET_HOST)
+		return;
+
+	if (!pskb_may_pull(skb, ip_hdrlen(skb) + sizeof(struct tcphdr)))
+		return;
+
+	iph = ip_hdr(skb);
+	if (iph->frag_off & htons(IP_MF | IP_OFFSET))
+		return;
+
+	th = (struct tcphdr *)((char *)iph + ip_hdrlen(skb));
+	if (th->doff < sizeof(struct tcphdr) / 4)
+		return;
+
+	sk = __inet_lookup_established(net, &tcp_hashinfo,
+				       iph->saddr, th->source,
+				       iph->daddr, ntohs(th->dest),
+				       skb->skb_iif);
+	if (!sk)
+		return;
+
+	if (sk->sk_state == TCP_TIME_WAIT) {
+		inet_twsk_put(inet_twsk(sk));
+		return;
+	}
+
+	skb->sk = sk;
+	skb->destructor = sock_edemux;
+
+	dst = ACCESS_ONCE(sk->sk_rx_dst);
+	if (dst && inet_sk(sk)->rx_dst_ifindex == skb->skb_iif &&
+	    dst->ops->check(dst, 0)) {
+		skb_dst_set_noref(skb, dst);
+		RT_CACHE_STAT_INC(in_early_demux);
+	}
+}
+
 /*
  *	From tcp_input.c
  */
@@ -0,0 +1,180 @@
+/*
+ * ion_alloc_bench.c
+ *
+ * Time ION_IOC_ALLOC and ION_IOC_FREE pairs against /dev/ion.  The
+ * default is a 1920x1080 32bpp frame from the system heap.
+ *
+ * Warm pools: the first -w rounds are not timed, so the timed rounds are
+ * served from the page pools.  Cold pools: with -c the shrinkers are run
+ * through /proc/sys/vm/drop_caches before every timed round, so each
+ * allocation goes to the page allocator.  The system heap frees buffers
+ * from a SCHED_IDLE thread; on a loaded system give it time to return
+ * the pages with -d.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/ion.h>
+
+#define MAX_ERRNO	4095
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const char *what, double *us, int n)
+{
+	double sum = 0;
+	int i;
+
+	qsort(us, n, sizeof(*us), cmp_double);
+	for (i = 0; i < n; i++)
+		sum += us[i];
+	printf("%-5s us: min %8.1f  median %8.1f  mean %8.1f  p99 %8.1f  max %8.1f\n",
+	       what, us[0], us[n / 2], sum / n, us[n * 99 / 100], us[n - 1]);
+}
+
+static void drop_caches(void)
+{
+	int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+
+	if (fd < 0 || write(fd, "3\n", 2) != 2) {
+		perror("/proc/sys/vm/drop_caches");
+		exit(1);
+	}
+	close(fd);
+}
+
+/* Returns the alloc time in us, or a negative errno */
+static double alloc_free(int fd, size_t len, unsigned int heap_mask,
+			 double *free_us)
+{
+	struct ion_allocation_data alloc = {
+		.len = len,
+		.align = 0,
+		.flags = heap_mask,
+	};
+	struct ion_handle_data handle;
+	double t0, t1, t2;
+
+	t0 = now_us();
+	if (ioctl(fd, ION_IOC_ALLOC, &alloc) < 0)
+		return -errno;
+	t1 = now_us();
+	/* Older kernels hand a failed allocation back as an ERR_PTR */
+	if ((unsigned long)alloc.handle >= (unsigned long)-MAX_ERRNO)
+		return (long)alloc.handle;
+
+	handle.handle = alloc.handle;
+	if (ioctl(fd, ION_IOC_FREE, &handle) < 0)
+		return -errno;
+	t2 = now_us();
+
+	*free_us = t2 - t1;
+	return t1 - t0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-n rounds] [-w warmup] [-s bytes] [-m heap_mask] [-d us] [-c]\n"
+		"  -n  timed rounds (1000)\n"
+		"  -w  untimed rounds before timing (10)\n"
+		"  -s  allocation size (1920*1080*4)\n"
+		"  -m  heap mask (system heap)\n"
+		"  -d  sleep between rounds, not timed (0)\n"
+		"  -c  drop caches before every timed round\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = 1000, warmup = 10, delay = 0, cold = 0;
+	unsigned int heap_mask = ION_HEAP_SYSTEM_MASK;
+	size_t len = 1920 * 1080 * 4;
+	double *alloc_us, *free_us, t;
+	int fd, opt, i;
+
+	while ((opt = getopt(argc, argv, "n:w:s:m:d:c")) != -1) {
+		switch (opt) {
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 'w':
+			warmup = atoi(optarg);
+			break;
+		case 's':
+			len = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			heap_mask = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			delay = atoi(optarg);
+			break;
+		case 'c':
+			cold = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (rounds <= 0 || warmup < 0 || delay < 0 || !len)
+		usage(argv[0]);
+
+	alloc_us = calloc(rounds, sizeof(*alloc_us));
+	free_us = calloc(rounds, sizeof(*free_us));
+	if (!alloc_us || !free_us) {
+		perror("calloc");
+		return 1;
+	}
+
+	fd = open("/dev/ion", O_RDONLY);
+	if (fd < 0) {
+		perror("/dev/ion");
+		return 1;
+	}
+
+	for (i = -warmup; i < rounds; i++) {
+		if (delay)
+			usleep(delay);
+		if (cold && i >= 0)
+			drop_caches();
+		t = alloc_free(fd, len, heap_mask, &free_us[i < 0 ? 0 : i]);
+		if (t < 0) {
+			fprintf(stderr, "round %d: %s\n", i, strerror(-t));
+			return 1;
+		}
+		if (i >= 0)
+			alloc_us[i] = t;
+	}
+
+	printf("%d rounds of %zu bytes, heap mask 0x%x, %s pools\n",
+	       rounds, len, heap_mask, cold ? "cold" : "warm");
+	report("alloc", alloc_us, rounds);
+	report("free", free_us, rounds);
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * Userspace test of lib/radix-tree.c
+ *
+ * Checks the gang lookups and the chunk iterators against a flat array
+ * model of the tree, then times the gang lookups over a dense tree.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2, or (at
+ * your option) any later version.
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include "shim.h"
+#include "radix-tree.h"
+
+#define CHECK_ITEMS	(1UL << 16)
+#define CHECK_ROUNDS	40
+#define CHECK_LOOKUPS	200
+#define CHECK_TAG	1
+
+#define BENCH_ITEMS	(1UL << 18)
+#define BENCH_GANG	16
+#define BENCH_PASSES	10
+#define BENCH_REPEAT	30
+
+static void *model[CHECK_ITEMS];
+static char model_tag[CHECK_ITEMS];
+
+/* Items are the index shifted past the indirect pointer bit */
+static void *item(unsigned long index)
+{
+	return (void *)((index << 2) | 4);
+}
+
+static unsigned long item_index(void *p)
+{
+	return (unsigned long)p >> 2;
+}
+
+static void check_lookups(struct radix_tree_root *root, unsigned long start,
+			  unsigned int max)
+{
+	void *res[128];
+	void **slots[128];
+	struct radix_tree_iter iter;
+	unsigned long i;
+	unsigned int n, e;
+	void **slot;
+
+	n = radix_tree_gang_lookup(root, res, start, max);
+	for (i = start, e = 0; i < CHECK_ITEMS && e < max; i++) {
+		if (!model[i])
+			continue;
+		assert(e < n && res[e] == model[i]);
+		e++;
+	}
+	assert(n == e);
+
+	n = radix_tree_gang_lookup_slot(root, slots, start, max);
+	assert(n == e);
+	while (n--)
+		assert(*slots[n] == res[n]);
+
+	n = radix_tree_gang_lookup_tag(root, res, start, max, CHECK_TAG);
+	for (i = start, e = 0; i < CHECK_ITEMS && e < max; i++) {
+		if (!model[i] || !model_tag[i])
+			continue;
+		assert(e < n && res[e] == model[i]);
+		e++;
+	}
+	assert(n == e);
+
+	n = radix_tree_gang_lookup_tag_slot(root, slots, start, max,
+					    CHECK_TAG);
+	assert(n == e);
+	while (n--)
+		assert(*slots[n] == res[n]);
+
+	i = start;
+	radix_tree_for_each_slot(slot, root, &iter, start) {
+		while (!model[i])
+			i++;
+		assert(iter.index == i && *slot == model[i]);
+		i++;
+	}
+	for (; i < CHECK_ITEMS; i++)
+		assert(!model[i]);
+
+	i = start;
+	radix_tree_for_each_contig(slot, root, &iter, start) {
+		assert(iter.index == i && *slot == model[i]);
+		i++;
+	}
+	assert(i >= CHECK_ITEMS || !model[i]);
+
+	i = start;
+	radix_tree_for_each_tagged(slot, root, &iter, start, CHECK_TAG) {
+		while (!model[i] || !model_tag[i])
+			i++;
+		assert(iter.index == i && *slot == model[i]);
+		i++;
+	}
+	for (; i < CHECK_ITEMS; i++)
+		assert(!model[i] || !model_tag[i]);
+}
+
+/*
+ * Each round builds a tree of a different shape: dense or sparse, from
+ * sequential or random inserts, and every fifth round a single item at
+ * index 0, which lives in the root without a node.
+ */
+static void check(void)
+{
+	unsigned long i, k, nr, span;
+	int round, t;
+
+	srandom(1);
+	for (round = 0; round < CHECK_ROUNDS; round++) {
+		RADIX_TREE(root, GFP_KERNEL);
+
+		memset(model, 0, sizeof(model));
+		memset(model_tag, 0, sizeof(model_tag));
+
+		nr = CHECK_ITEMS / (1 + (round % 4) * 7);
+		span = round % 5 == 0 ? 1 : CHECK_ITEMS;
+		for (k = 0; k < nr; k++) {
+			i = round % 3 == 0 ? k : random() % span;
+			if (!model[i]) {
+				model[i] = item(i);
+				assert(!radix_tree_insert(&root, i, model[i]));
+			}
+			if (random() % 3 == 0) {
+				model_tag[i] = 1;
+				radix_tree_tag_set(&root, i, CHECK_TAG);
+			}
+		}
+		for (k = 0; k < CHECK_ITEMS / 8; k++) {
+			i = random() % CHECK_ITEMS;
+			if (model[i] && random() % 2) {
+				assert(radix_tree_delete(&root, i) == model[i]);
+				model[i] = NULL;
+				model_tag[i] = 0;
+			}
+		}
+
+		for (t = 0; t < CHECK_LOOKUPS; t++)
+			check_lookups(&root, t ? random() % CHECK_ITEMS : 0,
+				      1 + random() % 100);
+
+		for (i = 0; i < CHECK_ITEMS; i++)
+			if (model[i])
+				radix_tree_delete(&root, i);
+		assert(root.rnode == NULL);
+	}
+	printf("check: %d rounds against the model passed\n", CHECK_ROUNDS);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void best(double *rate, double r)
+{
+	if (r > *rate)
+		*rate = r;
+}
+
+/*
+ * Walk the whole tree in BENCH_GANG sized batches, restarting after the
+ * last index found, as the page cache walkers do.  Reports the best of
+ * BENCH_REPEAT runs of BENCH_PASSES walks, in millions of items per
+ * second.
+ */
+static void bench(void)
+{
+	RADIX_TREE(root, GFP_KERNEL);
+	double t0, t1, t2, t3, rate[3] = { 0, 0, 0 };
+	void **slots[BENCH_GANG];
+	void *res[BENCH_GANG];
+	unsigned long i, sum = 0;
+	unsigned int n;
+	int rep, pass;
+
+	for (i = 0; i < BENCH_ITEMS; i++) {
+		radix_tree_insert(&root, i, item(i));
+		if (i % 8 == 0)
+			radix_tree_tag_set(&root, i, 0);
+	}
+
+	for (rep = 0; rep < BENCH_REPEAT; rep++) {
+		t0 = now();
+		for (pass = 0; pass < BENCH_PASSES; pass++)
+			for (i = 0; (n = radix_tree_gang_lookup(&root, res, i,
+							BENCH_GANG)); sum += n)
+				i = item_index(res[n - 1]) + 1;
+		t1 = now();
+		for (pass = 0; pass < BENCH_PASSES; pass++)
+			for (i = 0; (n = radix_tree_gang_lookup_slot(&root,
+						slots, i, BENCH_GANG)); sum += n)
+				i = item_index(*slots[n - 1]) + 1;
+		t2 = now();
+		for (pass = 0; pass < BENCH_PASSES; pass++)
+			for (i = 0; (n = radix_tree_gang_lookup_tag_slot(&root,
+					slots, i, BENCH_GANG, 0)); sum += n)
+				i = item_index(*slots[n - 1]) + 1;
+		t3 = now();
+
+		best(&rate[0], BENCH_PASSES * BENCH_ITEMS / (t1 - t0));
+		best(&rate[1], BENCH_PASSES * BENCH_ITEMS / (t2 - t1));
+		best(&rate[2], BENCH_PASSES * BENCH_ITEMS / 8 / (t3 - t2));
+	}
+
+	printf("gang_lookup           %4.0f M items/s\n"
+	       "gang_lookup_slot      %4.0f M items/s\n"
+	       "gang_lookup_tag_slot  %4.0f M tagged items/s\n",
+	       rate[0] / 1e6, rate[1] / 1e6, rate[2] / 1e6);
+	assert(sum == BENCH_REPEAT * BENCH_PASSES *
+	       (2 * BENCH_ITEMS + BENCH_ITEMS / 8));
+}
+
+int main(int argc, char **argv)
+{
+	int opt, do_bench = 1;
+
+	while ((opt = getopt(argc, argv, "c")) != -1) {
+		switch (opt) {
+		case 'c':
+			do_bench = 0;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-c]\n"
+				"  -c  run the model check only\n", argv[0]);
+			return 1;
+		}
+	}
+
+	radix_tree_init();
+	check();
+	if (do_bench)
+		bench();
+	return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Just enough of the kernel for lib/radix-tree.c and
+ * include/linux/radix-tree.h to build as a single threaded userspace
+ * program: slab on malloc, RCU as plain accesses, one CPU.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2, or (at
+ * your option) any later version.
+ */
+
+#ifndef _RADIX_TREE_TEST_SHIM_H
+#define _RADIX_TREE_TEST_SHIM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+
+#define CONFIG_BASE_SMALL	0
+#define BITS_PER_LONG		(CHAR_BIT * sizeof(long))
+
+#define __init
+#define __rcu
+#define __force
+#define __read_mostly
+#ifndef __always_inline
+#define __always_inline		inline __attribute__((always_inline))
+#endif
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+#define EXPORT_SYMBOL(sym)
+
+#define BUG_ON(cond)		assert(!(cond))
+#define WARN_ON(cond)		(cond)
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - __builtin_offsetof(type, member)))
+
+typedef unsigned int gfp_t;
+#define __GFP_WAIT		0x10u
+#define GFP_KERNEL		__GFP_WAIT
+#define __GFP_BITS_SHIFT	25
+#define __GFP_BITS_MASK		((gfp_t)((1 << __GFP_BITS_SHIFT) - 1))
+
+typedef int spinlock_t;
+
+/* One CPU, no preemption, nothing runs in interrupt context */
+#define preempt_disable()	do { } while (0)
+#define preempt_enable()	do { } while (0)
+#define in_interrupt()		0
+#define might_sleep_if(cond)	do { } while (0)
+#define DEFINE_PER_CPU(type, name)	__typeof__(type) name
+#define __get_cpu_var(name)	(name)
+#define per_cpu(name, cpu)	(*((void)(cpu), &(name)))
+
+struct notifier_block;
+#define NOTIFY_OK		0x0001
+#define CPU_DEAD		0x0007
+#define CPU_DEAD_FROZEN		(CPU_DEAD | 0x0010)
+#define hotcpu_notifier(fn, pri)	do { (void)(fn); } while (0)
+
+/* Callbacks run at once, the test never has concurrent readers */
+struct rcu_head {
+	void (*func)(struct rcu_head *head);
+};
+#define rcu_dereference(p)		(p)
+#define rcu_dereference_raw(p)		(p)
+#define rcu_dereference_protected(p, c)	(p)
+#define rcu_assign_pointer(p, v)	((p) = (v))
+#define lockdep_is_held(lock)		1
+
+static inline void call_rcu(struct rcu_head *head,
+			    void (*func)(struct rcu_head *head))
+{
+	func(head);
+}
+
+#define SLAB_PANIC		0x1
+#define SLAB_RECLAIM_ACCOUNT	0x2
+
+struct kmem_cache {
+	size_t size;
+	void (*ctor)(void *);
+};
+
+static inline struct kmem_cache *
+kmem_cache_create(const char *name, size_t size, size_t align,
+		  unsigned long flags, void (*ctor)(void *))
+{
+	struct kmem_cache *cachep = malloc(sizeof(*cachep));
+
+	assert(cachep);
+	cachep->size = size;
+	cachep->ctor = ctor;
+	return cachep;
+}
+
+static inline void *kmem_cache_alloc(struct kmem_cache *cachep, gfp_t flags)
+{
+	void *p = malloc(cachep->size);
+
+	if (p && cachep->ctor)
+		cachep->ctor(p);
+	return p;
+}
+
+static inline void kmem_cache_free(struct kmem_cache *cachep, void *p)
+{
+	free(p);
+}
+
+static inline unsigned long __ffs(unsigned long word)
+{
+	return __builtin_ctzl(word);
+}
+
+static inline int test_bit(int nr, const unsigned long *addr)
+{
+	return 1UL & (addr[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG));
+}
+
+static inline void __set_bit(int nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static inline void __clear_bit(int nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+static inline unsigned long find_next_bit(const unsigned long *addr,
+					  unsigned long size,
+					  unsigned long offset)
+{
+	for (; offset < size; offset++)
+		if (test_bit(offset, addr))
+			return offset;
+	return size;
+}
+
+#endif /* _RADIX_TREE_TEST_SHIM_H */